@@ -115,6 +115,20 @@
 #error Too many envelope bits
 #endif
 
+//Generate whole blocks per operator instead of one sample per channel
+//The output is the same, but it isn't faster than the sample by sample path
+//yet, so it's off unless asked for (tools/oplcheck.c compares the two)
+#ifndef DBOPL_BLOCK_SYNTH
+#define DBOPL_BLOCK_SYNTH 0
+#endif
+
+#if DBOPL_BLOCK_SYNTH && ( DBOPL_WAVE != WAVE_TABLEMUL )
+#error The block synth needs DBOPL_WAVE == WAVE_TABLEMUL
+#endif
+
+//Samples per operator block
+#define SYNTH_BLOCK 256
+
 static inline void Operator__SetState(Operator *self, Bit8u s );
 static inline Bit32u Chip__ForwardNoise(Chip *self);
 
@@ -637,8 +651,7 @@ static inline Bits Operator__GetWave(Operator *self, Bitu index, Bitu vol ) {
 #endif
 }
 
-static inline Bits Operator__GetSample(Operator *self, Bits modulation ) {
-  Bitu vol = Operator__ForwardVolume(self);
+static inline Bits Operator__GetSampleAtVolume(Operator *self, Bits modulation, Bitu vol ) {
   if ( ENV_SILENT( vol ) ) {
     //Simply forward the wave
     self->waveIndex += self->waveCurrent;
@@ -650,6 +663,76 @@ static inline Bits Operator__GetSample(Operator *self, Bits modulation ) {
   }
 }
 
+static inline Bits Operator__GetSample(Operator *self, Bits modulation ) {
+  return Operator__GetSampleAtVolume( self, modulation, Operator__ForwardVolume(self) );
+}
+
+#if DBOPL_BLOCK_SYNTH
+//The envelope of an operator doesn't depend on anything else,
+//so the volumes for a whole block can be worked out first
+//Returns TRUE if the volume is the same for the whole block
+static int Operator__ForwardVolumes(Operator *self, Bit32u samples, Bit32s* vol ) {
+  Bit32u i;
+
+  if ( self->state == OFF || ( self->state == SUSTAIN && ( self->reg20 & MASK_SUSTAIN ) ) ) {
+    //The envelope holds, the handler doesn't change anything
+    Bit32s held = (Bit32s)Operator__ForwardVolume( self );
+    for ( i = 0; i < samples; i++ )
+      vol[i] = held;
+    return TRUE;
+  }
+
+  for ( i = 0; i < samples; i++ )
+    vol[i] = (Bit32s)Operator__ForwardVolume( self );
+  return FALSE;
+}
+
+static const Bit32s NoModulation[ SYNTH_BLOCK ];
+
+//Operator__GetSample for a block, modulation can be NoModulation
+//The wave moves on whether the operator is silent or not, which keeps
+//branches and calls out of the loop
+static void Operator__GetSamples(Operator *self, Bit32u samples,
+                                 const Bit32s* modulation, Bit32s* output ) {
+  Bit32s vol[ SYNTH_BLOCK ];
+  const Bit16s* waveBase = self->waveBase;
+  Bit32u waveMask = self->waveMask;
+  Bit32u waveIndex = self->waveIndex;
+  Bit32u waveCurrent = self->waveCurrent;
+  Bit32u i;
+
+  if ( Operator__ForwardVolumes( self, samples, vol ) ) {
+    if ( ENV_SILENT( vol[0] ) ) {
+      memset( output, 0, samples * sizeof( *output ) );
+      self->waveIndex += samples * waveCurrent;
+    } else {
+      Bit32s mul = MulTable[ vol[0] >> ENV_EXTRA ];
+      for ( i = 0; i < samples; i++ ) {
+        Bit32u index;
+
+        waveIndex += waveCurrent;
+        index = ( waveIndex >> WAVE_SH ) + modulation[i];
+        output[i] = ( waveBase[ index & waveMask ] * mul ) >> MUL_SH;
+      }
+      self->waveIndex = waveIndex;
+    }
+    return;
+  }
+
+  for ( i = 0; i < samples; i++ ) {
+    Bit32s silent = -ENV_SILENT( vol[i] );
+    Bit32u volume = vol[i] & ~silent;
+    Bit32u index;
+
+    waveIndex += waveCurrent;
+    index = ( waveIndex >> WAVE_SH ) + modulation[i];
+    output[i] = ( ( waveBase[ index & waveMask ] * MulTable[ volume >> ENV_EXTRA ] ) >> MUL_SH ) & ~silent;
+  }
+
+  self->waveIndex = waveIndex;
+}
+#endif
+
 static void Operator__Operator(Operator *self) {
   self->chanData = 0;
   self->freqMul = 0;
@@ -903,60 +986,56 @@ static inline void Channel__GeneratePercussion(Channel *self, Chip* chip,
   }
 }
 
-Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
-                                Bit32u samples, Bit32s* output,
-                                SynthMode mode ) {
-        Bitu i;
 
+//Check if the channel can be skipped for this block
+static int Channel__Silent(Channel *self, SynthMode mode ) {
   switch( mode ) {
   case sm2AM:
   case sm3AM:
     if ( Operator__Silent(Channel__Op(self, 0))
                  && Operator__Silent(Channel__Op(self, 1))) {
-      self->old[0] = self->old[1] = 0;
-      return(self + 1);
+      return TRUE;
     }
     break;
   case sm2FM:
   case sm3FM:
     if ( Operator__Silent(Channel__Op(self, 1))) {
-      self->old[0] = self->old[1] = 0;
-      return (self + 1);
+      return TRUE;
     }
     break;
   case sm3FMFM:
     if ( Operator__Silent(Channel__Op(self, 3))) {
-      self->old[0] = self->old[1] = 0;
-      return (self + 2);
+      return TRUE;
     }
     break;
   case sm3AMFM:
     if ( Operator__Silent( Channel__Op(self, 0) )
                  && Operator__Silent( Channel__Op(self, 3) )) {
-      self->old[0] = self->old[1] = 0;
-      return (self + 2);
+      return TRUE;
     }
     break;
   case sm3FMAM:
     if ( Operator__Silent( Channel__Op(self, 1))
                  && Operator__Silent( Channel__Op(self, 3))) {
-      self->old[0] = self->old[1] = 0;
-      return (self + 2);
+      return TRUE;
     }
     break;
   case sm3AMAM:
     if ( Operator__Silent( Channel__Op(self, 0) )
                  && Operator__Silent( Channel__Op(self, 2) )
                  && Operator__Silent( Channel__Op(self, 3) )) {
-      self->old[0] = self->old[1] = 0;
-      return (self + 2);
+      return TRUE;
     }
     break;
 
         default:
                 abort();
   }
-  //Init the operators with the the current vibrato and tremolo values
+  return FALSE;
+}
+
+//Init the operators with the the current vibrato and tremolo values
+static void Channel__Prepare(Channel *self, const Chip* chip, SynthMode mode ) {
         Operator__Prepare( Channel__Op( self, 0 ), chip );
         Operator__Prepare( Channel__Op( self, 1 ), chip );
   if ( mode > sm4Start ) {
@@ -967,6 +1046,19 @@ Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
                 Operator__Prepare( Channel__Op( self, 4 ), chip );
                 Operator__Prepare( Channel__Op( self, 5 ), chip );
   }
+}
+
+Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
+                                Bit32u samples, Bit32s* output,
+                                SynthMode mode ) {
+        Bitu i;
+
+  if ( Channel__Silent( self, mode ) ) {
+    self->old[0] = self->old[1] = 0;
+    return self + ( mode > sm4Start ? 2 : 1 );
+  }
+  //Init the operators with the the current vibrato and tremolo values
+  Channel__Prepare( self, chip, mode );
   for ( i = 0; i < samples; i++ ) {
     Bit32s mod, sample, out0;
     Bits next;
@@ -1262,18 +1354,218 @@ Bit32u Chip__WriteAddr(Chip *self, Bit32u port, Bit8u val ) {
   return 0;
 }
 
+#if DBOPL_BLOCK_SYNTH
+/*
+  Block synth
+
+  Does the same as the synth handlers, but an operator at a time over the
+  whole block. Only the first operator of a channel feeds back into itself,
+  and that long chain of dependent steps is what limits the speed, so the
+  first operators of all the channels are stepped together.
+*/
+
+static const SynthHandler SynthHandlerTable[] = {
+  Channel__BlockTemplate_sm2AM,
+  Channel__BlockTemplate_sm2FM,
+  Channel__BlockTemplate_sm3AM,
+  Channel__BlockTemplate_sm3FM,
+  NULL,
+  Channel__BlockTemplate_sm3FMFM,
+  Channel__BlockTemplate_sm3AMFM,
+  Channel__BlockTemplate_sm3FMAM,
+  Channel__BlockTemplate_sm3AMAM,
+  NULL,
+  Channel__BlockTemplate_sm2Percussion,
+  Channel__BlockTemplate_sm3Percussion,
+};
+
+static SynthMode Channel__SynthMode(const Channel *self) {
+  size_t mode;
+
+  for ( mode = 0; mode < sizeof( SynthHandlerTable ) / sizeof( *SynthHandlerTable ); mode++ ) {
+    if ( SynthHandlerTable[ mode ] == self->synthHandler )
+      return (SynthMode)mode;
+  }
+
+  abort();
+  return sm2FM;
+}
+
+//Up to 18 two operator channels
+#define MAX_BLOCK_CHANNELS 18
+
+//First operator of each channel with the feedback, out0 gets the old[0] values
+static void Channel__GenerateFeedback(Channel **channels, int count, Bit32u samples,
+                                      Bit32s out0[][ SYNTH_BLOCK ] ) {
+  Bit32s vol[ MAX_BLOCK_CHANNELS ][ SYNTH_BLOCK ];
+  const Bit16s* waveBase[ MAX_BLOCK_CHANNELS ];
+  Bit32u waveMask[ MAX_BLOCK_CHANNELS ];
+  Bit32u waveIndex[ MAX_BLOCK_CHANNELS ];
+  Bit32u waveCurrent[ MAX_BLOCK_CHANNELS ];
+  Bit32u feedback[ MAX_BLOCK_CHANNELS ];
+  Bit32s old0[ MAX_BLOCK_CHANNELS ];
+  Bit32s old1[ MAX_BLOCK_CHANNELS ];
+  Bit32u i;
+  int c;
+
+  for ( c = 0; c < count; c++ ) {
+    Operator* op = Channel__Op( channels[c], 0 );
+
+    Operator__ForwardVolumes( op, samples, vol[c] );
+    waveBase[c] = op->waveBase;
+    waveMask[c] = op->waveMask;
+    waveIndex[c] = op->waveIndex;
+    waveCurrent[c] = op->waveCurrent;
+    feedback[c] = channels[c]->feedback;
+    old0[c] = channels[c]->old[0];
+    old1[c] = channels[c]->old[1];
+  }
+
+  for ( i = 0; i < samples; i++ ) {
+    for ( c = 0; c < count; c++ ) {
+      Bit32s silent = -ENV_SILENT( vol[c][i] );
+      Bit32u volume = vol[c][i] & ~silent;
+      Bit32u index;
+
+      waveIndex[c] += waveCurrent[c];
+      //Do unsigned shift so we can shift out all bits but still stay in 10 bit range otherwise
+      index = ( waveIndex[c] >> WAVE_SH ) + ( (Bit32u)( old0[c] + old1[c] ) >> feedback[c] );
+      old0[c] = old1[c];
+      old1[c] = ( ( waveBase[c][ index & waveMask[c] ] * MulTable[ volume >> ENV_EXTRA ] ) >> MUL_SH ) & ~silent;
+      out0[c][i] = old0[c];
+    }
+  }
+
+  for ( c = 0; c < count; c++ ) {
+    Channel__Op( channels[c], 0 )->waveIndex = waveIndex[c];
+    channels[c]->old[0] = old0[c];
+    channels[c]->old[1] = old1[c];
+  }
+}
+
+//The other operators of a channel, the first one is in out0
+static void Channel__GenerateBlock(Channel *self, Bit32u samples, const Bit32s* out0,
+                                   Bit32s* output, SynthMode mode ) {
+  Bit32s next[ SYNTH_BLOCK ];
+  Bit32s sample[ SYNTH_BLOCK ];
+  Bit32s extra[ SYNTH_BLOCK ];
+  Bit32u i;
+
+  switch( mode ) {
+  case sm2AM:
+  case sm3AM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, NoModulation, sample );
+    for ( i = 0; i < samples; i++ )
+      sample[i] += out0[i];
+    break;
+  case sm2FM:
+  case sm3FM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, out0, sample );
+    break;
+  case sm3FMFM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, out0, next );
+    Operator__GetSamples( Channel__Op(self, 2), samples, next, extra );
+    Operator__GetSamples( Channel__Op(self, 3), samples, extra, sample );
+    break;
+  case sm3AMFM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, NoModulation, next );
+    Operator__GetSamples( Channel__Op(self, 2), samples, next, extra );
+    Operator__GetSamples( Channel__Op(self, 3), samples, extra, sample );
+    for ( i = 0; i < samples; i++ )
+      sample[i] += out0[i];
+    break;
+  case sm3FMAM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, out0, sample );
+    Operator__GetSamples( Channel__Op(self, 2), samples, NoModulation, next );
+    Operator__GetSamples( Channel__Op(self, 3), samples, next, extra );
+    for ( i = 0; i < samples; i++ )
+      sample[i] += extra[i];
+    break;
+  case sm3AMAM:
+    Operator__GetSamples( Channel__Op(self, 1), samples, NoModulation, next );
+    Operator__GetSamples( Channel__Op(self, 2), samples, next, sample );
+    Operator__GetSamples( Channel__Op(self, 3), samples, NoModulation, extra );
+    for ( i = 0; i < samples; i++ )
+      sample[i] += out0[i] + extra[i];
+    break;
+  default:
+    abort();
+  }
+
+  switch( mode ) {
+  case sm2AM:
+  case sm2FM:
+    for ( i = 0; i < samples; i++ )
+      output[ i ] += sample[i];
+    break;
+  default:
+    for ( i = 0; i < samples; i++ ) {
+      output[ i * 2 + 0 ] += sample[i] & self->maskLeft;
+      output[ i * 2 + 1 ] += sample[i] & self->maskRight;
+    }
+    break;
+  }
+}
+
+//Runs the synth handlers of the channels from first up to last
+static void Chip__GenerateChannels(Chip *self, Channel *first, Channel *last,
+                                   Bit32u samples, Bit32s* output, int stereo ) {
+  Channel* channels[ MAX_BLOCK_CHANNELS ];
+  SynthMode modes[ MAX_BLOCK_CHANNELS ];
+  Bit32s out0[ MAX_BLOCK_CHANNELS ][ SYNTH_BLOCK ];
+  Channel *ch;
+  Bit32u done;
+  int count = 0;
+  int c;
+
+  for ( ch = first; ch < last; ) {
+    SynthMode mode = Channel__SynthMode( ch );
+
+    //Percussion keeps the sample by sample handler
+    if ( mode > sm6Start ) {
+      ch = (ch->synthHandler)( ch, self, samples, output );
+      continue;
+    }
+
+    if ( Channel__Silent( ch, mode ) ) {
+      ch->old[0] = ch->old[1] = 0;
+    } else {
+      Channel__Prepare( ch, self, mode );
+      channels[ count ] = ch;
+      modes[ count ] = mode;
+      count++;
+    }
+    ch += mode > sm4Start ? 2 : 1;
+  }
+
+  for ( done = 0; done < samples; done += SYNTH_BLOCK ) {
+    Bit32u todo = samples - done < SYNTH_BLOCK ? samples - done : SYNTH_BLOCK;
+
+    Channel__GenerateFeedback( channels, count, todo, out0 );
+    for ( c = 0; c < count; c++ )
+      Channel__GenerateBlock( channels[c], todo, out0[c], output + done * ( stereo ? 2 : 1 ), modes[c] );
+  }
+}
+#endif
+
 void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output ) {
   while ( total > 0 ) {
+#if !DBOPL_BLOCK_SYNTH
                 Channel *ch;
     int count;
+#endif
 
     Bit32u samples = Chip__ForwardLFO( self, total );
     memset(output, 0, sizeof(Bit32s) * samples);
+#if DBOPL_BLOCK_SYNTH
+    Chip__GenerateChannels( self, self->chan, self->chan + 9, samples, output, FALSE );
+#else
     count = 0;
     for ( ch = self->chan; ch < self->chan + 9; ) {
       count++;
       ch = (ch->synthHandler)( ch, self, samples, output );
     }
+#endif
     total -= samples;
     output += samples;
   }
@@ -1281,16 +1573,22 @@ void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output ) {
 
 void Chip__GenerateBlock3(Chip *self, Bitu total, Bit32s* output  ) {
   while ( total > 0 ) {
+#if !DBOPL_BLOCK_SYNTH
                 int count;
                 Channel *ch;
+#endif
 
     Bit32u samples = Chip__ForwardLFO( self, total );
     memset(output, 0, sizeof(Bit32s) * samples *2);
+#if DBOPL_BLOCK_SYNTH
+    Chip__GenerateChannels( self, self->chan, self->chan + 18, samples, output, TRUE );
+#else
     count = 0;
     for ( ch = self->chan; ch < self->chan + 18; ) {
       count++;
       ch = (ch->synthHandler)( ch, self, samples, output );
     }
+#endif
     total -= samples;
     output += samples * 2;
   }
@@ -60,6 +60,7 @@ const music_player_t db_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -286,7 +287,8 @@ const music_player_t db_player =
   db_unregistersong,
   db_play,
   db_stop,
-  db_render
+  db_render,
+  NULL
 };
 
 
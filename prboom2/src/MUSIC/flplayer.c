@@ -60,6 +60,7 @@ const music_player_t fl_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -83,6 +84,7 @@ static int f_font;
 static midi_event_t **events;
 static int eventpos;
 static midi_file_t *midifile;
+static midi_timeline_t *timeline;
 
 static int f_playing;
 static int f_paused;
@@ -345,6 +347,8 @@ static const void *fl_registersong (const void *data, unsigned len)
   }
   eventpos = 0;
 
+  timeline = MIDI_BuildTimeline (midifile, events, f_soundrate);
+
   // implicit 120BPM (this is correct to spec)
   //spmc = compute_spmc (MIDI_GetFileTimeDivision (midifile), 500000, f_soundrate);
   spmc = MIDI_spmc (midifile, NULL, f_soundrate);
@@ -355,6 +359,11 @@ static const void *fl_registersong (const void *data, unsigned len)
 
 static void fl_unregistersong (const void *handle)
 {
+  if (timeline)
+  {
+    MIDI_FreeTimeline (timeline);
+    timeline = NULL;
+  }
   if (events)
   {
     MIDI_DestroyFlatList (events);
@@ -402,6 +411,44 @@ static void fl_stop (void)
   }
 }
 
+static void fl_seek (unsigned position)
+{
+  midi_state_t state;
+  double remaining;
+  int i, j;
+
+  if (!f_playing || !timeline)
+    return;
+
+  eventpos = MIDI_SeekTimeline (timeline, (double) position * f_soundrate / 1000,
+                                f_looping, &state, &remaining);
+  if (eventpos < 0)
+  {
+    eventpos = 0;
+    fl_stop ();
+    return;
+  }
+
+  fluid_synth_system_reset (f_syn);
+
+  for (i = 0; i < 16; i++)
+  {
+    const midi_channel_state_t *channel = &state.channels[i];
+
+    // controllers first, the program change depends on the bank
+    for (j = 0; j < 128; j++)
+      if (channel->controllers[j] != MIDI_STATE_UNSET)
+        fluid_synth_cc (f_syn, i, j, channel->controllers[j]);
+    if (channel->program != MIDI_STATE_UNSET)
+      fluid_synth_program_change (f_syn, i, channel->program);
+    fluid_synth_pitch_bend (f_syn, i, channel->bend);
+  }
+
+  // the render loop waits delta * spmc + f_delta samples for the next event
+  spmc = MIDI_spmc (midifile, state.tempo, f_soundrate);
+  f_delta = remaining - events[eventpos]->delta_time * spmc;
+}
+
 static void fl_setvolume (int v)
 {
   f_volume = v;
@@ -617,7 +664,8 @@ const music_player_t fl_player =
   fl_unregistersong,
   fl_play,
   fl_stop,
-  fl_render
+  fl_render,
+  fl_seek
 };
 
 
@@ -62,6 +62,7 @@ const music_player_t mp_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -327,7 +328,8 @@ const music_player_t mp_player =
   mp_unregistersong,
   mp_play,
   mp_stop,
-  mp_render
+  mp_render,
+  NULL
 };
 
 #endif // HAVE_LIBMAD
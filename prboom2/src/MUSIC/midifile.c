@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 
 #ifndef TEST
 #include "doomdef.h"
@@ -750,6 +751,16 @@ void MIDI_RestartIterator(midi_track_iter_t *iter)
     iter->position = 0;
 }
 
+void MIDI_SeekIterator(midi_track_iter_t *iter, unsigned int position)
+{
+    if (position > iter->track->num_events)
+    {
+        position = iter->track->num_events;
+    }
+
+    iter->position = position;
+}
+
 
 
 static void MIDI_PrintFlatListDBG (const midi_event_t **evs)
@@ -1147,6 +1158,164 @@ midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf)
 
 
 
+/*
+A timeline resolves the tempo of a flat list once, so that players can seek
+without going through the song event by event. Each event gets its absolute
+time. The controller state is snapshot every MIDI_TIMELINE_INTERVAL events;
+a seek binary searches the times and replays at most that many events from
+the closest snapshot. Notes that were held at the seek position are lost.
+*/
+
+#define MIDI_TIMELINE_INTERVAL 256
+
+struct midi_timeline_s
+{
+  midi_event_t **events;
+  int num_events; // up to and including the end of track
+  double *times;
+  midi_state_t *states; // before every MIDI_TIMELINE_INTERVAL events
+};
+
+static void MIDI_ResetState (midi_state_t *state)
+{
+  int i;
+
+  for (i = 0; i < MIDI_CHANNELS_PER_TRACK; i++)
+  {
+    memset (state->channels[i].controllers, MIDI_STATE_UNSET, sizeof (state->channels[i].controllers));
+    state->channels[i].program = MIDI_STATE_UNSET;
+    state->channels[i].bend = 0x2000;
+  }
+
+  state->tempo = NULL;
+}
+
+static void MIDI_UpdateState (midi_state_t *state, const midi_event_t *ev)
+{
+  midi_channel_state_t *channel;
+  unsigned int i;
+
+  switch (ev->event_type)
+  {
+    case MIDI_EVENT_CONTROLLER:
+      channel = &state->channels[ev->data.channel.channel];
+      if (ev->data.channel.param1 == 121)
+      { // reset all controllers leaves the bank, volume and pan alone
+        for (i = 1; i < 120; i++)
+          if (i != MIDI_CONTROLLER_MAIN_VOLUME && i != MIDI_CONTROLLER_PAN && i != 32)
+            channel->controllers[i] = MIDI_STATE_UNSET;
+        channel->bend = 0x2000;
+      }
+      else if (ev->data.channel.param1 < 120) // not a channel mode message
+        channel->controllers[ev->data.channel.param1] = ev->data.channel.param2;
+      break;
+    case MIDI_EVENT_PROGRAM_CHANGE:
+      state->channels[ev->data.channel.channel].program = ev->data.channel.param1;
+      break;
+    case MIDI_EVENT_PITCH_BEND:
+      state->channels[ev->data.channel.channel].bend = ev->data.channel.param1 | ev->data.channel.param2 << 7;
+      break;
+    case MIDI_EVENT_META:
+      if (ev->data.meta.type == MIDI_META_SET_TEMPO)
+        state->tempo = ev;
+      break;
+    default:
+      break;
+  }
+}
+
+midi_timeline_t *MIDI_BuildTimeline (const midi_file_t *file, midi_event_t **events, unsigned sndrate)
+{
+  midi_timeline_t *timeline;
+  midi_state_t state;
+  double spmc, time;
+  int i, count;
+
+  // flat lists always finish with an end of track
+  for (count = 1; ; count++)
+  {
+    const midi_event_t *ev = events[count - 1];
+
+    if (ev->event_type == MIDI_EVENT_META && ev->data.meta.type == MIDI_META_END_OF_TRACK)
+      break;
+  }
+
+  timeline = (midi_timeline_t*)Z_Malloc (sizeof (*timeline));
+  timeline->events = events;
+  timeline->num_events = count;
+  timeline->times = (double*)Z_Malloc (count * sizeof (*timeline->times));
+  timeline->states = (midi_state_t*)Z_Malloc ((count + MIDI_TIMELINE_INTERVAL - 1) /
+                                              MIDI_TIMELINE_INTERVAL * sizeof (*timeline->states));
+
+  MIDI_ResetState (&state);
+  spmc = MIDI_spmc (file, NULL, sndrate);
+  time = 0.0;
+
+  for (i = 0; i < count; i++)
+  {
+    if (i % MIDI_TIMELINE_INTERVAL == 0)
+      timeline->states[i / MIDI_TIMELINE_INTERVAL] = state;
+
+    // same order as the players: the delta uses the tempo before the event
+    time += events[i]->delta_time * spmc;
+    timeline->times[i] = time;
+
+    MIDI_UpdateState (&state, events[i]);
+    if (state.tempo == events[i])
+      spmc = MIDI_spmc (file, events[i], sndrate);
+  }
+
+  return timeline;
+}
+
+void MIDI_FreeTimeline (midi_timeline_t *timeline)
+{
+  Z_Free (timeline->times);
+  Z_Free (timeline->states);
+  Z_Free (timeline);
+}
+
+int MIDI_SeekTimeline (const midi_timeline_t *timeline, double position, int looping,
+                       midi_state_t *state, double *remaining)
+{
+  double length = timeline->times[timeline->num_events - 1];
+  int low, high, i;
+
+  if (position < 0.0)
+    position = 0.0;
+
+  if (position >= length)
+  {
+    if (!looping)
+      return -1;
+
+    position = length > 0.0 ? fmod (position, length) : 0.0;
+  }
+
+  // first event at or after position
+  low = 0;
+  high = timeline->num_events - 1;
+  while (low < high)
+  {
+    int mid = (low + high) / 2;
+
+    if (timeline->times[mid] < position)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  *state = timeline->states[low / MIDI_TIMELINE_INTERVAL];
+  for (i = low - low % MIDI_TIMELINE_INTERVAL; i < low; i++)
+    MIDI_UpdateState (state, timeline->events[i]);
+
+  *remaining = timeline->times[low] - position;
+
+  return low;
+}
+
+
+
 #ifdef TEST
 
 static char *MIDI_EventTypeToString(midi_event_type_t event_type)
@@ -190,4 +190,39 @@ double MIDI_spmc (const midi_file_t *file, const midi_event_t *ev, unsigned sndr
 
 midi_file_t *MIDI_LoadFileSpecial (midimem_t *mf);
 
+// Move an iterator to an event in its track.
+void MIDI_SeekIterator(midi_track_iter_t *iter, unsigned int position);
+
+// Timeline of a flat list, for seeking.
+// Times are in samples at the rate the timeline was built for.
+
+// Unset controllers and programs are MIDI_STATE_UNSET
+#define MIDI_STATE_UNSET 0xff
+
+typedef struct
+{
+  byte program;
+  byte controllers[128];
+  unsigned short bend;
+} midi_channel_state_t;
+
+typedef struct
+{
+  midi_channel_state_t channels[MIDI_CHANNELS_PER_TRACK];
+
+  // last tempo event, or NULL for the default tempo
+  const midi_event_t *tempo;
+} midi_state_t;
+
+typedef struct midi_timeline_s midi_timeline_t;
+
+midi_timeline_t *MIDI_BuildTimeline (const midi_file_t *file, midi_event_t **events, unsigned sndrate);
+void MIDI_FreeTimeline (midi_timeline_t *timeline);
+
+// Finds the first event at or after position and the state just before it.
+// Returns the index of the event in the flat list, or -1 if the song is over.
+// remaining is set to the time from position to the event.
+int MIDI_SeekTimeline (const midi_timeline_t *timeline, double position, int looping,
+                       midi_state_t *state, double *remaining);
+
 #endif /* #ifndef MIDIFILE_H */
@@ -82,6 +82,10 @@ typedef struct
   // s16 stereo, with samplerate as specified in init.  player needs to be able to handle
   // just about anything for nsamp.  render can be called even during pause+stop.
   void (*render)(void *dest, unsigned nsamp);
+
+  // move the playing song to a position in ms from its start.  can be NULL if
+  // the player can't seek, in which case the song keeps playing where it is.
+  void (*seek)(unsigned position);
 } music_player_t;
 
 #endif // MUSICPLAYER_H
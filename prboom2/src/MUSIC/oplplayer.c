@@ -329,6 +329,11 @@ static unsigned int num_tracks = 0;
 static unsigned int running_tracks = 0;
 static dboolean song_looping;
 
+// Events of the registered song with their times in ms, for seeking.
+
+static midi_event_t **song_events;
+static midi_timeline_t *song_timeline;
+
 // Configuration file variable, containing the port number for the
 // adlib chip.
 
@@ -1316,6 +1321,75 @@ static void I_OPL_StopSong(void)
 
 }
 
+// Move the playing song to a position in ms.
+
+static void I_OPL_SeekSong(unsigned int position)
+{
+    opl_track_data_t *track;
+    midi_state_t state;
+    double remaining;
+    int index;
+    unsigned int i;
+
+    if (!music_initialized || tracks == NULL || song_timeline == NULL)
+    {
+        return;
+    }
+
+    // Drop the pending event and the notes being played.
+
+    OPL_ClearCallbacks();
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].channel != NULL)
+        {
+            VoiceKeyOff(&voices[i]);
+            ReleaseVoice(&voices[i]);
+        }
+    }
+
+    index = MIDI_SeekTimeline(song_timeline, position, song_looping,
+                              &state, &remaining);
+
+    if (index < 0)
+    {
+        running_tracks = 0;
+        return;
+    }
+
+    // Songs are recooked into a single track at load time.
+
+    track = &tracks[0];
+
+    for (i=0; i<MIDI_CHANNELS_PER_TRACK; ++i)
+    {
+        const midi_channel_state_t *channel_state = &state.channels[i];
+        opl_channel_data_t *channel = &track->channels[i];
+
+        InitChannel(track, channel);
+
+        if (channel_state->program != MIDI_STATE_UNSET)
+        {
+            channel->instrument = &main_instrs[channel_state->program];
+        }
+
+        if (channel_state->controllers[MIDI_CONTROLLER_MAIN_VOLUME] != MIDI_STATE_UNSET)
+        {
+            channel->volume = channel_state->controllers[MIDI_CONTROLLER_MAIN_VOLUME];
+        }
+
+        // Only the MSB, as in PitchBendEvent.
+
+        channel->bend = (channel_state->bend >> 7) - 64;
+    }
+
+    MIDI_SeekIterator(track->iter, index);
+    running_tracks = num_tracks;
+
+    OPL_SetCallback((unsigned int) remaining, TrackTimerCallback, track);
+}
+
 static void I_OPL_UnRegisterSong(const void *handle)
 {
     if (!music_initialized)
@@ -1323,6 +1397,18 @@ static void I_OPL_UnRegisterSong(const void *handle)
         return;
     }
 
+    if (song_timeline != NULL)
+    {
+        MIDI_FreeTimeline(song_timeline);
+        song_timeline = NULL;
+    }
+
+    if (song_events != NULL)
+    {
+        MIDI_DestroyFlatList(song_events);
+        song_events = NULL;
+    }
+
     if (handle != NULL)
     {
         // This is required to interface with OPL (I think)
@@ -1372,6 +1458,17 @@ static const void *I_OPL_RegisterSong(const void *data, unsigned len)
     {
         lprintf (LO_WARN, "I_OPL_RegisterSong: Failed to load MID.\n");
     }
+    else
+    {
+        // The song is a single track, so the flat list is the track itself
+
+        song_events = MIDI_GenerateFlatList(result);
+
+        if (song_events != NULL)
+        {
+            song_timeline = MIDI_BuildTimeline(result, song_events, 1000);
+        }
+    }
 
 
     return result;
@@ -1442,5 +1539,6 @@ const music_player_t opl_synth_player =
   I_OPL_UnRegisterSong,
   I_OPL_PlaySong,
   I_OPL_StopSong,
-  I_OPL_RenderSamples
+  I_OPL_RenderSamples,
+  I_OPL_SeekSong
 };
@@ -62,6 +62,7 @@ const music_player_t pm_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -82,6 +83,7 @@ const music_player_t pm_player =
 static midi_event_t **events;
 static int eventpos;
 static midi_file_t *midifile;
+static midi_timeline_t *timeline;
 
 static int pm_playing;
 static int pm_paused;
@@ -330,6 +332,8 @@ static const void *pm_registersong (const void *data, unsigned len)
   }
   eventpos = 0;
 
+  timeline = MIDI_BuildTimeline (midifile, events, 1000);
+
   spmc = MIDI_spmc (midifile, NULL, 1000);
 
   // handle not used
@@ -375,6 +379,11 @@ static void pm_setvolume (int v)
 
 static void pm_unregistersong (const void *handle)
 {
+  if (timeline)
+  {
+    MIDI_FreeTimeline (timeline);
+    timeline = NULL;
+  }
   if (events)
   {
     MIDI_DestroyFlatList (events);
@@ -649,6 +658,47 @@ static void pm_render (void *vdest, unsigned bufflen)
   }
 }
 
+static void pm_seek (unsigned position)
+{
+  midi_state_t state;
+  double remaining;
+  int i, j;
+
+  if (!pm_playing || !timeline)
+    return;
+
+  eventpos = MIDI_SeekTimeline (timeline, position, pm_looping, &state, &remaining);
+  if (eventpos < 0)
+  {
+    eventpos = 0;
+    pm_stop ();
+    return;
+  }
+
+  reset_device ();
+  sysexbufflen = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    const midi_channel_state_t *channel = &state.channels[i];
+
+    // controllers first, the program change depends on the bank
+    for (j = 0; j < 128; j++)
+      if (j != MIDI_CONTROLLER_MAIN_VOLUME && channel->controllers[j] != MIDI_STATE_UNSET)
+        writeevent (0, MIDI_EVENT_CONTROLLER, i, j, channel->controllers[j]);
+    write_volume (0, i, channel->controllers[MIDI_CONTROLLER_MAIN_VOLUME] != MIDI_STATE_UNSET ?
+                        channel->controllers[MIDI_CONTROLLER_MAIN_VOLUME] : DEFAULT_VOLUME);
+    if (channel->program != MIDI_STATE_UNSET)
+      writeevent (0, MIDI_EVENT_PROGRAM_CHANGE, i, channel->program, 0);
+    writeevent (0, MIDI_EVENT_PITCH_BEND, i, channel->bend & 0x7f, channel->bend >> 7);
+  }
+
+  // the render loop waits delta * spmc + pm_delta ms for the next event
+  spmc = MIDI_spmc (midifile, state.tempo, 1000);
+  pm_delta = remaining - events[eventpos]->delta_time * spmc;
+  trackstart = Pt_Time ();
+}
+
 const music_player_t pm_player =
 {
   pm_name,
@@ -661,7 +711,8 @@ const music_player_t pm_player =
   pm_unregistersong,
   pm_play,
   pm_stop,
-  pm_render
+  pm_render,
+  pm_seek
 };
 
 #endif // HAVE_LIBPORTMIDI
@@ -0,0 +1,331 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *  Sample rate conversion for streamed music.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "z_zone.h"
+
+#include "resample.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// NSM helper routine for some of the streaming audio
+// Output frame i interpolates between input frames (remainder + i * step)
+//  >> 16 and the one after it. The frames the next call starts from are
+//  kept at the front of the buffer.
+
+typedef struct
+{
+  unsigned sratein;
+  unsigned srateout;
+  unsigned remainder;
+  unsigned capacity;
+  unsigned frames;
+  short *input;
+} linear_resampler_t;
+
+static linear_resampler_t linear;
+
+void I_LinearResampleStream (void *dest, unsigned nsamp, void (*proc) (void *dest, unsigned nsamp), unsigned sratein, unsigned srateout)
+{ // assumes 16 bit signed interleaved stereo
+
+  unsigned i;
+  int j = 0;
+
+  short *sout = (short*)dest;
+  short *sin;
+
+  unsigned remainder;
+  unsigned step = (sratein << 16) / (unsigned) srateout;
+
+  unsigned nneed;
+  unsigned nused;
+  dboolean restart = false;
+
+  if (!nsamp)
+    return;
+
+  if (sratein != linear.sratein || srateout != linear.srateout)
+  {
+    linear.sratein = sratein;
+    linear.srateout = srateout;
+    linear.remainder = 0;
+    linear.frames = 1;
+    restart = true;
+  }
+
+  nneed = ((step * (nsamp - 1) + linear.remainder) >> 16) + 2;
+  nused = (step * nsamp + linear.remainder) >> 16;
+  if (nneed < nused)
+    nneed = nused;
+
+  if (nneed > linear.capacity)
+  {
+    linear.input = (short*)Z_Realloc (linear.input, nneed * 4);
+    linear.capacity = nneed;
+  }
+
+  sin = linear.input;
+
+  if (restart) // avoid pop when first starting stream
+    sin[0] = sin[1] = 0;
+
+  if (nneed > linear.frames)
+    proc (sin + linear.frames * 2, nneed - linear.frames);
+
+  remainder = linear.remainder;
+
+  for (i = 0; i < nsamp; i++)
+  {
+    *sout++ = ((unsigned) sin[j + 0] * (0x10000 - remainder) +
+               (unsigned) sin[j + 2] * remainder) >> 16;
+    *sout++ = ((unsigned) sin[j + 1] * (0x10000 - remainder) +
+               (unsigned) sin[j + 3] * remainder) >> 16;
+    remainder += step;
+    j += remainder >> 16 << 1;
+    remainder &= 0xffff;
+  }
+
+  linear.remainder = remainder;
+  linear.frames = nneed - nused;
+  memmove (sin, sin + nused * 2, linear.frames * 4);
+}
+
+// Windowed sinc resampler for streamed music (snd_music_resampler 1)
+// The filter is precomputed for SINC_PHASES fractional positions. The input
+//  is kept as planar floats, so that each output sample is two short dot
+//  products. Output frame i reads SINC_TAPS frames from (remainder + i *
+//  step) >> 16; a new stream starts with SINC_TAPS - 1 silent frames.
+
+#define SINC_TAPS 16
+#define SINC_PHASE_BITS 10
+#define SINC_PHASES (1 << SINC_PHASE_BITS)
+#define SINC_HISTORY (SINC_TAPS - 1)
+#define SINC_KAISER_BETA 8.0
+
+typedef struct
+{
+  unsigned sratein;
+  unsigned srateout;
+  unsigned remainder;
+  unsigned capacity;
+  unsigned frames;
+  float *filter;
+  float *left;
+  float *right;
+  short *input;
+} sinc_resampler_t;
+
+static sinc_resampler_t sinc;
+
+static double BesselI0 (double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  int k;
+
+  for (k = 1; k < 32; k++)
+  {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+
+  return sum;
+}
+
+static void I_InitSincResampler (unsigned sratein, unsigned srateout)
+{
+  double cutoff;
+  int phase;
+  int k;
+
+  // cut off below the lower of the two nyquist frequencies
+  cutoff = 0.9;
+  if (srateout < sratein)
+    cutoff *= (double) srateout / sratein;
+
+  if (!sinc.filter)
+    sinc.filter = Z_Malloc (SINC_PHASES * SINC_TAPS * sizeof(*sinc.filter));
+
+  for (phase = 0; phase < SINC_PHASES; phase++)
+  {
+    float *coef = sinc.filter + phase * SINC_TAPS;
+    double sum = 0.0;
+
+    for (k = 0; k < SINC_TAPS; k++)
+    {
+      double x = k - (SINC_TAPS / 2 - 1) - (double) phase / SINC_PHASES;
+      double t = x / (SINC_TAPS / 2);
+      double window = 0.0;
+      double value;
+
+      if (t > -1.0 && t < 1.0)
+        window = BesselI0 (SINC_KAISER_BETA * sqrt (1.0 - t * t)) / BesselI0 (SINC_KAISER_BETA);
+
+      if (x == 0.0)
+        value = cutoff;
+      else
+        value = sin (M_PI * cutoff * x) / (M_PI * x);
+
+      coef[k] = (float) (value * window);
+      sum += coef[k];
+    }
+
+    // unity gain at every phase
+    for (k = 0; k < SINC_TAPS; k++)
+      coef[k] = (float) (coef[k] / sum);
+  }
+
+  if (sinc.left)
+  {
+    memset (sinc.left, 0, SINC_HISTORY * sizeof(*sinc.left));
+    memset (sinc.right, 0, SINC_HISTORY * sizeof(*sinc.right));
+  }
+
+  sinc.sratein = sratein;
+  sinc.srateout = srateout;
+  sinc.remainder = 0;
+  sinc.frames = SINC_HISTORY;
+}
+
+static short I_SincOutput (float value)
+{
+  if (value >= 32767.0f)
+    return 32767;
+
+  if (value <= -32768.0f)
+    return -32768;
+
+  return (short) lrintf (value);
+}
+
+void I_SincResampleStream (void *dest, unsigned nsamp, void (*proc) (void *dest, unsigned nsamp), unsigned sratein, unsigned srateout)
+{
+  unsigned step = (sratein << 16) / (unsigned) srateout;
+  unsigned nneed;
+  unsigned nused;
+  unsigned remainder;
+  unsigned i;
+  unsigned j = 0;
+  const float *filter;
+  const float *left;
+  const float *right;
+  short *sout = (short *) dest;
+
+  if (!nsamp)
+    return;
+
+  if (sratein != sinc.sratein || srateout != sinc.srateout)
+    I_InitSincResampler (sratein, srateout);
+
+  nneed = ((step * (nsamp - 1) + sinc.remainder) >> 16) + SINC_TAPS;
+  nused = (step * nsamp + sinc.remainder) >> 16;
+  if (nneed < nused)
+    nneed = nused;
+
+  if (nneed > sinc.capacity)
+  {
+    sinc.input = Z_Realloc (sinc.input, nneed * 2 * sizeof(*sinc.input));
+    sinc.left = Z_Realloc (sinc.left, nneed * sizeof(*sinc.left));
+    sinc.right = Z_Realloc (sinc.right, nneed * sizeof(*sinc.right));
+    if (!sinc.capacity) // avoid pop when first starting stream
+    {
+      memset (sinc.left, 0, SINC_HISTORY * sizeof(*sinc.left));
+      memset (sinc.right, 0, SINC_HISTORY * sizeof(*sinc.right));
+    }
+    sinc.capacity = nneed;
+  }
+
+  if (nneed > sinc.frames)
+  {
+    proc (sinc.input, nneed - sinc.frames);
+
+    for (i = 0; i < nneed - sinc.frames; i++)
+    {
+      sinc.left[sinc.frames + i] = sinc.input[i * 2 + 0];
+      sinc.right[sinc.frames + i] = sinc.input[i * 2 + 1];
+    }
+  }
+
+  filter = sinc.filter;
+  left = sinc.left;
+  right = sinc.right;
+  remainder = sinc.remainder;
+
+  for (i = 0; i < nsamp; i++)
+  {
+    const float *coef = filter + (remainder >> (16 - SINC_PHASE_BITS)) * SINC_TAPS;
+    const float *l = left + j;
+    const float *r = right + j;
+    float left_sum[SINC_TAPS];
+    float right_sum[SINC_TAPS];
+    int k, half;
+
+    // products first and then a pairwise sum, both plain loops over arrays,
+    //  so that the compiler can use vector registers
+    for (k = 0; k < SINC_TAPS; k++)
+    {
+      left_sum[k] = coef[k] * l[k];
+      right_sum[k] = coef[k] * r[k];
+    }
+
+    for (half = SINC_TAPS / 2; half > 0; half /= 2)
+      for (k = 0; k < half; k++)
+      {
+        left_sum[k] += left_sum[k + half];
+        right_sum[k] += right_sum[k + half];
+      }
+
+    *sout++ = I_SincOutput (left_sum[0]);
+    *sout++ = I_SincOutput (right_sum[0]);
+
+    remainder += step;
+    j += remainder >> 16;
+    remainder &= 0xffff;
+  }
+
+  sinc.remainder = remainder;
+  sinc.frames = nneed - nused;
+
+  memmove (sinc.left, sinc.left + nused, sinc.frames * sizeof(*sinc.left));
+  memmove (sinc.right, sinc.right + nused, sinc.frames * sizeof(*sinc.right));
+}
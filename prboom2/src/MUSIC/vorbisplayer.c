@@ -62,6 +62,7 @@ const music_player_t vorb_player =
   NULL,
   NULL,
   NULL,
+  NULL,
   NULL
 };
 
@@ -461,7 +462,8 @@ const music_player_t vorb_player =
   vorb_unregistersong,
   vorb_play,
   vorb_stop,
-  vorb_render
+  vorb_render,
+  NULL
 };
 
 #endif // HAVE_LIBVORBISFILE
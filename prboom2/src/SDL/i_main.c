@@ -91,6 +91,11 @@
 void I_Init(void)
 {
   dsda_ResetTimeFunctions(fastdemo);
+
+  // Video capture mixes the sound itself, so don't open an audio device
+  if (dsda_Arg(dsda_arg_viddump)->found)
+    I_SetSoundCap();
+
   I_InitSound();
 }
 
@@ -67,6 +67,8 @@
 #include "d_main.h"
 #include "i_system.h"
 
+#include "MUSIC/resample.h"
+
 //e6y
 #include "i_pcsound.h"
 #include "e6y.h"
@@ -108,10 +110,24 @@ typedef struct
   int leftvol;
   int rightvol;
   dboolean loop;
+  // Pre-resampled data, when the fast mixer can play this channel
+  const struct mix_data_s *mixdata;
+  int mixpos;
+  // Matches the command that started this sound
+  int serial;
 } channel_info_t;
 
+// Only the mixer uses this, the game thread sends it commands
 channel_info_t channelinfo[MAX_CHANNELS];
 
+// Game thread view of the channels.
+// A channel is playing until it is stopped, or until the mixer
+//  reports that it finished the sound with the latest serial.
+static int channel_serial[MAX_CHANNELS];
+static dboolean channel_stopped[MAX_CHANNELS];
+static unsigned int channel_samplerate[MAX_CHANNELS];
+static SDL_atomic_t channel_finished[MAX_CHANNELS];
+
 // Pitch to stepping lookup, unused.
 int   steptable[256];
 
@@ -122,13 +138,14 @@ int   steptable[256];
 static int dumping_sound = 0;
 
 
-// lock for updating any params related to sfx
-SDL_mutex *sfxmutex;
 // lock for updating any params related to music
 SDL_mutex *musmutex;
 
 static int pitched_sounds;
 static int snd_pcspeaker;
+static int snd_reference_mixer;
+static int snd_music_resampler;
+static int snd_cache_size;
 int snd_samplerate; // samples per second
 static int snd_samplecount;
 
@@ -138,6 +155,9 @@ void I_InitSoundParams(void)
 {
   pitched_sounds = dsda_IntConfig(dsda_config_pitched_sounds);
   snd_pcspeaker = dsda_IntConfig(dsda_config_snd_pcspeaker);
+  snd_reference_mixer = dsda_IntConfig(dsda_config_snd_reference_mixer);
+  snd_music_resampler = dsda_IntConfig(dsda_config_snd_music_resampler);
+  snd_cache_size = dsda_IntConfig(dsda_config_snd_cache_size);
 
   // TODO: can we reinitialize sound with new sample rate / count?
   if (!snd_samplerate)
@@ -156,141 +176,465 @@ static void stopchan(int i)
   if (channelinfo[i].data) /* cph - prevent excess unlocks */
   {
     channelinfo[i].data = NULL;
+    channelinfo[i].mixdata = NULL;
+    SDL_AtomicSet(&channel_finished[i], channelinfo[i].serial);
   }
 }
 
-typedef struct wav_data_s
+typedef struct
 {
-  int sfxid;
   const unsigned char *data;
-  int samplelen;
-  int samplerate;
-  int bits;
-  struct wav_data_s *next;
-} wav_data_t;
+  const unsigned char *enddata;
+  unsigned int samplerate;
+  unsigned int bits;
+} sfx_source_t;
+
+// Interpolated sample at the current position of a channel,
+//  before the volume is applied
+static inline int GetChannelSample(const unsigned char *data, unsigned int bits,
+                                   unsigned int stepremainder)
+{
+  // linear filtering
+  // the old SRC did linear interpolation back into 8 bit, and then expanded to 16 bit.
+  // this does interpolation and 8->16 at same time, allowing slightly higher quality
+  if (bits == 16)
+  {
+    return (short)(data[0] | (data[1] << 8)) * (255 - (stepremainder >> 8))
+         + (short)(data[2] | (data[3] << 8)) * (stepremainder >> 8);
+  }
+  else
+  {
+    return ((unsigned int)data[0] * (0x10000 - stepremainder))
+         + ((unsigned int)data[1] * (stepremainder))
+         - 0x800000; // convert to signed
+  }
+}
 
-#define WAV_DATA_HASH_SIZE 32
-static wav_data_t *wav_data_hash[WAV_DATA_HASH_SIZE];
+//
+// Fast mixer data
+//
+// Without pitch shifting, a sound always advances by the same step, so
+// the interpolated samples the mixer would compute are the same every
+// time the sound plays. They are computed once and kept in the sound
+// cache, and the channels then only apply their volume. The result is
+// identical to interpolating while mixing.
+//
+
+typedef struct mix_data_s
+{
+  int *samples;
+  int length;
+  // step remainder after the last sample, to continue looping sounds
+  unsigned int endremainder;
+} mix_data_t;
+
+// Longer sounds are mixed from the source
+#define MIX_DATA_MAX_SECONDS 30
+
+//
+// Sound cache
+//
+// Everything decoded from a sound lump: where its samples are and in
+// what format, the wav buffer if it was a wav, and the fast mixer data.
+// Entries are keyed by lump, so sfx that share a lump share an entry.
+// Once snd_cache_size is exceeded, the least recently used entries are
+// freed, but never while the mixer may still be reading them.
+//
+// Level load decodes the sounds the level is likely to play on a
+// background thread. Only that thread and the game thread touch the
+// entries, and an entry belongs to whichever claims it first until it's
+// ready. The cache list and lookup table belong to the game thread.
+// Buffers use SDL_malloc, because the zone isn't thread safe.
+//
 
-static wav_data_t *GetWavData(int sfxid, const unsigned char *data, size_t len)
+enum
 {
-  int key;
-  wav_data_t *target = NULL;
+  sound_cache_pending,
+  sound_cache_working,
+  sound_cache_ready,
+};
 
-  key = (sfxid % WAV_DATA_HASH_SIZE);
+typedef struct sound_cache_s
+{
+  int lump;
+  SDL_atomic_t state;
 
-  if (wav_data_hash[key])
+  const unsigned char *data;
+  size_t len;
+  sfx_source_t source;
+  Uint8 *wav;
+
+  dboolean mix_done;
+  mix_data_t mix;
+
+  int size;
+  char warning[80];
+
+  // The last sound started from this entry on each channel
+  int serial[MAX_CHANNELS];
+
+  // most recently used first
+  struct sound_cache_s *prev;
+  struct sound_cache_s *next;
+} sound_cache_t;
+
+static sound_cache_t **sound_cache_lumps;
+static int sound_cache_lump_count;
+static sound_cache_t *sound_cache_head;
+static sound_cache_t *sound_cache_tail;
+static SDL_atomic_t sound_cache_bytes;
+
+static SDL_Thread *sound_cache_warm_thread;
+static SDL_atomic_t sound_cache_warm_done;
+static sound_cache_t **sound_cache_warm_list;
+static int sound_cache_warm_count;
+static dboolean sound_cache_warm_mix;
+
+static void DecodeWav(sound_cache_t *entry)
+{
+  SDL_RWops *RWops;
+  SDL_AudioSpec wav_spec;
+  Uint8 *wav_buffer = NULL;
+  Uint32 samplelen;
+  int bits;
+
+  RWops = SDL_RWFromConstMem(entry->data, entry->len);
+
+  if (SDL_LoadWAV_RW(RWops, 1, &wav_spec, &wav_buffer, &samplelen) == NULL)
   {
-    wav_data_t *rover = wav_data_hash[key];
+    snprintf(entry->warning, sizeof(entry->warning), "Could not open wav file: %s\n", SDL_GetError());
+    return;
+  }
 
-    while (rover)
-    {
-      if (rover->sfxid == sfxid)
-      {
-        target = rover;
-        break;
-      }
+  if (wav_spec.channels != 1)
+  {
+    snprintf(entry->warning, sizeof(entry->warning), "Only mono WAV file is supported");
+    SDL_FreeWAV(wav_buffer);
+    return;
+  }
 
-      rover = rover->next;
-    }
+  if (!SDL_AUDIO_ISINT(wav_spec.format))
+  {
+    snprintf(entry->warning, sizeof(entry->warning), "WAV file in unsupported format");
+    SDL_FreeWAV(wav_buffer);
+    return;
   }
 
-  if (target == NULL &&
-      len > 44 && !memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVEfmt ", 8))
+  bits = SDL_AUDIO_BITSIZE(wav_spec.format);
+  if (bits != 8 && bits != 16)
   {
-    SDL_RWops *RWops;
-    SDL_AudioSpec wav_spec;
-    Uint8 *wav_buffer = NULL;
-    int bits, samplelen;
+    snprintf(entry->warning, sizeof(entry->warning), "Only 8 or 16 bit WAV files are supported");
+    SDL_FreeWAV(wav_buffer);
+    return;
+  }
 
-    RWops = SDL_RWFromConstMem(data, len);
+  entry->wav = wav_buffer;
+  entry->source.data = wav_buffer;
+  entry->source.enddata = wav_buffer + samplelen - 1;
+  entry->source.samplerate = wav_spec.freq;
+  entry->source.bits = bits;
+  SDL_AtomicAdd(&sound_cache_bytes, samplelen);
+}
 
-    if (SDL_LoadWAV_RW(RWops, 1, &wav_spec, &wav_buffer, &samplelen) == NULL)
-    {
-      lprintf(LO_WARN, "Could not open wav file: %s\n", SDL_GetError());
-      return NULL;
-    }
+static void DecodeMixData(sound_cache_t *entry)
+{
+  const sfx_source_t *source = &entry->source;
+  mix_data_t *mix = &entry->mix;
+  const unsigned char *pos;
+  unsigned int step, stepremainder;
+  int bytes, length;
 
-    if (wav_spec.channels != 1)
-    {
-      lprintf(LO_WARN, "Only mono WAV file is supported");
-      SDL_FreeWAV(wav_buffer);
-      return NULL;
-    }
+  entry->mix_done = true;
 
-    if (!SDL_AUDIO_ISINT(wav_spec.format))
-    {
-      lprintf(LO_WARN, "WAV file in unsupported format");
-      SDL_FreeWAV(wav_buffer);
-      return NULL;
-    }
+  step = (source->samplerate << 16) / snd_samplerate;
+  bytes = source->bits / 8;
+
+  if (!step)
+    return;
+
+  // Walk the sound exactly like the mixer does
+  length = 0;
+  pos = source->data;
+  stepremainder = 0;
+  do
+  {
+    ++length;
+    stepremainder += step;
+    pos += (stepremainder >> 16) * bytes;
+    stepremainder &= 0xffff;
+  } while (pos < source->enddata && length < MIX_DATA_MAX_SECONDS * snd_samplerate);
+
+  if (pos < source->enddata)
+    return;
+
+  mix->samples = SDL_malloc(length * sizeof(*mix->samples));
+  if (!mix->samples)
+    return;
+
+  mix->length = length;
+
+  length = 0;
+  pos = source->data;
+  stepremainder = 0;
+  do
+  {
+    mix->samples[length++] = GetChannelSample(pos, source->bits, stepremainder);
+    stepremainder += step;
+    pos += (stepremainder >> 16) * bytes;
+    stepremainder &= 0xffff;
+  } while (pos < source->enddata);
+
+  mix->endremainder = stepremainder;
+  SDL_AtomicAdd(&sound_cache_bytes, length * sizeof(*mix->samples));
+}
+
+// Runs on either thread, for an entry it has claimed
+static void DecodeSoundCache(sound_cache_t *entry, dboolean mix)
+{
+  const unsigned char *data = entry->data;
+  size_t len = entry->len;
 
-    bits = SDL_AUDIO_BITSIZE(wav_spec.format);
-    if (bits != 8 && bits != 16)
+  if (len > 44 && !memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVEfmt ", 8))
+    DecodeWav(entry);
+
+  if (!entry->wav)
+  {
+    entry->source.data = data;
+    /* Set pointer to end of raw data. */
+    entry->source.enddata = data + len - 1;
+    entry->source.samplerate = (data[3] << 8) + data[2];
+    entry->source.data += 8; /* Skip header */
+    entry->source.bits = 8;
+  }
+
+  if (mix)
+    DecodeMixData(entry);
+}
+
+static dboolean ClaimSoundCache(sound_cache_t *entry)
+{
+  return SDL_AtomicCAS(&entry->state, sound_cache_pending, sound_cache_working);
+}
+
+static void FinishSoundCache(sound_cache_t *entry)
+{
+  entry->size = (entry->wav ? (int) (entry->source.enddata - entry->source.data + 1) : 0) +
+                entry->mix.length * (int) sizeof(*entry->mix.samples);
+
+  // The entry must be complete before the other thread can see it
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&entry->state, sound_cache_ready);
+}
+
+static int SoundCacheWarmThread(void *unused)
+{
+  int i;
+
+  for (i = 0; i < sound_cache_warm_count; i++)
+  {
+    sound_cache_t *entry = sound_cache_warm_list[i];
+
+    if (ClaimSoundCache(entry))
     {
-      lprintf(LO_WARN, "Only 8 or 16 bit WAV files are supported");
-      SDL_FreeWAV(wav_buffer);
-      return NULL;
+      DecodeSoundCache(entry, sound_cache_warm_mix);
+      FinishSoundCache(entry);
     }
+  }
 
-    target = Z_Malloc(sizeof(*target));
+  SDL_AtomicSet(&sound_cache_warm_done, 1);
 
-    target->sfxid = sfxid;
-    target->data = wav_buffer;
-    target->samplelen = samplelen;
-    target->samplerate = wav_spec.freq;
-    target->bits = bits;
+  return 0;
+}
 
-    // use head insertion
-    target->next = wav_data_hash[key];
-    wav_data_hash[key] = target;
+static void WaitSoundCacheWarmThread(void)
+{
+  if (sound_cache_warm_thread)
+  {
+    SDL_WaitThread(sound_cache_warm_thread, NULL);
+    sound_cache_warm_thread = NULL;
   }
+}
 
-  return target;
+static void LinkSoundCache(sound_cache_t *entry)
+{
+  entry->prev = NULL;
+  entry->next = sound_cache_head;
+  if (sound_cache_head)
+    sound_cache_head->prev = entry;
+  else
+    sound_cache_tail = entry;
+  sound_cache_head = entry;
 }
 
-//
-// This function adds a sound to the
-//  list of currently active sounds,
-//  which is maintained as a given number
-//  (eight, usually) of internal channels.
-// Returns a handle.
-//
-static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
+static void UnlinkSoundCache(sound_cache_t *entry)
 {
-  channel_info_t *ci = channelinfo + channel;
-  wav_data_t *wav_data = GetWavData(sfxid, data, len);
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    sound_cache_head = entry->next;
+
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    sound_cache_tail = entry->prev;
+}
 
-  stopchan(channel);
+// The mixer reports each serial it is done with, in order
+static dboolean SoundCacheInUse(const sound_cache_t *entry)
+{
+  int i;
 
-  if (wav_data)
+  for (i = 0; i < MAX_CHANNELS; i++)
+    if (entry->serial[i] > SDL_AtomicGet(&channel_finished[i]))
+      return true;
+
+  return false;
+}
+
+static void FreeSoundCache(sound_cache_t *entry)
+{
+  UnlinkSoundCache(entry);
+  sound_cache_lumps[entry->lump] = NULL;
+
+  SDL_AtomicAdd(&sound_cache_bytes, -entry->size);
+
+  if (entry->wav)
+    SDL_FreeWAV(entry->wav);
+  SDL_free(entry->mix.samples);
+  Z_Free(entry);
+}
+
+static void TrimSoundCache(void)
+{
+  int budget = snd_cache_size << 20;
+  sound_cache_t *entry, *prev;
+
+  // Entries may still be in the warm list
+  if (sound_cache_warm_thread)
+  {
+    if (!SDL_AtomicGet(&sound_cache_warm_done))
+      return;
+
+    WaitSoundCacheWarmThread();
+  }
+
+  for (entry = sound_cache_tail; entry && SDL_AtomicGet(&sound_cache_bytes) > budget; entry = prev)
+  {
+    prev = entry->prev;
+
+    if (!SoundCacheInUse(entry))
+      FreeSoundCache(entry);
+  }
+}
+
+static sound_cache_t *NewSoundCache(int lump, const unsigned char *data, size_t len)
+{
+  sound_cache_t *entry;
+
+  if (lump >= sound_cache_lump_count)
+  {
+    sound_cache_lumps = Z_Realloc(sound_cache_lumps, numlumps * sizeof(*sound_cache_lumps));
+    memset(sound_cache_lumps + sound_cache_lump_count, 0,
+           (numlumps - sound_cache_lump_count) * sizeof(*sound_cache_lumps));
+    sound_cache_lump_count = numlumps;
+  }
+
+  entry = Z_Calloc(1, sizeof(*entry));
+  entry->lump = lump;
+  entry->data = data;
+  entry->len = len;
+  SDL_AtomicSet(&entry->state, sound_cache_pending);
+
+  sound_cache_lumps[lump] = entry;
+  LinkSoundCache(entry);
+
+  return entry;
+}
+
+static sound_cache_t *GetSoundCache(int lump, const unsigned char *data, size_t len, dboolean mix)
+{
+  sound_cache_t *entry = NULL;
+
+  if (lump < sound_cache_lump_count)
+    entry = sound_cache_lumps[lump];
+
+  if (!entry)
+    entry = NewSoundCache(lump, data, len);
+
+  if (ClaimSoundCache(entry))
   {
-    ci->data = wav_data->data;
-    ci->enddata = ci->data + wav_data->samplelen - 1;
-    ci->samplerate = wav_data->samplerate;
-    ci->bits = wav_data->bits;
+    DecodeSoundCache(entry, mix);
+    FinishSoundCache(entry);
   }
   else
   {
-    ci->data = data;
-    /* Set pointer to end of raw data. */
-    ci->enddata = ci->data + len - 1;
-    ci->samplerate = (ci->data[3] << 8) + ci->data[2];
-    ci->data += 8; /* Skip header */
-    ci->bits = 8;
+    // the warm thread is decoding it
+    while (SDL_AtomicGet(&entry->state) != sound_cache_ready)
+      SDL_Delay(0);
+
+    SDL_MemoryBarrierAcquire();
   }
 
-  ci->stepremainder = 0;
-  // Should be gametic, I presume.
-  ci->starttime = gametic;
+  if (entry->warning[0])
+  {
+    lprintf(LO_WARN, "%s", entry->warning);
+    entry->warning[0] = '\0';
+  }
 
-  ci->startdata = ci->data;
+  // decoded while the fast mixer was off
+  if (mix && !entry->mix_done)
+  {
+    DecodeMixData(entry);
+    FinishSoundCache(entry);
+  }
 
-  // Preserve sound SFX id,
-  //  e.g. for avoiding duplicates of chainsaw.
-  ci->id = sfxid;
+  if (entry != sound_cache_head)
+  {
+    UnlinkSoundCache(entry);
+    LinkSoundCache(entry);
+  }
 
-  return channel;
+  return entry;
+}
+
+void I_PrecacheSounds(const int *sfx_ids, int count)
+{
+  int i;
+
+  if (nosfxparm || snd_pcspeaker || !count)
+    return;
+
+  WaitSoundCacheWarmThread();
+
+  sound_cache_warm_list = Z_Realloc(sound_cache_warm_list, count * sizeof(*sound_cache_warm_list));
+  sound_cache_warm_count = 0;
+  sound_cache_warm_mix = !snd_reference_mixer && !pitched_sounds;
+
+  for (i = 0; i < count; i++)
+  {
+    int lump = S_sfx[sfx_ids[i]].lumpnum;
+    size_t len;
+
+    if (lump < 0 || (lump < sound_cache_lump_count && sound_cache_lumps[lump]))
+      continue;
+
+    len = W_LumpLength(lump);
+    if (len <= 8)
+      continue;
+
+    sound_cache_warm_list[sound_cache_warm_count++] =
+      NewSoundCache(lump, (const unsigned char *) W_LockLumpNum(lump), len - 8);
+  }
+
+  if (!sound_cache_warm_count)
+    return;
+
+  SDL_AtomicSet(&sound_cache_warm_done, 0);
+  sound_cache_warm_thread = SDL_CreateThread(SoundCacheWarmThread, "sound_cache_warm_thread", NULL);
+
+  // Whatever wasn't decoded will be on first use
+  if (!sound_cache_warm_thread)
+    lprintf(LO_WARN, "I_PrecacheSounds: %s\n", SDL_GetError());
 }
 
 static int getSliceSize(void)
@@ -319,22 +663,183 @@ static int getSliceSize(void)
   return 1024;
 }
 
-static void updateSoundParams(int handle, sfx_params_t *params)
+//
+// Sound commands
+//
+// Starting, stopping and updating a sound only queues a command.
+// The mixer applies the queued commands before each block, so the game
+// thread never touches channelinfo and the two threads never wait for
+// each other. There is one producer (the game thread) and one consumer
+// (the mixer), so the queue needs no locks.
+//
+
+typedef enum
 {
-  int slot = handle;
-  int rightvol;
+  sound_command_start,
+  sound_command_stop,
+  sound_command_params,
+} sound_command_type_t;
+
+typedef struct
+{
+  sound_command_type_t type;
+  int channel;
+
+  // start
+  int sfxid;
+  int serial;
+  int starttime;
+  sfx_source_t source;
+  const mix_data_t *mixdata;
+
+  // start and params
+  int step;
   int leftvol;
-  int step = steptable[params->pitch];
+  int rightvol;
+  dboolean loop;
+} sound_command_t;
 
-#ifdef RANGECHECK
-  if ((handle < 0) || (handle >= MAX_CHANNELS))
-    I_Error("I_UpdateSoundParams: handle out of range");
-#endif
+// Must be a power of two
+#define SOUND_COMMAND_QUEUE_SIZE 1024
 
-  if (snd_pcspeaker)
-    return;
+static sound_command_t sound_commands[SOUND_COMMAND_QUEUE_SIZE];
+// Next slot to write, only changed by the game thread
+static SDL_atomic_t sound_command_head;
+// Next slot to read, only changed by the mixer
+static SDL_atomic_t sound_command_tail;
+
+static int sound_command_peak;
+static int sound_command_dropped;
+
+static int SoundCommandDepth(void)
+{
+  return (SDL_AtomicGet(&sound_command_head) - SDL_AtomicGet(&sound_command_tail)) &
+         (SOUND_COMMAND_QUEUE_SIZE - 1);
+}
+
+// Returns false if the queue is full and the command was dropped
+static dboolean PushSoundCommand(const sound_command_t *command)
+{
+  int head = SDL_AtomicGet(&sound_command_head);
+  int next = (head + 1) & (SOUND_COMMAND_QUEUE_SIZE - 1);
+  int depth;
+
+  if (next == SDL_AtomicGet(&sound_command_tail))
+  {
+    if (!sound_command_dropped++)
+      lprintf(LO_WARN, "PushSoundCommand: sound command queue is full\n");
+
+    return false;
+  }
+
+  // The mixer must be done with the slot before it is overwritten
+  SDL_MemoryBarrierAcquire();
+  sound_commands[head] = *command;
+
+  // The command must be complete before the mixer can see it
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&sound_command_head, next);
+
+  depth = SoundCommandDepth();
+  if (depth > sound_command_peak)
+    sound_command_peak = depth;
+
+  return true;
+}
 
-  channelinfo[slot].loop = params->loop;
+void I_GetSoundQueueStats(sound_queue_stats_t *stats)
+{
+  stats->depth = SoundCommandDepth();
+  stats->peak = sound_command_peak;
+  stats->dropped = sound_command_dropped;
+}
+
+//
+// This function adds a sound to the
+//  list of currently active sounds,
+//  which is maintained as a given number
+//  (eight, usually) of internal channels.
+//
+static void addsfx(const sound_command_t *command)
+{
+  channel_info_t *ci = channelinfo + command->channel;
+
+  stopchan(command->channel);
+
+  ci->data = command->source.data;
+  ci->enddata = command->source.enddata;
+  ci->samplerate = command->source.samplerate;
+  ci->bits = command->source.bits;
+
+  ci->mixdata = command->mixdata;
+  ci->mixpos = 0;
+
+  ci->stepremainder = 0;
+  // Should be gametic, I presume.
+  ci->starttime = command->starttime;
+
+  ci->startdata = ci->data;
+
+  // Preserve sound SFX id,
+  //  e.g. for avoiding duplicates of chainsaw.
+  ci->id = command->sfxid;
+
+  ci->serial = command->serial;
+}
+
+static void updateSoundParams(const sound_command_t *command)
+{
+  channel_info_t *ci = channelinfo + command->channel;
+
+  ci->step = command->step;
+  ci->leftvol = command->leftvol;
+  ci->rightvol = command->rightvol;
+  ci->loop = command->loop;
+}
+
+// Runs on the mixer thread
+static void RunSoundCommands(void)
+{
+  int tail = SDL_AtomicGet(&sound_command_tail);
+  int head = SDL_AtomicGet(&sound_command_head);
+
+  SDL_MemoryBarrierAcquire();
+
+  while (tail != head)
+  {
+    const sound_command_t *command = &sound_commands[tail];
+
+    switch (command->type)
+    {
+      case sound_command_start:
+        addsfx(command);
+        updateSoundParams(command);
+        break;
+      case sound_command_stop:
+        stopchan(command->channel);
+        break;
+      case sound_command_params:
+        updateSoundParams(command);
+        break;
+    }
+
+    tail = (tail + 1) & (SOUND_COMMAND_QUEUE_SIZE - 1);
+  }
+
+  // The slots can be reused once the commands have been applied
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&sound_command_tail, tail);
+}
+
+// Converts the sound params to what the mixer needs
+static void GetSoundParams(int handle, sfx_params_t *params, sound_command_t *command)
+{
+  unsigned int samplerate = channel_samplerate[handle];
+  int rightvol;
+  int leftvol;
+  int step = steptable[params->pitch];
+
+  command->loop = params->loop;
 
   // Set stepping
   // MWM 2000-12-24: Calculates proportion of channel samplerate
@@ -342,9 +847,9 @@ static void updateSoundParams(int handle, sfx_params_t *params)
   // Patched to shift left *then* divide, to minimize roundoff errors
   // as well as to use SAMPLERATE as defined above, not to assume 11025 Hz
   if (pitched_sounds)
-    channelinfo[slot].step = step + (((channelinfo[slot].samplerate << 16) / snd_samplerate) - 65536);
+    command->step = step + (((samplerate << 16) / snd_samplerate) - 65536);
   else
-    channelinfo[slot].step = ((channelinfo[slot].samplerate << 16) / snd_samplerate);
+    command->step = ((samplerate << 16) / snd_samplerate);
 
   // Separation, that is, orientation/stereo.
   //  range is: 1 - 256
@@ -372,15 +877,27 @@ static void updateSoundParams(int handle, sfx_params_t *params)
 
   // Get the proper lookup table piece
   //  for this volume level???
-  channelinfo[slot].leftvol = leftvol;
-  channelinfo[slot].rightvol = rightvol;
+  command->leftvol = leftvol;
+  command->rightvol = rightvol;
 }
 
 void I_UpdateSoundParams(int handle, sfx_params_t *params)
 {
-  SDL_LockMutex (sfxmutex);
-  updateSoundParams(handle, params);
-  SDL_UnlockMutex (sfxmutex);
+  sound_command_t command;
+
+#ifdef RANGECHECK
+  if ((handle < 0) || (handle >= MAX_CHANNELS))
+    I_Error("I_UpdateSoundParams: handle out of range");
+#endif
+
+  if (snd_pcspeaker)
+    return;
+
+  command.type = sound_command_params;
+  command.channel = handle;
+  GetSoundParams(handle, params, &command);
+
+  PushSoundCommand(&command);
 }
 
 //
@@ -399,6 +916,7 @@ void I_SetChannels(void)
   //  the mixing process.
   int   i;
   //int   j;
+  sound_cache_t *entry;
 
   int  *steptablemid = steptable + 128;
 
@@ -406,8 +924,17 @@ void I_SetChannels(void)
   for (i = 0; i < MAX_CHANNELS; i++)
   {
     memset(&channelinfo[i], 0, sizeof(channel_info_t));
+
+    channel_serial[i] = 0;
+    channel_stopped[i] = false;
+    channel_samplerate[i] = 0;
+    SDL_AtomicSet(&channel_finished[i], 0);
   }
 
+  // The serials start over
+  for (entry = sound_cache_head; entry; entry = entry->next)
+    memset(entry->serial, 0, sizeof(entry->serial));
+
   // This table provides step widths for pitch parameters.
   // I fail to see that this is currently used.
   for (i = -128 ; i < 128 ; i++)
@@ -463,6 +990,9 @@ int I_GetSfxLumpNum(sfxinfo_t *sfx)
 int I_StartSound(int id, int channel, sfx_params_t *params)
 {
   const unsigned char *data;
+  sound_command_t command;
+  sound_cache_t *cache;
+  dboolean mix;
   int lump;
   size_t len;
 
@@ -494,15 +1024,30 @@ int I_StartSound(int id, int channel, sfx_params_t *params)
   // not in a memory mapped one
   data = (const unsigned char *)W_LockLumpNum(lump);
 
-  SDL_LockMutex (sfxmutex);
-
-  // Returns a handle (not used).
-  addsfx(id, channel, data, len);
-  updateSoundParams(channel, params);
+  // Everything that can allocate happens here, not on the mixer thread
+  command.type = sound_command_start;
+  command.channel = channel;
+  command.sfxid = id;
+  command.serial = channel_serial[channel] + 1;
+  command.starttime = gametic;
+  mix = !snd_reference_mixer && !pitched_sounds;
+  cache = GetSoundCache(lump, data, len, mix);
+  command.source = cache->source;
+  command.mixdata = mix && cache->mix.samples ? &cache->mix : NULL;
+
+  channel_samplerate[channel] = command.source.samplerate;
+  GetSoundParams(channel, params, &command);
+
+  if (!PushSoundCommand(&command))
+    return -1;
 
-  SDL_UnlockMutex (sfxmutex);
+  channel_serial[channel] = command.serial;
+  channel_stopped[channel] = false;
+  cache->serial[channel] = command.serial;
 
+  TrimSoundCache();
 
+  // Returns a handle (not used).
   return channel;
 }
 
@@ -510,6 +1055,8 @@ int I_StartSound(int id, int channel, sfx_params_t *params)
 
 void I_StopSound (int handle)
 {
+  sound_command_t command;
+
 #ifdef RANGECHECK
   if ((handle < 0) || (handle >= MAX_CHANNELS))
     I_Error("I_StopSound: handle out of range");
@@ -521,9 +1068,12 @@ void I_StopSound (int handle)
     return;
   }
 
-  SDL_LockMutex (sfxmutex);
-  stopchan(handle);
-  SDL_UnlockMutex (sfxmutex);
+  command.type = sound_command_stop;
+  command.channel = handle;
+
+  // The channel counts as stopped even if the command is dropped
+  PushSoundCommand(&command);
+  channel_stopped[handle] = true;
 }
 
 
@@ -537,7 +1087,8 @@ dboolean I_SoundIsPlaying(int handle)
   if (snd_pcspeaker)
     return I_PCS_SoundIsPlaying(handle);
 
-  return channelinfo[handle].data != NULL;
+  return !channel_stopped[handle] &&
+         SDL_AtomicGet(&channel_finished[handle]) != channel_serial[handle];
 }
 
 
@@ -550,7 +1101,7 @@ dboolean I_AnySoundStillPlaying(void)
     return false;
 
   for (i = 0; i < MAX_CHANNELS; i++)
-    result |= channelinfo[i].data != NULL;
+    result |= I_SoundIsPlaying(i);
 
   return result;
 }
@@ -569,27 +1120,189 @@ dboolean I_AnySoundStillPlaying(void)
 //
 
 static void UpdateMusic (void *buff, unsigned nsamp);
+static dboolean ReadMusicStream (void *buff, unsigned nsamp);
 
 // from pcsound_sdl.c
 void PCSound_Mix_Callback(void *udata, Uint8 *stream, int len);
 
-static void I_UpdateSound(void *unused, Uint8 *stream, int len)
+#define MIX_BLOCK_SIZE 512
+
+static int mix_left[MIX_BLOCK_SIZE];
+static int mix_right[MIX_BLOCK_SIZE];
+
+// Interpolates while mixing, as the original mixer did.
+// Used for pitched and looping sounds and by the reference mixer.
+static void MixChannel(int chan, int *left, int *right, int count)
 {
-  // Mix current sound data.
-  // Data, from raw sound, for right and left.
-  // register unsigned char sample;
-  register int    dl;
-  register int    dr;
+  channel_info_t *ci = channelinfo + chan;
+  int i;
+
+  for (i = 0; i < count && ci->data; i++)
+  {
+    int s = GetChannelSample(ci->data, ci->bits, ci->stepremainder);
+
+    // Add left and right part
+    //  for this channel (sound)
+    //  to the current data.
+    // Adjust volume accordingly.
+
+    // full loudness (vol=127) is actually 127/191
+
+    left[i] += ci->leftvol * s / 49152;  // >> 15;
+    right[i] += ci->rightvol * s / 49152; // >> 15;
 
-  // Pointers in audio stream, left, right, end.
-  signed short   *leftout;
-  signed short   *rightout;
-  signed short   *leftend;
-  // Step in stream, left and right, thus two.
-  int       step;
+    // Increment index ???
+    ci->stepremainder += ci->step;
+
+    // MSB is next sample???
+    if (ci->bits == 16)
+      ci->data += (ci->stepremainder >> 16) * 2;
+    else
+      ci->data += ci->stepremainder >> 16;
+
+    // Limit to LSB???
+    ci->stepremainder &= 0xffff;
+
+    // Check whether we are done.
+    if (ci->data >= ci->enddata)
+    {
+      if (ci->loop)
+        ci->data = ci->startdata;
+      else
+        stopchan(chan);
+    }
+  }
+}
+
+// Applies the volume to pre-resampled data.
+// The loop has no branches so that the compiler can vectorize it.
+static void MixFastChannel(int chan, int *left, int *right, int count)
+{
+  channel_info_t *ci = channelinfo + chan;
+  const mix_data_t *mix_data = ci->mixdata;
+  const int *samples = mix_data->samples + ci->mixpos;
+  int leftvol = ci->leftvol;
+  int rightvol = ci->rightvol;
+  int i, n;
+
+  n = MIN(count, mix_data->length - ci->mixpos);
+
+  for (i = 0; i < n; i++)
+  {
+    left[i] += leftvol * samples[i] / 49152;
+    right[i] += rightvol * samples[i] / 49152;
+  }
+
+  ci->mixpos += n;
+
+  if (ci->mixpos == mix_data->length)
+  {
+    if (ci->loop)
+    {
+      // Continue from the source, where the mixer would be after the wrap
+      ci->mixdata = NULL;
+      ci->data = ci->startdata;
+      ci->stepremainder = mix_data->endremainder;
+      MixChannel(chan, left + n, right + n, count - n);
+    }
+    else
+      stopchan(chan);
+  }
+}
+
+// Audio callback records, written only by the callback and read by the
+//  game thread. A record can be read while it is being written, which is
+//  fine for statistics.
+#define CALLBACK_RECORDS 64
+
+typedef struct
+{
+  Uint64 mix;
+  Uint64 spacing;
+  Uint64 music;
+  int channels;
+} callback_record_t;
+
+static callback_record_t callback_records[CALLBACK_RECORDS];
+static SDL_atomic_t callback_count;
+static SDL_atomic_t callback_underruns;
+static SDL_atomic_t callback_slice;
+static Uint64 callback_last_start;
+
+// Filled in by MixSound for the callback being recorded
+static Uint64 callback_music;
+static int callback_channels;
+
+static void RecordSoundCallback(Uint64 start, int slice)
+{
+  Uint64 end = SDL_GetPerformanceCounter();
+  int count = SDL_AtomicGet(&callback_count);
+  callback_record_t *record = &callback_records[count % CALLBACK_RECORDS];
+
+  record->mix = end - start;
+  record->spacing = callback_last_start ? start - callback_last_start : 0;
+  record->music = callback_music;
+  record->channels = callback_channels;
+
+  // Compare the spacing to the slice the device asked for, which is
+  //  getSliceSize() unless the device picked something else
+  if (record->spacing * 2 * snd_samplerate > (Uint64) slice * 3 * SDL_GetPerformanceFrequency())
+    SDL_AtomicAdd(&callback_underruns, 1);
+
+  callback_last_start = start;
+  SDL_AtomicSet(&callback_slice, slice);
+  SDL_AtomicSet(&callback_count, count + 1);
+}
+
+void I_GetSoundCallbackStats(sound_callback_stats_t *stats)
+{
+  double ms = 1000.0 / SDL_GetPerformanceFrequency();
+  int count = SDL_AtomicGet(&callback_count);
+  int i;
+
+  memset(stats, 0, sizeof(*stats));
+
+  stats->callbacks = MIN(count, CALLBACK_RECORDS);
+  stats->underruns = SDL_AtomicGet(&callback_underruns);
+  if (snd_samplerate)
+    stats->slice_ms = 1000.0f * SDL_AtomicGet(&callback_slice) / snd_samplerate;
+
+  if (!stats->callbacks)
+    return;
+
+  for (i = 0; i < stats->callbacks; i++)
+  {
+    const callback_record_t *record = &callback_records[(count - 1 - i) % CALLBACK_RECORDS];
+    float mix = (float) (record->mix * ms);
+    float spacing = (float) (record->spacing * ms);
+    float music = (float) (record->music * ms);
+
+    stats->mix_ms += mix;
+    stats->spacing_ms += spacing;
+    stats->music_ms += music;
+    stats->channels += record->channels;
+
+    stats->mix_ms_max = MAX(stats->mix_ms_max, mix);
+    stats->spacing_ms_max = MAX(stats->spacing_ms_max, spacing);
+    stats->music_ms_max = MAX(stats->music_ms_max, music);
+    stats->channels_max = MAX(stats->channels_max, record->channels);
+  }
+
+  stats->mix_ms /= stats->callbacks;
+  stats->spacing_ms /= stats->callbacks;
+  stats->music_ms /= stats->callbacks;
+  stats->channels = (stats->channels + stats->callbacks / 2) / stats->callbacks;
+}
+
+static void MixSound(void *unused, Uint8 *stream, int len)
+{
+  // Pointer in audio stream, left and right alternating.
+  signed short *out;
+  int remaining;
 
   // Mixing channel index.
-  int       chan;
+  int chan;
+  Uint64 music_start;
 
   if (snd_midiplayer == NULL) // This is but a temporary fix. Please do remove after a more definitive one!
     memset(stream, 0, len);
@@ -600,12 +1313,17 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
     return;
 
   // do music update
-  if (registered_non_rw)
+  // The game thread only holds the lock to switch songs or players,
+  //  skip the music for this slice instead of waiting for it
+  music_start = SDL_GetPerformanceCounter();
+  if (registered_non_rw && !ReadMusicStream (stream, len / 4) &&
+      SDL_TryLockMutex (musmutex) == 0)
   {
-    SDL_LockMutex (musmutex);
     UpdateMusic (stream, len / 4);
     SDL_UnlockMutex (musmutex);
   }
+  callback_music = SDL_GetPerformanceCounter() - music_start;
+  callback_channels = 0;
 
   if (snd_pcspeaker)
   {
@@ -614,155 +1332,97 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
     return;
   }
 
-  SDL_LockMutex (sfxmutex);
-  // Left and right channel
-  //  are in audio stream, alternating.
-  leftout = (signed short *)stream;
-  rightout = ((signed short *)stream) + 1;
-  step = 2;
-
-  // Determine end, for left channel only
-  //  (right channel is implicit).
-  leftend = leftout + (len / 4) * step;
-
-  // Mix sounds into the mixing buffer.
-  // Loop over step*SAMPLECOUNT,
-  //  that is 512 values for two channels.
-  while (leftout != leftend)
-  {
-    // Reset left/right value.
-    //dl = 0;
-    //dr = 0;
-    dl = *leftout;
-    dr = *rightout;
-
-    // Love thy L2 chache - made this a loop.
-    // Now more channels could be set at compile time
-    //  as well. Thus loop those  channels.
-    for ( chan = 0; chan < numChannels; chan++ )
-    {
-      channel_info_t *ci = channelinfo + chan;
-
-      // Check channel, if active.
-      if (ci->data)
-      {
-        int s;
-        // Get the raw data from the channel.
-        // no filtering
-        //int s = channelinfo[chan].data[0] * 0x10000 - 0x800000;
-
-        // linear filtering
-        // the old SRC did linear interpolation back into 8 bit, and then expanded to 16 bit.
-        // this does interpolation and 8->16 at same time, allowing slightly higher quality
-        if (ci->bits == 16)
-        {
-          s = (short)(ci->data[0] | (ci->data[1] << 8)) * (255 - (ci->stepremainder >> 8))
-            + (short)(ci->data[2] | (ci->data[3] << 8)) * (ci->stepremainder >> 8);
-        }
-        else
-        {
-          s = ((unsigned int)ci->data[0] * (0x10000 - ci->stepremainder))
-            + ((unsigned int)ci->data[1] * (ci->stepremainder))
-            - 0x800000; // convert to signed
-        }
-
-
-        // Add left and right part
-        //  for this channel (sound)
-        //  to the current data.
-        // Adjust volume accordingly.
-
-        // full loudness (vol=127) is actually 127/191
+  out = (signed short *)stream;
+  remaining = len / 4;
 
-        dl += ci->leftvol * s / 49152;  // >> 15;
-        dr += ci->rightvol * s / 49152; // >> 15;
+  // Mix sounds into the mixing buffer one block at a time.
+  // Channels are summed in full integer precision before clamping,
+  //  so the order they are mixed in does not change the result.
+  while (remaining > 0)
+  {
+    int count = MIN(remaining, MIX_BLOCK_SIZE);
+    int i;
 
-        // Increment index ???
-        ci->stepremainder += ci->step;
+    RunSoundCommands();
 
-        // MSB is next sample???
-        if (ci->bits == 16)
-          ci->data += (ci->stepremainder >> 16) * 2;
-        else
-          ci->data += ci->stepremainder >> 16;
+    for (i = 0; i < count; i++)
+    {
+      mix_left[i] = out[i * 2];
+      mix_right[i] = out[i * 2 + 1];
+    }
 
-        // Limit to LSB???
-        ci->stepremainder &= 0xffff;
+    for (chan = 0; chan < numChannels; chan++)
+    {
+      if (channelinfo[chan].mixdata)
+        MixFastChannel(chan, mix_left, mix_right, count);
+      else if (channelinfo[chan].data)
+        MixChannel(chan, mix_left, mix_right, count);
+      else
+        continue;
+
+      if (remaining == len / 4)
+        callback_channels++;
+    }
 
-        // Check whether we are done.
-        if (ci->data >= ci->enddata)
-        {
-          if (ci->loop)
-            ci->data = ci->startdata;
-          else
-            stopchan(chan);
-        }
-      }
+    // Clamp to range.
+    for (i = 0; i < count; i++)
+    {
+      out[i * 2] = BETWEEN(SHRT_MIN, SHRT_MAX, mix_left[i]);
+      out[i * 2 + 1] = BETWEEN(SHRT_MIN, SHRT_MAX, mix_right[i]);
     }
 
-    // Clamp to range. Left hardware channel.
-    // Has been char instead of short.
-    // if (dl > 127) *leftout = 127;
-    // else if (dl < -128) *leftout = -128;
-    // else *leftout = dl;
+    out += count * 2;
+    remaining -= count;
+  }
+}
 
-    if (dl > SHRT_MAX)
-      *leftout = SHRT_MAX;
-    else if (dl < SHRT_MIN)
-      *leftout = SHRT_MIN;
-    else
-      *leftout = (signed short)dl;
+static void I_UpdateSound(void *unused, Uint8 *stream, int len)
+{
+  Uint64 start = SDL_GetPerformanceCounter();
 
-    // Same for right hardware channel.
-    if (dr > SHRT_MAX)
-      *rightout = SHRT_MAX;
-    else if (dr < SHRT_MIN)
-      *rightout = SHRT_MIN;
-    else
-      *rightout = (signed short)dr;
+  MixSound(unused, stream, len);
 
-    // Increment current pointers in stream
-    leftout += step;
-    rightout += step;
-  }
-  SDL_UnlockMutex (sfxmutex);
+  // capture calls aren't paced by the device
+  if (!dumping_sound)
+    RecordSoundCallback(start, len / 4);
 }
 
 static dboolean sound_was_initialized;
 
+// Sound capture mixes on the game thread, in step with the captured
+//  frames, so no audio device is opened and nothing depends on its timing
+static dboolean sound_offline;
+
 void I_ShutdownSound(void)
 {
   if (sound_was_initialized)
   {
-    Mix_CloseAudio();
-    SDL_CloseAudio();
+    if (!sound_offline)
+    {
+      Mix_CloseAudio();
+      SDL_CloseAudio();
+    }
 
     sound_was_initialized = false;
 
-    if (sfxmutex)
-    {
-      SDL_DestroyMutex (sfxmutex);
-      sfxmutex = NULL;
-    }
+    WaitSoundCacheWarmThread();
+
+    if (sound_command_dropped)
+      lprintf(LO_WARN, "I_ShutdownSound: %d sound commands were dropped (peak queue depth %d)\n",
+              sound_command_dropped, sound_command_peak);
   }
 }
 
-void I_InitSound(void)
+static dboolean I_OpenSoundDevice(void)
 {
   int audio_rate;
   int audio_channels;
   int audio_buffers;
-  SDL_AudioSpec audio;
-
-  if (sound_was_initialized || (nomusicparm && nosfxparm))
-    return;
 
   if (SDL_InitSubSystem(SDL_INIT_AUDIO))
   {
     lprintf(LO_WARN, "Couldn't initialize SDL audio (%s))\n", SDL_GetError());
-    nosfxparm = true;
-    nomusicparm = true;
-    return;
+    return false;
   }
 
   // Secure and configure sound device first.
@@ -770,6 +1430,9 @@ void I_InitSound(void)
 
   I_InitSoundParams();
 
+  // The time the device was closed isn't a gap between callbacks
+  callback_last_start = 0;
+
   audio_rate = snd_samplerate;
   audio_channels = 2;
   audio_buffers = getSliceSize();
@@ -778,23 +1441,42 @@ void I_InitSound(void)
                           NULL, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE) < 0)
   {
     lprintf(LO_DEBUG, "couldn't open audio with desired format (%s)\n", SDL_GetError());
-    nosfxparm = true;
-    nomusicparm = true;
-    return;
+    return false;
   }
 
   // [FG] feed actual sample frequency back into config variable
   Mix_QuerySpec(&snd_samplerate, NULL, NULL);
 
-  sound_was_initialized = true;
-
   Mix_SetPostMix(I_UpdateSound, NULL);
 
   lprintf(LO_DEBUG, " configured audio device with %d samples/slice\n", audio_buffers);
 
-  I_AtExit(I_ShutdownSound, true, "I_ShutdownSound", exit_priority_normal);
+  return true;
+}
+
+void I_InitSound(void)
+{
+  if (sound_was_initialized || (nomusicparm && nosfxparm))
+    return;
+
+  sound_offline = dumping_sound;
+
+  if (sound_offline)
+  {
+    I_InitSoundParams();
+
+    lprintf(LO_DEBUG, "I_InitSound: rendering offline at %d Hz for capture\n", snd_samplerate);
+  }
+  else if (!I_OpenSoundDevice())
+  {
+    nosfxparm = true;
+    nomusicparm = true;
+    return;
+  }
+
+  sound_was_initialized = true;
 
-  sfxmutex = SDL_CreateMutex ();
+  I_AtExit(I_ShutdownSound, true, "I_ShutdownSound", exit_priority_normal);
 
   if (snd_pcspeaker)
     I_PCS_InitSound();
@@ -803,14 +1485,16 @@ void I_InitSound(void)
     I_InitMusic();
 
   lprintf(LO_DEBUG, "I_InitSound: sound module ready\n");
-  SDL_PauseAudio(0);
+
+  if (!sound_offline)
+    SDL_PauseAudio(0);
 }
 
 
 // NSM sound capture routines
 
 // silences sound output, and instead allows sound capture to work
-// call this before sound startup
+// call this before sound startup, so that no audio device is opened
 void I_SetSoundCap (void)
 {
   dumping_sound = 1;
@@ -846,43 +1530,11 @@ unsigned char *I_GrabSound (int len)
 
 // NSM helper routine for some of the streaming audio
 void I_ResampleStream (void *dest, unsigned nsamp, void (*proc) (void *dest, unsigned nsamp), unsigned sratein, unsigned srateout)
-{ // assumes 16 bit signed interleaved stereo
-
-  unsigned i;
-  int j = 0;
-
-  short *sout = (short*)dest;
-
-  static short *sin = NULL;
-  static unsigned sinsamp = 0;
-
-  static unsigned remainder = 0;
-  unsigned step = (sratein << 16) / (unsigned) srateout;
-
-  unsigned nreq = (step * nsamp + remainder) >> 16;
-
-  if (nreq > sinsamp)
-  {
-    sin = (short*)Z_Realloc (sin, (nreq + 1) * 4);
-    if (!sinsamp) // avoid pop when first starting stream
-      sin[0] = sin[1] = 0;
-    sinsamp = nreq;
-  }
-
-  proc (sin + 2, nreq);
-
-  for (i = 0; i < nsamp; i++)
-  {
-    *sout++ = ((unsigned) sin[j + 0] * (0x10000 - remainder) +
-               (unsigned) sin[j + 2] * remainder) >> 16;
-    *sout++ = ((unsigned) sin[j + 1] * (0x10000 - remainder) +
-               (unsigned) sin[j + 3] * remainder) >> 16;
-    remainder += step;
-    j += remainder >> 16 << 1;
-    remainder &= 0xffff;
-  }
-  sin[0] = sin[nreq * 2];
-  sin[1] = sin[nreq * 2 + 1];
+{
+  if (snd_music_resampler)
+    I_SincResampleStream (dest, nsamp, proc, sratein, srateout);
+  else
+    I_LinearResampleStream (dest, nsamp, proc, sratein, srateout);
 }
 
 //
@@ -897,6 +1549,7 @@ static void StopSong(int handle);
 static void ResumeSong (int handle);
 static void PauseSong (int handle);
 static void PlaySong(int handle, int looping);
+static void SeekSong (int handle, int position);
 
 #include "mus2mid.h"
 
@@ -959,11 +1612,177 @@ static const void *music_handle = NULL;
 
 static void *mus2mid_conversion_data = NULL;
 
+//
+// Music stream
+//
+// The music players decode and synthesize on their own thread, ahead of
+// playback, into a ring of samples. The audio callback only copies from
+// the ring. Portmidi is left out: it plays through an external device and
+// its timing comes from the render calls.
+//
+// Positions are in frames and only ever increase. The decode thread
+// writes the head and the audio callback advances the tail. Changing the
+// song or its state discards what was rendered ahead by moving the tail
+// to the head.
+//
+
+// Frames rendered at once, must be a power of two
+#define MUSIC_STREAM_CHUNK 512
+
+static short *music_stream;
+static unsigned int music_stream_size;
+static unsigned int music_stream_lookahead;
+static SDL_atomic_t music_stream_head;
+static SDL_atomic_t music_stream_tail;
+static SDL_atomic_t music_streaming;
+static SDL_atomic_t music_stream_quit;
+static SDL_sem *music_stream_sem;
+static SDL_Thread *music_stream_thread;
+
+static int MusicStreamThread (void *unused)
+{
+  while (!SDL_AtomicGet (&music_stream_quit))
+  {
+    unsigned int head = SDL_AtomicGet (&music_stream_head);
+    unsigned int tail = SDL_AtomicGet (&music_stream_tail);
+    dboolean rendered = false;
+
+    if (head - tail + MUSIC_STREAM_CHUNK <= music_stream_lookahead)
+    {
+      SDL_LockMutex (musmutex);
+      if (SDL_AtomicGet (&music_streaming))
+      {
+        UpdateMusic (music_stream + (head & (music_stream_size - 1)) * 2, MUSIC_STREAM_CHUNK);
+
+        // The samples must be complete before the callback can see them
+        SDL_MemoryBarrierRelease ();
+        SDL_AtomicSet (&music_stream_head, head + MUSIC_STREAM_CHUNK);
+        rendered = true;
+      }
+      SDL_UnlockMutex (musmutex);
+    }
+
+    // Wait for the callback to make room, or for a new song
+    if (!rendered)
+      SDL_SemWaitTimeout (music_stream_sem, 10);
+  }
+
+  return 0;
+}
+
+// Drops everything rendered ahead. Call with musmutex held.
+static void FlushMusicStream (void)
+{
+  int tail;
+
+  if (!music_stream_thread)
+    return;
+
+  do
+  {
+    tail = SDL_AtomicGet (&music_stream_tail);
+  } while (!SDL_AtomicCAS (&music_stream_tail, tail, SDL_AtomicGet (&music_stream_head)));
+
+  SDL_AtomicSet (&music_streaming,
+                 music_handle && music_players[current_player] != &pm_player);
+
+  SDL_SemPost (music_stream_sem);
+}
+
+// Runs on the audio callback.
+// Returns false if the music isn't streamed and must be rendered here.
+static dboolean ReadMusicStream (void *buff, unsigned nsamp)
+{
+  short *out = buff;
+  unsigned int head, tail, count, first, index;
+
+  if (!SDL_AtomicGet (&music_streaming))
+    return false;
+
+  tail = SDL_AtomicGet (&music_stream_tail);
+  head = SDL_AtomicGet (&music_stream_head);
+
+  SDL_MemoryBarrierAcquire ();
+
+  count = MIN (nsamp, head - tail);
+  index = tail & (music_stream_size - 1);
+  first = MIN (count, music_stream_size - index);
+
+  memcpy (out, music_stream + index * 2, first * 4);
+  memcpy (out + first * 2, music_stream, (count - first) * 4);
+
+  // A flush while copying means these samples were stale
+  SDL_MemoryBarrierRelease ();
+  if (!SDL_AtomicCAS (&music_stream_tail, tail, tail + count))
+    count = 0;
+
+  // Fall behind rather than wait
+  memset (out + count * 2, 0, (nsamp - count) * 4);
+
+  SDL_SemPost (music_stream_sem);
+
+  return true;
+}
+
+static void I_InitMusicStream (void)
+{
+  int lookahead_ms = dsda_IntConfig (dsda_config_snd_music_lookahead);
+  unsigned int lookahead;
+
+  // Sound capture needs the music rendered in step with the game
+  if (!lookahead_ms || dumping_sound)
+    return;
+
+  // The callback must find at least a slice waiting
+  lookahead = (unsigned int) lookahead_ms * snd_samplerate / 1000;
+  lookahead = MAX (lookahead, 2 * getSliceSize ());
+  lookahead = (lookahead + MUSIC_STREAM_CHUNK - 1) & ~(MUSIC_STREAM_CHUNK - 1);
+
+  music_stream_lookahead = lookahead;
+  for (music_stream_size = MUSIC_STREAM_CHUNK;
+       music_stream_size < lookahead;
+       music_stream_size <<= 1);
+
+  music_stream = Z_Malloc (music_stream_size * 4);
+  SDL_AtomicSet (&music_stream_head, 0);
+  SDL_AtomicSet (&music_stream_tail, 0);
+  SDL_AtomicSet (&music_streaming, 0);
+  SDL_AtomicSet (&music_stream_quit, 0);
+  music_stream_sem = SDL_CreateSemaphore (0);
+
+  music_stream_thread = SDL_CreateThread (MusicStreamThread, "music_stream_thread", NULL);
+  if (!music_stream_thread)
+  {
+    lprintf (LO_WARN, "I_InitMusicStream: couldn't create thread (%s)\n", SDL_GetError ());
+    SDL_DestroySemaphore (music_stream_sem);
+    music_stream_sem = NULL;
+    Z_Free (music_stream);
+    music_stream = NULL;
+  }
+}
+
+static void I_ShutdownMusicStream (void)
+{
+  if (!music_stream_thread)
+    return;
+
+  SDL_AtomicSet (&music_streaming, 0);
+  SDL_AtomicSet (&music_stream_quit, 1);
+  SDL_SemPost (music_stream_sem);
+  SDL_WaitThread (music_stream_thread, NULL);
+  music_stream_thread = NULL;
+
+  SDL_DestroySemaphore (music_stream_sem);
+  music_stream_sem = NULL;
+}
+
 void I_ShutdownMusic(void)
 {
   int i;
   S_StopMusic ();
 
+  I_ShutdownMusicStream ();
+
   for (i = 0; music_players[i]; i++)
   {
     if (music_player_was_init[i])
@@ -984,7 +1803,18 @@ void I_InitMusic(void)
 
   // todo not so greedy
   for (i = 0; music_players[i]; i++)
+  {
+    // portmidi plays on an external device in real time, it can't be captured
+    if (sound_offline && music_players[i] == &pm_player)
+    {
+      music_player_was_init[i] = 0;
+      continue;
+    }
+
     music_player_was_init[i] = music_players[i]->init (snd_samplerate);
+  }
+
+  I_InitMusicStream ();
 
   I_AtExit(I_ShutdownMusic, true, "I_ShutdownMusic", exit_priority_normal);
 }
@@ -1031,6 +1861,13 @@ void I_PlaySong(int handle, int looping)
   }
 }
 
+void I_SeekSong (int handle, int position)
+{
+  // sdl_mixer songs keep playing where they are
+  if (registered_non_rw)
+    SeekSong (handle, position);
+}
+
 void I_PauseSong (int handle)
 {
   if (registered_non_rw)
@@ -1134,6 +1971,13 @@ int I_RegisterSong(const void *data, size_t len)
 
   music[0] = NULL;
 
+  // sdl_mixer plays through the audio device, which isn't open when capturing
+  if (sound_offline)
+  {
+    lprintf(LO_WARN, "I_RegisterSong: song format can't be captured\n");
+    return (0);
+  }
+
   rwops_stream = SDL_RWFromConstMem(data, len);
   if (rwops_stream)
   {
@@ -1163,6 +2007,18 @@ static void PlaySong(int handle, int looping)
     SDL_LockMutex (musmutex);
     music_players[current_player]->play (music_handle, looping);
     music_players[current_player]->setvolume (music_volume);
+    FlushMusicStream ();
+    SDL_UnlockMutex (musmutex);
+  }
+}
+
+static void SeekSong (int handle, int position)
+{
+  if (music_handle && music_players[current_player]->seek)
+  {
+    SDL_LockMutex (musmutex);
+    music_players[current_player]->seek (position);
+    FlushMusicStream ();
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1184,6 +2040,7 @@ static void PauseSong (int handle)
     default: // Default - let music continue
       break;
   }
+  FlushMusicStream ();
   SDL_UnlockMutex (musmutex);
 }
 
@@ -1205,6 +2062,7 @@ static void ResumeSong (int handle)
     default: // Default - music was never stopped
       break;
   }
+  FlushMusicStream ();
   SDL_UnlockMutex (musmutex);
 }
 
@@ -1214,6 +2072,7 @@ static void StopSong(int handle)
   {
     SDL_LockMutex (musmutex);
     music_players[current_player]->stop ();
+    FlushMusicStream ();
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1225,6 +2084,7 @@ static void UnRegisterSong(int handle)
     SDL_LockMutex (musmutex);
     music_players[current_player]->unregistersong (music_handle);
     music_handle = NULL;
+    FlushMusicStream ();
     if (mus2mid_conversion_data)
     {
       Z_Free (mus2mid_conversion_data);
@@ -1277,6 +2137,7 @@ static int RegisterSongEx (const void *data, size_t len, int try_mus2mid)
               SDL_LockMutex (musmutex);
               current_player = i;
               music_handle = temp_handle;
+              FlushMusicStream ();
               SDL_UnlockMutex (musmutex);
               lprintf(LO_DEBUG, "RegisterSongEx: Using player %s\n", music_players[i]->name ());
               return 1;
@@ -1398,5 +2259,5 @@ void M_ChangeMIDIPlayer(void)
   }
 
   S_StopMusic();
-  S_RestartMusic();
+  S_RestartMusicAt(S_MusicTics());
 }
@@ -64,6 +64,11 @@ void I_UpdateRenderSize(void)
     renderW = gl_window_width;
     renderH = gl_window_height;
   }
+  else if (I_Offscreen())
+  {
+    renderW = SCREENWIDTH;
+    renderH = SCREENHEIGHT;
+  }
   else
   {
     SDL_GetRendererOutputSize(sdl_renderer, &renderW, &renderH);
@@ -125,7 +130,30 @@ unsigned char *I_GrabScreen(void)
     pixels = (unsigned char*)Z_Realloc(pixels, size);
   }
 
-  if (pixels && size)
+  if (I_Offscreen())
+  {
+    // expand the paletted screen, there is no renderer to read back from
+    unsigned char palette[256 * 3];
+    unsigned char *dest = pixels;
+    int x, y;
+
+    I_GrabPalette(palette);
+
+    for (y = 0; y < renderH; y++)
+    {
+      const byte *src = screens[0].data + y * screens[0].pitch;
+
+      for (x = 0; x < renderW; x++)
+      {
+        const unsigned char *colour = palette + 3 * src[x];
+
+        *dest++ = colour[0];
+        *dest++ = colour[1];
+        *dest++ = colour[2];
+      }
+    }
+  }
+  else if (pixels && size)
   {
     SDL_Rect screen = { 0, 0, renderW, renderH };
     SDL_RenderReadPixels(sdl_renderer, &screen, SDL_PIXELFORMAT_RGB24, pixels, renderW * 3);
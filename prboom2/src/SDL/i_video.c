@@ -97,6 +97,15 @@ static SDL_Cursor* cursors[2] = {NULL, NULL};
 
 dboolean window_focused;
 
+// -offscreen: no window or renderer, screens[0] is the final image
+static dboolean offscreen;
+static dboolean offscreen_initialized;
+
+dboolean I_Offscreen(void)
+{
+  return offscreen;
+}
+
 // Window resize state.
 static void ApplyWindowResize(SDL_Event *resize_event);
 
@@ -114,7 +123,6 @@ extern void M_QuitDOOM(int choice);
 int desired_fullscreen;
 int exclusive_fullscreen;
 SDL_Surface *screen;
-static SDL_Surface *buffer;
 SDL_Window *sdl_window;
 SDL_Renderer *sdl_renderer;
 static SDL_Texture *sdl_texture;
@@ -462,14 +470,23 @@ static void I_InitInputs(void)
 ///////////////////////////////////////////////////////////
 // Palette stuff.
 //
+
+// The current palette, expanded to the streaming texture format
+static Uint32 palette_lut[256];
+static int palette_generation;
+
 static void I_UploadNewPalette(int pal, int force)
 {
   // This is used to replace the current 256 colour cmap with a new one
   // Used by 256 colour PseudoColor modes
 
   static int cachedgamma;
+  static int cachedpal = -1;
+  static const SDL_Color* cachedcolours;
   static size_t num_pals;
   dsda_playpal_t* playpal_data;
+  const SDL_Color* colours;
+  int c;
 
   if (V_IsOpenGLMode())
     return;
@@ -506,7 +523,10 @@ static void I_UploadNewPalette(int pal, int force)
     }
 
     num_pals /= 256;
+    cachedpal = -1;
   }
+  else if (pal == cachedpal && playpal_data->colours == cachedcolours)
+    return;
 
 #ifdef RANGECHECK
   if ((size_t)pal >= num_pals)
@@ -514,7 +534,27 @@ static void I_UploadNewPalette(int pal, int force)
       pal, num_pals);
 #endif
 
-  SDL_SetPaletteColors(screen->format->palette, playpal_data->colours + 256 * pal, 0, 256);
+  colours = playpal_data->colours + 256 * pal;
+  for (c = 0; c < 256; c++)
+    palette_lut[c] = 0xff000000 | (colours[c].r << 16) | (colours[c].g << 8) | colours[c].b;
+
+  cachedpal = pal;
+  cachedcolours = playpal_data->colours;
+  palette_generation++;
+}
+
+int I_GrabPalette(unsigned char *rgb)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+  {
+    *rgb++ = (palette_lut[i] >> 16) & 0xff;
+    *rgb++ = (palette_lut[i] >> 8) & 0xff;
+    *rgb++ = palette_lut[i] & 0xff;
+  }
+
+  return palette_generation;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -522,10 +562,53 @@ static void I_UploadNewPalette(int pal, int force)
 
 void I_ShutdownGraphics(void)
 {
+  if (offscreen)
+    return;
+
   SDL_FreeCursor(cursors[1]);
   DeactivateMouse();
 }
 
+//
+// I_ExpandPalette
+//
+// Converts the paletted screen straight into the locked streaming texture.
+// Four indices are read per load and looked up independently, which keeps
+// the loop bound by memory bandwidth rather than by the lookups.
+//
+static void I_ExpandPalette(byte *dest, int dest_pitch,
+                            const byte *src, int src_pitch,
+                            int width, int height)
+{
+  const Uint32 *lut = palette_lut;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    Uint32 *d = (Uint32 *) dest;
+    const byte *s = src;
+
+    for (x = 0; x < (width & ~3); x += 4)
+    {
+      Uint32 p0 = lut[s[x]];
+      Uint32 p1 = lut[s[x + 1]];
+      Uint32 p2 = lut[s[x + 2]];
+      Uint32 p3 = lut[s[x + 3]];
+
+      d[x] = p0;
+      d[x + 1] = p1;
+      d[x + 2] = p2;
+      d[x + 3] = p3;
+    }
+
+    for (; x < width; x++)
+      d[x] = lut[s[x]];
+
+    dest += dest_pitch;
+    src += src_pitch;
+  }
+}
+
 //
 // I_FinishUpdate
 //
@@ -535,7 +618,8 @@ static int newpal = 0;
 void I_FinishUpdate (void)
 {
   //e6y: new mouse code
-  UpdateGrab();
+  if (!offscreen)
+    UpdateGrab();
 
 #ifdef MONITOR_VISIBILITY
   //!!if (!(SDL_GetAppState()&SDL_APPACTIVE)) {
@@ -549,29 +633,6 @@ void I_FinishUpdate (void)
     return;
   }
 
-  if (SDL_MUSTLOCK(screen)) {
-      int h;
-      byte *src;
-      byte *dest;
-
-      if (SDL_LockSurface(screen) < 0) {
-        lprintf(LO_INFO,"I_FinishUpdate: %s\n", SDL_GetError());
-        return;
-      }
-
-      dest=(byte*)screen->pixels;
-      src=screens[0].data;
-      h=screen->h;
-      for (; h>0; h--)
-      {
-        memcpy(dest,src,SCREENWIDTH); //e6y
-        dest+=screen->pitch;
-        src+=screens[0].pitch;
-      }
-
-      SDL_UnlockSurface(screen);
-  }
-
   /* Update the display buffer (flipping video pages if supported)
    * If we need to change palette, that implicitely does a flip */
   if (newpal != NO_PALETTE_CHANGE) {
@@ -579,12 +640,25 @@ void I_FinishUpdate (void)
     newpal = NO_PALETTE_CHANGE;
   }
 
-  // Blit from the paletted 8-bit screen buffer to the intermediate
-  // 32-bit RGBA buffer that we can load into the texture.
-  SDL_LowerBlit(screen, &src_rect, buffer, &src_rect);
+  // I_GrabScreen reads screens[0] directly
+  if (offscreen)
+    return;
 
-  // Update the intermediate texture with the contents of the RGBA buffer.
-  SDL_UpdateTexture(sdl_texture, &src_rect, buffer->pixels, buffer->pitch);
+  // Expand the paletted 8-bit screen buffer directly into the texture
+  {
+    void *pixels;
+    int pitch;
+
+    if (SDL_LockTexture(sdl_texture, &src_rect, &pixels, &pitch) < 0) {
+      lprintf(LO_INFO,"I_FinishUpdate: %s\n", SDL_GetError());
+      return;
+    }
+
+    I_ExpandPalette(pixels, pitch, screens[0].data, screens[0].pitch,
+                    src_rect.w, src_rect.h);
+
+    SDL_UnlockTexture(sdl_texture);
+  }
 
   // Make sure the pillarboxes are kept clear each frame.
   SDL_RenderClear(sdl_renderer);
@@ -613,7 +687,6 @@ static void I_ShutdownSDL(void)
 {
   if (sdl_glcontext) SDL_GL_DeleteContext(sdl_glcontext);
   if (screen) SDL_FreeSurface(screen);
-  if (buffer) SDL_FreeSurface(buffer);
   if (sdl_texture) SDL_DestroyTexture(sdl_texture);
   if (sdl_renderer) SDL_DestroyRenderer(sdl_renderer);
   if (sdl_window) SDL_DestroyWindow(sdl_window);
@@ -628,7 +701,10 @@ void I_PreInitGraphics(void)
 
   // Initialize SDL
   unsigned int flags = 0;
-  if (!(dsda_Flag(dsda_arg_nodraw) && dsda_Flag(dsda_arg_nosound)))
+
+  offscreen = dsda_Flag(dsda_arg_offscreen);
+
+  if (!(dsda_Flag(dsda_arg_nodraw) && dsda_Flag(dsda_arg_nosound)) && !offscreen)
     flags = SDL_INIT_VIDEO;
 #ifdef PRBOOM_DEBUG
   flags |= SDL_INIT_NOPARACHUTE;
@@ -1001,6 +1077,10 @@ static video_mode_t I_DesiredVideoMode(void) {
   dsda_arg_t *arg;
   video_mode_t mode;
 
+  // there is no context to render opengl into
+  if (offscreen)
+    return VID_MODESW;
+
   arg = dsda_Arg(dsda_arg_vidmode);
   if (arg->found)
     mode = I_GetModeFromString(arg->value.v_string);
@@ -1153,6 +1233,9 @@ void I_InitGraphics(void)
     /* Set the video mode */
     I_UpdateVideoMode();
 
+    if (offscreen)
+      return;
+
     //e6y: setup the window title
     I_SetWindowCaption();
 
@@ -1186,7 +1269,7 @@ void I_UpdateVideoMode(void)
   screen_multiply = dsda_IntConfig(dsda_config_render_screen_multiply);
   integer_scaling = dsda_IntConfig(dsda_config_integer_scaling);
 
-  if(sdl_window)
+  if (sdl_window || offscreen_initialized)
   {
     // video capturing cannot be continued with new screen settings
     I_CaptureFinish();
@@ -1202,16 +1285,14 @@ void I_UpdateVideoMode(void)
 
     if (sdl_glcontext) SDL_GL_DeleteContext(sdl_glcontext);
     if (screen) SDL_FreeSurface(screen);
-    if (buffer) SDL_FreeSurface(buffer);
     if (sdl_texture) SDL_DestroyTexture(sdl_texture);
     if (sdl_renderer) SDL_DestroyRenderer(sdl_renderer);
-    SDL_DestroyWindow(sdl_window);
+    if (sdl_window) SDL_DestroyWindow(sdl_window);
 
     sdl_renderer = NULL;
     sdl_window = NULL;
     sdl_glcontext = NULL;
     screen = NULL;
-    buffer = NULL;
     sdl_texture = NULL;
   }
 
@@ -1236,7 +1317,12 @@ void I_UpdateVideoMode(void)
     init_flags |= SDL_WINDOW_RESIZABLE;
 #endif
 
-  if (V_IsOpenGLMode())
+  if (offscreen)
+  {
+    // the software renderer draws into a heap buffer that is never presented
+    offscreen_initialized = true;
+  }
+  else if (V_IsOpenGLMode())
   {
     SDL_GL_SetAttribute( SDL_GL_RED_SIZE, 0 );
     SDL_GL_SetAttribute( SDL_GL_GREEN_SIZE, 0 );
@@ -1308,17 +1394,18 @@ void I_UpdateVideoMode(void)
     SDL_RenderSetIntegerScale(sdl_renderer, integer_scaling);
 
     screen = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 8, 0, 0, 0, 0);
-    buffer = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 32, 0, 0, 0, 0);
-    SDL_FillRect(buffer, NULL, 0);
 
-    sdl_texture = SDL_CreateTextureFromSurface(sdl_renderer, buffer);
+    // The palette is expanded into this texture every frame
+    sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_STREAMING,
+                                    SCREENWIDTH, SCREENHEIGHT);
 
     if(screen == NULL) {
       I_Error("Couldn't set %dx%d video mode [%s]", SCREENWIDTH, SCREENHEIGHT, SDL_GetError());
     }
   }
 
-  if (sdl_video_window_pos)
+  if (sdl_video_window_pos && sdl_window)
   {
     int x, y;
     if (sscanf(sdl_video_window_pos, "%d,%d", &x, &y) == 2)
@@ -1343,7 +1430,7 @@ void I_UpdateVideoMode(void)
   }
 #endif
 
-  windowid = SDL_GetWindowID(sdl_window);
+  windowid = sdl_window ? SDL_GetWindowID(sdl_window) : 0;
 
   if (V_IsOpenGLMode())
   {
@@ -1355,7 +1442,7 @@ void I_UpdateVideoMode(void)
     lprintf(LO_DEBUG, "I_UpdateVideoMode: 0x%x, %s, %s\n", init_flags, screen && screen->pixels ? "SDL buffer" : "own buffer", screen && SDL_MUSTLOCK(screen) ? "lock-and-copy": "direct access");
 
     // Get the info needed to render to the display
-    if (!SDL_MUSTLOCK(screen))
+    if (screen && !SDL_MUSTLOCK(screen))
     {
       screens[0].not_on_heap = true;
       screens[0].data = (unsigned char *) (screen->pixels);
@@ -706,7 +706,7 @@ void AM_SetPosition(void)
 
     if (automap_overlay)
     {
-      f_h = viewheight;
+      f_h = screen_viewheight;
     }
     else
     {
@@ -61,6 +61,7 @@
 #include "e6y.h"
 
 #include "dsda/args.h"
+#include "dsda/frame_stats.h"
 #include "dsda/settings.h"
 #include "dsda/time.h"
 
@@ -145,7 +146,9 @@ void TryRunTics (void)
     if (advancedemo)
       D_DoAdvanceDemo ();
     M_Ticker ();
+    dsda_StartTicTimer();
     G_Ticker ();
+    dsda_EndTicTimer();
     gametic++;
     FakeNetUpdate();
   }
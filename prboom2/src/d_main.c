@@ -89,16 +89,20 @@
 #include "dsda/demo.h"
 #include "dsda/exdemo.h"
 #include "dsda/features.h"
+#include "dsda/frame_stats.h"
 #include "dsda/global.h"
 #include "dsda/mkdir.h"
 #include "dsda/save.h"
 #include "dsda/data_organizer.h"
+#include "dsda/dynamic_resolution.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
 #include "dsda/mobjinfo.h"
 #include "dsda/options.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
+#include "dsda/render_benchmark.h"
+#include "dsda/segment_capture.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
@@ -360,6 +364,9 @@ void D_Display (fixed_t frac)
   if (!I_StartDisplay())
     return;
 
+  dsda_StartFrameTimer();
+  dsda_StartDynamicResolutionFrame();
+
   if (setsizeneeded) {               // change the view size if needed
     R_ExecuteSetViewSize();
     oldgamestate = -1;            // force background redraw
@@ -496,6 +503,8 @@ void D_Display (fixed_t frac)
 
   HU_DrawDemoProgress(true); //e6y
 
+  dsda_EndDynamicResolutionFrame();
+
   // normal update
   if (!wipe)
     I_FinishUpdate ();              // page flip or blit buffer
@@ -505,6 +514,8 @@ void D_Display (fixed_t frac)
     D_Wipe();
   }
 
+  dsda_EndFrameTimer();
+
   // e6y
   // Don't thrash cpu during pausing or if the window doesnt have focus
   if (dsda_CameraPaused() || !window_focused) {
@@ -546,7 +557,9 @@ static void D_DoomLoop(void)
       if (advancedemo)
         D_DoAdvanceDemo ();
       M_Ticker ();
+      dsda_StartTicTimer();
       G_Ticker ();
+      dsda_EndTicTimer();
       gametic++;
       maketic++;
     }
@@ -1860,6 +1873,10 @@ static void D_DoomMainSetup(void)
   if (arg->found)
   {
     I_CapturePrep(arg->value.v_string);
+
+    // I_Init already set the sound up to be captured, without a device
+    if (!capturing_video)
+      I_Error("D_DoomMainSetup: -viddump couldn't start video capture");
   }
 
   //jff 9/3/98 use logical output routine
@@ -1902,7 +1919,13 @@ static void D_DoomMainSetup(void)
 
 void D_DoomMain(void)
 {
+  if (dsda_Arg(dsda_arg_viddump_segments)->found)
+    dsda_RunSegmentCapture(); // never returns
+
   D_DoomMainSetup(); // CPhipps - setup out of main execution stack
 
+  if (dsda_Arg(dsda_arg_render_benchmark)->found)
+    dsda_RunRenderBenchmark(); // never returns
+
   D_DoomLoop ();  // never returns
 }
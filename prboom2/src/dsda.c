@@ -33,9 +33,11 @@
 #include "dsda/demo.h"
 #include "dsda/exhud.h"
 #include "dsda/features.h"
+#include "dsda/frame_stats.h"
 #include "dsda/ghost.h"
 #include "dsda/key_frame.h"
 #include "dsda/mouse.h"
+#include "dsda/render_benchmark.h"
 #include "dsda/settings.h"
 #include "dsda/split_tracker.h"
 #include "dsda/tracker.h"
@@ -170,6 +172,14 @@ void dsda_ReadCommandLine(void) {
   if (arg->found)
     dsda_InitGhostExport(arg->value.v_string);
 
+  arg = dsda_Arg(dsda_arg_export_camera_path);
+  if (arg->found)
+    dsda_InitCameraPathExport(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_frame_log);
+  if (arg->found)
+    dsda_InitFrameLog(arg->value.v_string);
+
   dsda_HandleTurbo();
   dsda_HandleBuild();
 
@@ -409,6 +419,7 @@ void dsda_WatchCommand(void) {
   dsda_AddCommandToCommandDisplay(&players[displayplayer].cmd);
 
   dsda_ExportGhostFrame();
+  dsda_ExportCameraPathFrame();
 }
 
 void dsda_WatchBeforeLevelSetup(void) {
@@ -333,6 +333,36 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "imports at least one ghost file",
     arg_string_array, AT_LEAST_ONE_STRING,
   },
+  [dsda_arg_export_camera_path] = {
+    "-export_camera_path", NULL, NULL,
+    "exports the view position once per second to a camera path file",
+    arg_string,
+  },
+  [dsda_arg_render_benchmark] = {
+    "-render_benchmark", NULL, NULL,
+    "renders each map from fixed camera positions and writes stage timings to a csv file",
+    arg_string,
+  },
+  [dsda_arg_render_benchmark_path] = {
+    "-render_benchmark_path", NULL, NULL,
+    "loads the camera positions for -render_benchmark from a camera path file",
+    arg_string,
+  },
+  [dsda_arg_render_benchmark_frames] = {
+    "-render_benchmark_frames", NULL, NULL,
+    "sets the number of frames rendered per camera position",
+    arg_int, 1, 10000,
+  },
+  [dsda_arg_render_benchmark_hashes] = {
+    "-render_benchmark_hashes", NULL, NULL,
+    "writes a hash of the screen and the mean frame time for each -render_benchmark view to a file",
+    arg_string,
+  },
+  [dsda_arg_frame_log] = {
+    "-frame_log", NULL, NULL,
+    "writes per-frame render times and per-tic game times to a binary file during -timedemo or -fastdemo",
+    arg_string,
+  },
   [dsda_arg_consoleplayer] = {
     "-consoleplayer", NULL, NULL,
     "sets the console player (for coop playback)",
@@ -388,6 +418,31 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "dumps a video to the chosen file name",
     arg_string,
   },
+  [dsda_arg_viddump_segments] = {
+    "-viddump_segments", NULL, NULL,
+    "splits -viddump into segments captured by the chosen number of processes",
+    arg_int, 1, 64,
+  },
+  [dsda_arg_viddump_segment_length] = {
+    "-viddump_segment_length", NULL, NULL,
+    "sets the length of -viddump_segments segments in seconds",
+    arg_int, 10, 3600,
+  },
+  [dsda_arg_viddump_segment_dir] = {
+    "-viddump_segment_dir", NULL, NULL,
+    "sets the working directory of a -viddump_segments process (internal)",
+    arg_string,
+  },
+  [dsda_arg_viddump_segment] = {
+    "-viddump_segment", NULL, NULL,
+    "captures the demo tics between the two values (internal)",
+    arg_int_array, 0, INT_MAX, 2, 2,
+  },
+  [dsda_arg_viddump_key_frames] = {
+    "-viddump_key_frames", NULL, NULL,
+    "exports the key frames for -viddump_segments (internal)",
+    arg_null,
+  },
   [dsda_arg_dehout] = {
     "-dehout", "-bexout", NULL,
     "sets dehacked log file",
@@ -463,6 +518,11 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "turn off drawing",
     arg_null,
   },
+  [dsda_arg_offscreen] = {
+    "-offscreen", NULL, NULL,
+    "renders in software without a window (for capture, screenshots, and benchmarks)",
+    arg_null,
+  },
   [dsda_arg_nodeh] = {
     "-nodeh", NULL, NULL,
     "skip dehacked lumps inside wads",
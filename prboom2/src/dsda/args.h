@@ -77,6 +77,12 @@ typedef enum {
   dsda_arg_export_text_file,
   dsda_arg_export_ghost,
   dsda_arg_import_ghost,
+  dsda_arg_export_camera_path,
+  dsda_arg_render_benchmark,
+  dsda_arg_render_benchmark_path,
+  dsda_arg_render_benchmark_frames,
+  dsda_arg_render_benchmark_hashes,
+  dsda_arg_frame_log,
   dsda_arg_consoleplayer,
   dsda_arg_spechit,
   dsda_arg_setmem,
@@ -88,6 +94,11 @@ typedef enum {
   dsda_arg_shotdir,
   dsda_arg_movie,
   dsda_arg_viddump,
+  dsda_arg_viddump_segments,
+  dsda_arg_viddump_segment_length,
+  dsda_arg_viddump_segment_dir,
+  dsda_arg_viddump_segment,
+  dsda_arg_viddump_key_frames,
   dsda_arg_dehout,
   dsda_arg_verbose,
   dsda_arg_quiet,
@@ -103,6 +114,7 @@ typedef enum {
   dsda_arg_nomusic,
   dsda_arg_nosfx,
   dsda_arg_nodraw,
+  dsda_arg_offscreen,
   dsda_arg_nodeh,
   dsda_arg_nomapinfo,
   dsda_arg_noautoload,
@@ -33,6 +33,7 @@
 #include "dsda/args.h"
 #include "dsda/features.h"
 #include "dsda/input.h"
+#include "dsda/render_stats.h"
 #include "dsda/stretch.h"
 #include "dsda/utility.h"
 
@@ -134,6 +135,7 @@ void M_ChangeAspectRatio(void);
 void deh_changeCompTranslucency(void);
 void dsda_InitGameControllerParameters(void);
 void dsda_InitExHud(void);
+void dsda_ResetDynamicResolution(void);
 
 // TODO: migrate all kinds of stuff from M_Init
 
@@ -617,6 +619,18 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "gl_health_bar", dsda_config_gl_health_bar,
     CONF_BOOL(0), NULL, STRICT_INT(0)
   },
+  [dsda_config_gl_precache_threads] = {
+    "gl_precache_threads", dsda_config_gl_precache_threads,
+    dsda_config_int, 1, 16, { 4 }
+  },
+  [dsda_config_gl_level_cache] = {
+    "gl_level_cache", dsda_config_gl_level_cache,
+    CONF_BOOL(1)
+  },
+  [dsda_config_gl_sprite_batching] = {
+    "gl_sprite_batching", dsda_config_gl_sprite_batching,
+    CONF_BOOL(1)
+  },
   [dsda_config_use_mouse] = {
     "use_mouse", dsda_config_use_mouse,
     CONF_BOOL(1), NULL, NOT_STRICT, I_InitMouse
@@ -709,6 +723,22 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "snd_samplecount", dsda_config_snd_samplecount,
     dsda_config_int, 0, 8192, { 0 }, NULL, NOT_STRICT, I_InitSoundParams
   },
+  [dsda_config_snd_reference_mixer] = {
+    "snd_reference_mixer", dsda_config_snd_reference_mixer,
+    CONF_BOOL(0), NULL, NOT_STRICT, I_InitSoundParams
+  },
+  [dsda_config_snd_music_lookahead] = {
+    "snd_music_lookahead", dsda_config_snd_music_lookahead,
+    dsda_config_int, 0, 1000, { 100 }
+  },
+  [dsda_config_snd_music_resampler] = {
+    "snd_music_resampler", dsda_config_snd_music_resampler,
+    dsda_config_int, 0, 1, { 0 }, NULL, NOT_STRICT, I_InitSoundParams
+  },
+  [dsda_config_snd_cache_size] = {
+    "snd_cache_size", dsda_config_snd_cache_size,
+    dsda_config_int, 1, 1024, { 64 }, NULL, NOT_STRICT, I_InitSoundParams
+  },
   [dsda_config_sfx_volume] = {
     "sfx_volume", dsda_config_sfx_volume,
     dsda_config_int, 0, 15, { 8 }, NULL, NOT_STRICT, S_ResetSfxVolume
@@ -781,6 +811,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "cap_videocommand", dsda_config_cap_videocommand,
     CONF_STRING("ffmpeg -f rawvideo -pix_fmt rgb24 -r %r -s %wx%h -i - -c:v libx264 -y temp_v.nut")
   },
+  [dsda_config_cap_videocommand_pal8] = {
+    "cap_videocommand_pal8", dsda_config_cap_videocommand_pal8,
+    CONF_STRING("dsda-pal8dec ffmpeg -f rawvideo -pix_fmt rgb24 -r %r -s %wx%h -i - -c:v libx264 -y temp_v.nut")
+  },
   [dsda_config_cap_muxcommand] = {
     "cap_muxcommand", dsda_config_cap_muxcommand,
     CONF_STRING("ffmpeg -i temp_v.nut -i temp_a.nut -c copy -y %f")
@@ -805,6 +839,22 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "cap_fps", dsda_config_cap_fps,
     dsda_config_int, 16, 300, { 60 }
   },
+  [dsda_config_cap_queue_frames] = {
+    "cap_queue_frames", dsda_config_cap_queue_frames,
+    dsda_config_int, 1, 256, { 8 }
+  },
+  [dsda_config_cap_queue_policy] = {
+    "cap_queue_policy", dsda_config_cap_queue_policy,
+    dsda_config_int, 0, 1, { 0 }
+  },
+  [dsda_config_cap_pal8] = {
+    "cap_pal8", dsda_config_cap_pal8,
+    CONF_BOOL(0)
+  },
+  [dsda_config_cap_concatcommand] = {
+    "cap_concatcommand", dsda_config_cap_concatcommand,
+    CONF_STRING("ffmpeg -f concat -safe 0 -i %l -c copy -y %f")
+  },
   [dsda_config_hudadd_crosshair_color] = {
     "hudadd_crosshair_color", dsda_config_hudadd_crosshair_color,
     CONF_CR(3)
@@ -1127,6 +1177,30 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "render_stretchsky", dsda_config_render_stretchsky,
     CONF_BOOL(1)
   },
+  [dsda_config_render_dynamic_resolution] = {
+    "render_dynamic_resolution", dsda_config_render_dynamic_resolution,
+    CONF_BOOL(0), NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_dynamic_resolution_fps] = {
+    "render_dynamic_resolution_fps", dsda_config_render_dynamic_resolution_fps,
+    dsda_config_int, 35, 1000, { 60 }
+  },
+  [dsda_config_render_dynamic_resolution_min] = {
+    "render_dynamic_resolution_min", dsda_config_render_dynamic_resolution_min,
+    dsda_config_int, 25, 100, { 50 }, NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_dynamic_resolution_max] = {
+    "render_dynamic_resolution_max", dsda_config_render_dynamic_resolution_max,
+    dsda_config_int, 25, 100, { 100 }, NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_plane_threads] = {
+    "render_plane_threads", dsda_config_render_plane_threads,
+    dsda_config_int, 1, DSDA_MAX_PLANE_WORKERS, { 1 }
+  },
+  [dsda_config_render_patch_cache] = {
+    "render_patch_cache", dsda_config_render_patch_cache,
+    CONF_BOOL(1)
+  },
   [dsda_config_boom_translucent_sprites] = {
     "boom_translucent_sprites", dsda_config_boom_translucent_sprites,
     CONF_BOOL(1), NULL, NOT_STRICT, deh_changeCompTranslucency
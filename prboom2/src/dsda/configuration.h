@@ -124,6 +124,9 @@ typedef enum {
   dsda_config_gl_render_fov,
   dsda_config_gl_lightmode,
   dsda_config_gl_health_bar,
+  dsda_config_gl_precache_threads,
+  dsda_config_gl_level_cache,
+  dsda_config_gl_sprite_batching,
   dsda_config_use_mouse,
   dsda_config_mouse_sensitivity_horiz,
   dsda_config_mouse_sensitivity_vert,
@@ -147,6 +150,10 @@ typedef enum {
   dsda_config_full_sounds,
   dsda_config_snd_samplerate,
   dsda_config_snd_samplecount,
+  dsda_config_snd_reference_mixer,
+  dsda_config_snd_music_lookahead,
+  dsda_config_snd_music_resampler,
+  dsda_config_snd_cache_size,
   dsda_config_sfx_volume,
   dsda_config_music_volume,
   dsda_config_mus_pause_opt,
@@ -165,12 +172,17 @@ typedef enum {
   dsda_config_mus_portmidi_chorus_level,
   dsda_config_cap_soundcommand,
   dsda_config_cap_videocommand,
+  dsda_config_cap_videocommand_pal8,
   dsda_config_cap_muxcommand,
   dsda_config_cap_tempfile1,
   dsda_config_cap_tempfile2,
   dsda_config_cap_remove_tempfiles,
   dsda_config_cap_wipescreen,
   dsda_config_cap_fps,
+  dsda_config_cap_queue_frames,
+  dsda_config_cap_queue_policy,
+  dsda_config_cap_pal8,
+  dsda_config_cap_concatcommand,
   dsda_config_hudadd_crosshair_color,
   dsda_config_hudadd_crosshair_target_color,
   dsda_config_hud_displayed,
@@ -251,6 +263,12 @@ typedef enum {
   dsda_config_render_patches_scalex,
   dsda_config_render_patches_scaley,
   dsda_config_render_stretchsky,
+  dsda_config_render_dynamic_resolution,
+  dsda_config_render_dynamic_resolution_fps,
+  dsda_config_render_dynamic_resolution_min,
+  dsda_config_render_dynamic_resolution_max,
+  dsda_config_render_plane_threads,
+  dsda_config_render_patch_cache,
   dsda_config_boom_translucent_sprites,
   dsda_config_show_alive_monsters,
   dsda_config_left_analog_deadzone,
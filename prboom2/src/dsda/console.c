@@ -21,6 +21,7 @@
 #include "hu_lib.h"
 #include "hu_stuff.h"
 #include "i_main.h"
+#include "i_sound.h"
 #include "i_system.h"
 #include "lprintf.h"
 #include "m_cheat.h"
@@ -2045,6 +2046,27 @@ static dboolean console_MusicRestart(const char* command, const char* args) {
   return true;
 }
 
+static dboolean console_SoundStats(const char* command, const char* args) {
+  sound_callback_stats_t stats;
+  sound_queue_stats_t queue;
+
+  I_GetSoundCallbackStats(&stats);
+  I_GetSoundQueueStats(&queue);
+
+  if (!stats.callbacks)
+    return false;
+
+  lprintf(LO_INFO, "Last %d audio callbacks (slice %.1f ms):\n", stats.callbacks, stats.slice_ms);
+  lprintf(LO_INFO, "  mix %.2f ms (max %.2f), spacing %.2f ms (max %.2f)\n",
+          stats.mix_ms, stats.mix_ms_max, stats.spacing_ms, stats.spacing_ms_max);
+  lprintf(LO_INFO, "  music %.2f ms (max %.2f), channels %d (max %d)\n",
+          stats.music_ms, stats.music_ms_max, stats.channels, stats.channels_max);
+  lprintf(LO_INFO, "  %d underruns, %d sound commands dropped (peak queue depth %d)\n",
+          stats.underruns, queue.dropped, queue.peak);
+
+  return true;
+}
+
 static dboolean console_AllGhosts(const char* command, const char* args) {
   if (bmapwidth)
     bmapwidth = 0;
@@ -2081,6 +2103,7 @@ static console_command_entry_t console_commands[] = {
   { "player.round_xy", console_PlayerRoundXY, CF_NEVER },
 
   { "music.restart", console_MusicRestart, CF_ALWAYS },
+  { "sound.stats", console_SoundStats, CF_ALWAYS },
 
   { "script.run", console_ScriptRun, CF_ALWAYS },
   { "check", console_Check, CF_ALWAYS },
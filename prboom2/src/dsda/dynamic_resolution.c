@@ -0,0 +1,146 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Dynamic Resolution
+//
+//  Adapts the internal resolution of the software 3D view to hold a
+//  target frame rate. The status bar and hud stay at native resolution.
+//
+
+#include <math.h>
+
+#include "doomstat.h"
+#include "i_capture.h"
+#include "r_main.h"
+#include "v_video.h"
+
+#include "dsda/configuration.h"
+#include "dsda/pause.h"
+#include "dsda/time.h"
+
+#include "dynamic_resolution.h"
+
+// Frames averaged per decision
+#define SAMPLE_FRAMES 16
+
+// Frames to wait after a change before considering another one
+#define COOLDOWN_FRAMES 48
+
+// Scale granularity, in percent
+#define SCALE_STEP 5
+
+// Hysteresis band, in percent of the frame budget:
+// scale down above the upper bound, scale up below the lower bound
+#define UPPER_BOUND 105
+#define LOWER_BOUND 80
+
+static int scale = 100;
+static int sample_count;
+static unsigned long long sample_time;
+static int cooldown;
+
+static dboolean dsda_DynamicResolution(void) {
+  return V_IsSoftwareMode() &&
+         !capturing_video &&
+         dsda_IntConfig(dsda_config_render_dynamic_resolution);
+}
+
+static int dsda_MinScale(void) {
+  return dsda_IntConfig(dsda_config_render_dynamic_resolution_min);
+}
+
+static int dsda_MaxScale(void) {
+  return MAX(dsda_MinScale(), dsda_IntConfig(dsda_config_render_dynamic_resolution_max));
+}
+
+int dsda_DynamicResolutionScale(void) {
+  if (!dsda_DynamicResolution())
+    return 100;
+
+  return BETWEEN(dsda_MinScale(), dsda_MaxScale(), scale);
+}
+
+static void dsda_ResetSamples(void) {
+  sample_count = 0;
+  sample_time = 0;
+}
+
+void dsda_ResetDynamicResolution(void) {
+  scale = dsda_MaxScale();
+  cooldown = COOLDOWN_FRAMES;
+  dsda_ResetSamples();
+
+  R_SetViewSize();
+}
+
+void dsda_StartDynamicResolutionFrame(void) {
+  dsda_StartTimer(dsda_timer_dynamic_resolution);
+}
+
+static int dsda_EvaluateScale(int current_scale, unsigned long long frame_time) {
+  unsigned long long budget;
+  int new_scale;
+
+  budget = 1000000 / dsda_IntConfig(dsda_config_render_dynamic_resolution_fps);
+
+  new_scale = current_scale;
+
+  if (frame_time * 100 > budget * UPPER_BOUND) {
+    // Cost is roughly proportional to the pixel count, which is quadratic in the scale
+    new_scale = (int) (current_scale * sqrt((double) budget / frame_time));
+    new_scale -= new_scale % SCALE_STEP;
+
+    if (new_scale >= current_scale)
+      new_scale = current_scale - SCALE_STEP;
+  }
+  else if (frame_time * 100 < budget * LOWER_BOUND) {
+    // Step up slowly so that a single cheap view doesn't cause a jump
+    new_scale = current_scale + SCALE_STEP;
+  }
+
+  return BETWEEN(dsda_MinScale(), dsda_MaxScale(), new_scale);
+}
+
+// Called once the view has been drawn, before presenting the frame
+void dsda_EndDynamicResolutionFrame(void) {
+  int current_scale;
+  int new_scale;
+
+  if (!dsda_DynamicResolution() || gamestate != GS_LEVEL || dsda_CameraPaused()) {
+    dsda_ResetSamples();
+    return;
+  }
+
+  if (cooldown) {
+    --cooldown;
+    return;
+  }
+
+  sample_time += dsda_ElapsedTime(dsda_timer_dynamic_resolution);
+  ++sample_count;
+
+  if (sample_count < SAMPLE_FRAMES)
+    return;
+
+  current_scale = dsda_DynamicResolutionScale();
+  new_scale = dsda_EvaluateScale(current_scale, sample_time / sample_count);
+  dsda_ResetSamples();
+
+  if (new_scale != current_scale) {
+    scale = new_scale;
+    cooldown = COOLDOWN_FRAMES;
+
+    R_ExecuteSetViewScale();
+  }
+}
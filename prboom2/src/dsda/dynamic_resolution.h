@@ -0,0 +1,26 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Dynamic Resolution
+//
+
+#ifndef __DSDA_DYNAMIC_RESOLUTION__
+#define __DSDA_DYNAMIC_RESOLUTION__
+
+int dsda_DynamicResolutionScale(void);
+void dsda_ResetDynamicResolution(void);
+void dsda_StartDynamicResolutionFrame(void);
+void dsda_EndDynamicResolutionFrame(void);
+
+#endif
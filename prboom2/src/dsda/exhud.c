@@ -76,6 +76,7 @@ typedef enum {
   exhud_event_split,
   exhud_level_splits,
   exhud_minimap,
+  exhud_sound_stats,
   exhud_component_count,
 } exhud_component_id_t;
 
@@ -253,6 +254,13 @@ exhud_component_t components[exhud_component_count] = {
     "minimap",
     .off_by_default = true,
   },
+  [exhud_sound_stats] = {
+    dsda_InitSoundStatsHC,
+    dsda_UpdateSoundStatsHC,
+    dsda_DrawSoundStatsHC,
+    "sound_stats",
+    .off_by_default = true,
+  },
 };
 
 int exhud_color_default;
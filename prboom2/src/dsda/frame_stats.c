@@ -0,0 +1,244 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Frame Stats
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "lprintf.h"
+
+#include "dsda/time.h"
+
+#include "frame_stats.h"
+
+// Histogram buckets are 10 microseconds wide, up to 100 ms
+#define BUCKET_US 10
+#define BUCKET_COUNT 10000
+#define WORST_FRAME_COUNT 20
+
+#define FRAME_LOG_VERSION 1
+
+typedef struct {
+  unsigned int buckets[BUCKET_COUNT + 1];
+  unsigned long long total;
+  unsigned long long min;
+  unsigned long long max;
+  unsigned int count;
+} frame_histogram_t;
+
+typedef struct {
+  unsigned long long time;
+  int tic;
+  char map[9];
+} worst_frame_t;
+
+// Binary log record, written in native byte order
+typedef struct {
+  int type;
+  int tic;
+  int episode;
+  int map;
+  unsigned int time;
+} frame_log_record_t;
+
+typedef enum {
+  frame_log_render,
+  frame_log_tic,
+} frame_log_type_t;
+
+static frame_histogram_t frame_histogram;
+static frame_histogram_t tic_histogram;
+static worst_frame_t worst_frames[WORST_FRAME_COUNT];
+static int worst_frame_count;
+
+static unsigned long long frame_start;
+static unsigned long long tic_start;
+
+static FILE* frame_log;
+
+void dsda_InitFrameLog(const char* name) {
+  int version;
+
+  frame_log = fopen(name, "wb");
+
+  if (frame_log == NULL)
+    I_Error("dsda_InitFrameLog: failed to open %s", name);
+
+  version = FRAME_LOG_VERSION;
+  fwrite(&version, sizeof(int), 1, frame_log);
+}
+
+static void dsda_WriteFrameLog(frame_log_type_t type, unsigned long long time) {
+  frame_log_record_t record;
+
+  if (!frame_log)
+    return;
+
+  record.type = type;
+  record.tic = logictic;
+  record.episode = gameepisode;
+  record.map = gamemap;
+  record.time = (unsigned int) (time / 1000);
+
+  fwrite(&record, sizeof(record), 1, frame_log);
+}
+
+static void dsda_AddToHistogram(frame_histogram_t* histogram, unsigned long long time) {
+  unsigned long long bucket;
+
+  bucket = time / 1000 / BUCKET_US;
+  if (bucket > BUCKET_COUNT)
+    bucket = BUCKET_COUNT;
+
+  ++histogram->buckets[bucket];
+
+  if (!histogram->count || time < histogram->min)
+    histogram->min = time;
+
+  if (time > histogram->max)
+    histogram->max = time;
+
+  histogram->total += time;
+  ++histogram->count;
+}
+
+static void dsda_RecordWorstFrame(unsigned long long time) {
+  int i;
+
+  if (worst_frame_count == WORST_FRAME_COUNT && time <= worst_frames[WORST_FRAME_COUNT - 1].time)
+    return;
+
+  if (worst_frame_count < WORST_FRAME_COUNT)
+    ++worst_frame_count;
+
+  // Keep the list sorted from slowest to fastest
+  for (i = worst_frame_count - 1; i > 0 && worst_frames[i - 1].time < time; --i)
+    worst_frames[i] = worst_frames[i - 1];
+
+  worst_frames[i].time = time;
+  worst_frames[i].tic = logictic;
+
+  if (gamestate == GS_LEVEL)
+    strcpy(worst_frames[i].map, MAPNAME(gameepisode, gamemap));
+  else
+    strcpy(worst_frames[i].map, "-");
+}
+
+void dsda_StartFrameTimer(void) {
+  if (!timingdemo)
+    return;
+
+  frame_start = dsda_TimeNS();
+}
+
+void dsda_EndFrameTimer(void) {
+  unsigned long long time;
+
+  if (!timingdemo || !frame_start)
+    return;
+
+  time = dsda_TimeNS() - frame_start;
+  frame_start = 0;
+
+  dsda_AddToHistogram(&frame_histogram, time);
+  dsda_RecordWorstFrame(time);
+  dsda_WriteFrameLog(frame_log_render, time);
+}
+
+void dsda_StartTicTimer(void) {
+  if (!timingdemo)
+    return;
+
+  tic_start = dsda_TimeNS();
+}
+
+void dsda_EndTicTimer(void) {
+  unsigned long long time;
+
+  if (!timingdemo || !tic_start)
+    return;
+
+  time = dsda_TimeNS() - tic_start;
+  tic_start = 0;
+
+  dsda_AddToHistogram(&tic_histogram, time);
+  dsda_WriteFrameLog(frame_log_tic, time);
+}
+
+// Returns the upper bound of the bucket holding the given percentile
+static double dsda_HistogramPercentile(frame_histogram_t* histogram, int percent) {
+  unsigned int target;
+  unsigned int sum = 0;
+  int i;
+
+  target = (unsigned int) (((unsigned long long) histogram->count * percent + 99) / 100);
+  if (!target)
+    target = 1;
+
+  for (i = 0; i < BUCKET_COUNT; ++i) {
+    sum += histogram->buckets[i];
+
+    if (sum >= target) {
+      unsigned long long bound = (unsigned long long) (i + 1) * BUCKET_US * 1000;
+
+      return (double) MIN(bound, histogram->max) / 1000000;
+    }
+  }
+
+  return (double) histogram->max / 1000000;
+}
+
+static void dsda_ReportHistogram(const char* name, frame_histogram_t* histogram) {
+  if (!histogram->count)
+    return;
+
+  lprintf(
+    LO_INFO,
+    "%s time (ms): min %.3f avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f (%u samples)\n",
+    name,
+    (double) histogram->min / 1000000,
+    (double) histogram->total / histogram->count / 1000000,
+    dsda_HistogramPercentile(histogram, 50),
+    dsda_HistogramPercentile(histogram, 95),
+    dsda_HistogramPercentile(histogram, 99),
+    (double) histogram->max / 1000000,
+    histogram->count
+  );
+}
+
+void dsda_ReportFrameStats(void) {
+  int i;
+
+  dsda_ReportHistogram("Frame", &frame_histogram);
+  dsda_ReportHistogram("Tic", &tic_histogram);
+
+  if (worst_frame_count) {
+    lprintf(LO_INFO, "Worst frames:\n");
+
+    for (i = 0; i < worst_frame_count; ++i)
+      lprintf(
+        LO_INFO, "  %8.3f ms at logictic %d (%s)\n",
+        (double) worst_frames[i].time / 1000000,
+        worst_frames[i].tic, worst_frames[i].map
+      );
+  }
+
+  if (frame_log) {
+    fclose(frame_log);
+    frame_log = NULL;
+  }
+}
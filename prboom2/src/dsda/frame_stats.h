@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Frame Stats
+//
+
+#ifndef __DSDA_FRAME_STATS__
+#define __DSDA_FRAME_STATS__
+
+void dsda_InitFrameLog(const char* name);
+void dsda_StartFrameTimer(void);
+void dsda_EndFrameTimer(void);
+void dsda_StartTicTimer(void);
+void dsda_EndTicTimer(void);
+void dsda_ReportFrameStats(void);
+
+#endif
@@ -0,0 +1,227 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Atlas
+//
+//  Packs images into square pages with a shelf allocator. Each image is
+//  surrounded by a gutter so that the caller can replicate its edges and
+//  avoid sampling neighbours. Regions are looked up by an opaque key.
+//  There is no gl code here: the caller owns the page textures.
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include "z_zone.h"
+
+#include "atlas.h"
+
+typedef struct {
+  int page;
+  int y;
+  int height;
+  int used_width;
+} atlas_shelf_t;
+
+typedef struct {
+  const void* key;
+  dsda_atlas_region_t region;
+} atlas_entry_t;
+
+struct dsda_atlas_s {
+  int page_size;
+  int max_pages;
+  int gutter;
+
+  int page_count;
+  int last_page_height;
+
+  atlas_shelf_t* shelves;
+  int shelf_count;
+  int shelf_capacity;
+
+  // open addressing, power of two size
+  atlas_entry_t* entries;
+  int entry_count;
+  int entry_capacity;
+};
+
+static unsigned int dsda_AtlasHash(const void* key) {
+  uintptr_t x = (uintptr_t) key;
+
+  x ^= x >> 17;
+  x *= 0xed5ad4bbU;
+  x ^= x >> 11;
+  x *= 0xac4c1b51U;
+  x ^= x >> 15;
+
+  return (unsigned int) x;
+}
+
+static atlas_entry_t* dsda_AtlasSlot(atlas_entry_t* entries, int capacity, const void* key) {
+  unsigned int mask = capacity - 1;
+  unsigned int i = dsda_AtlasHash(key) & mask;
+
+  while (entries[i].key && entries[i].key != key)
+    i = (i + 1) & mask;
+
+  return &entries[i];
+}
+
+static void dsda_GrowAtlasEntries(dsda_atlas_t* atlas) {
+  atlas_entry_t* old_entries = atlas->entries;
+  int old_capacity = atlas->entry_capacity;
+  int i;
+
+  atlas->entry_capacity = old_capacity ? old_capacity * 2 : 256;
+  atlas->entries = Z_Calloc(atlas->entry_capacity, sizeof(*atlas->entries));
+
+  for (i = 0; i < old_capacity; ++i)
+    if (old_entries[i].key)
+      *dsda_AtlasSlot(atlas->entries, atlas->entry_capacity, old_entries[i].key) = old_entries[i];
+
+  Z_Free(old_entries);
+}
+
+static atlas_shelf_t* dsda_AddAtlasShelf(dsda_atlas_t* atlas, int height) {
+  atlas_shelf_t* shelf;
+
+  if (!atlas->page_count || atlas->last_page_height + height > atlas->page_size) {
+    if (atlas->page_count == atlas->max_pages)
+      return NULL;
+
+    ++atlas->page_count;
+    atlas->last_page_height = 0;
+  }
+
+  if (atlas->shelf_count == atlas->shelf_capacity) {
+    atlas->shelf_capacity = atlas->shelf_capacity ? atlas->shelf_capacity * 2 : 32;
+    atlas->shelves = Z_Realloc(atlas->shelves, atlas->shelf_capacity * sizeof(*atlas->shelves));
+  }
+
+  shelf = &atlas->shelves[atlas->shelf_count++];
+  shelf->page = atlas->page_count - 1;
+  shelf->y = atlas->last_page_height;
+  shelf->height = height;
+  shelf->used_width = 0;
+
+  atlas->last_page_height += height;
+
+  return shelf;
+}
+
+dsda_atlas_t* dsda_CreateAtlas(int page_size, int max_pages, int gutter) {
+  dsda_atlas_t* atlas;
+
+  atlas = Z_Calloc(1, sizeof(*atlas));
+  atlas->page_size = page_size;
+  atlas->max_pages = max_pages;
+  atlas->gutter = gutter;
+
+  return atlas;
+}
+
+void dsda_FreeAtlas(dsda_atlas_t* atlas) {
+  if (!atlas)
+    return;
+
+  Z_Free(atlas->shelves);
+  Z_Free(atlas->entries);
+  Z_Free(atlas);
+}
+
+void dsda_ResetAtlas(dsda_atlas_t* atlas) {
+  atlas->page_count = 0;
+  atlas->last_page_height = 0;
+  atlas->shelf_count = 0;
+  atlas->entry_count = 0;
+
+  if (atlas->entries)
+    memset(atlas->entries, 0, atlas->entry_capacity * sizeof(*atlas->entries));
+}
+
+const dsda_atlas_region_t* dsda_AtlasFind(dsda_atlas_t* atlas, const void* key) {
+  atlas_entry_t* entry;
+
+  if (!atlas->entry_count)
+    return NULL;
+
+  entry = dsda_AtlasSlot(atlas->entries, atlas->entry_capacity, key);
+
+  return entry->key ? &entry->region : NULL;
+}
+
+// Shelves only ever open on the newest page, but images can land on any
+//   shelf with room, so small images keep filling older pages
+const dsda_atlas_region_t* dsda_AtlasInsert(dsda_atlas_t* atlas, const void* key,
+                                            int width, int height) {
+  atlas_shelf_t* best = NULL;
+  atlas_entry_t* entry;
+  int padded_width, padded_height;
+  int i;
+
+  if ((atlas->entry_count + 1) * 4 > atlas->entry_capacity * 3)
+    dsda_GrowAtlasEntries(atlas);
+
+  entry = dsda_AtlasSlot(atlas->entries, atlas->entry_capacity, key);
+  if (entry->key)
+    return &entry->region;
+
+  entry->key = key;
+  entry->region.page = -1;
+  entry->region.x = 0;
+  entry->region.y = 0;
+  entry->region.width = width;
+  entry->region.height = height;
+  ++atlas->entry_count;
+
+  padded_width = width + 2 * atlas->gutter;
+  padded_height = height + 2 * atlas->gutter;
+
+  if (width <= 0 || height <= 0 ||
+      padded_width > atlas->page_size || padded_height > atlas->page_size)
+    return &entry->region;
+
+  // Avoid wasting a tall shelf on a short image
+  for (i = 0; i < atlas->shelf_count; ++i) {
+    atlas_shelf_t* shelf = &atlas->shelves[i];
+
+    if (shelf->height >= padded_height &&
+        shelf->height <= padded_height + padded_height / 2 &&
+        shelf->used_width + padded_width <= atlas->page_size &&
+        (!best || shelf->height < best->height))
+      best = shelf;
+  }
+
+  if (!best)
+    best = dsda_AddAtlasShelf(atlas, padded_height);
+
+  if (!best)
+    return &entry->region;
+
+  entry->region.page = best->page;
+  entry->region.x = best->used_width + atlas->gutter;
+  entry->region.y = best->y + atlas->gutter;
+  best->used_width += padded_width;
+
+  return &entry->region;
+}
+
+int dsda_AtlasPageCount(const dsda_atlas_t* atlas) {
+  return atlas->page_count;
+}
+
+int dsda_AtlasPageSize(const dsda_atlas_t* atlas) {
+  return atlas->page_size;
+}
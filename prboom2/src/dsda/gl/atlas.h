@@ -0,0 +1,41 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Atlas
+//
+
+#ifndef __DSDA_GL_ATLAS__
+#define __DSDA_GL_ATLAS__
+
+#include "doomtype.h"
+
+// page is -1 if the image was rejected (too big or the atlas is full)
+typedef struct {
+  int page;
+  int x, y;
+  int width, height;
+} dsda_atlas_region_t;
+
+typedef struct dsda_atlas_s dsda_atlas_t;
+
+dsda_atlas_t* dsda_CreateAtlas(int page_size, int max_pages, int gutter);
+void dsda_FreeAtlas(dsda_atlas_t* atlas);
+void dsda_ResetAtlas(dsda_atlas_t* atlas);
+const dsda_atlas_region_t* dsda_AtlasFind(dsda_atlas_t* atlas, const void* key);
+const dsda_atlas_region_t* dsda_AtlasInsert(dsda_atlas_t* atlas, const void* key,
+                                            int width, int height);
+int dsda_AtlasPageCount(const dsda_atlas_t* atlas);
+int dsda_AtlasPageSize(const dsda_atlas_t* atlas);
+
+#endif
@@ -0,0 +1,198 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *
+ *---------------------------------------------------------------------
+ */
+
+/*
+*
+** gl_clipper.cpp
+**
+** Handles visibility checks.
+** Loosely based on the JDoom clipper.
+**
+**---------------------------------------------------------------------------
+** Copyright 2003 Tim Stump
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+// The angle ranges already covered by the gl clipper (gl_clipper.c).
+// The ranges are kept in a sorted array. Ranges never overlap or touch
+// (touching ranges are merged), so both the starts and the ends are
+// strictly increasing and every lookup is a binary search.
+// There is no gl code here, so tools/clipcheck.c can build it.
+
+#include <string.h>
+
+#include "z_zone.h"
+
+#include "clip_ranges.h"
+
+typedef struct {
+  angle_t start, end;
+} cliprange_t;
+
+static cliprange_t* clipranges;
+static int numclipranges;
+static int maxclipranges;
+
+// index of the first range that ends at or after angle
+static int dsda_FirstEndingAfter(angle_t angle) {
+  int low = 0;
+  int high = numclipranges;
+
+  while (low < high) {
+    int mid = (low + high) / 2;
+
+    if (clipranges[mid].end < angle)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+// index of the first range that starts after angle
+static int dsda_FirstStartingAfter(angle_t angle) {
+  int low = 0;
+  int high = numclipranges;
+
+  while (low < high) {
+    int mid = (low + high) / 2;
+
+    if (clipranges[mid].start <= angle)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+static dboolean dsda_IsRangeVisible(angle_t start, angle_t end) {
+  cliprange_t* range;
+  int i;
+
+  if (!numclipranges)
+    return true;
+
+  if (end == 0 && clipranges[0].start == 0)
+    return false;
+
+  // only the last range starting at or before start can contain it
+  i = dsda_FirstStartingAfter(start) - 1;
+  if (i < 0)
+    return true;
+
+  range = &clipranges[i];
+
+  return !(range->start < end && end <= range->end);
+}
+
+static void dsda_AddRange(angle_t start, angle_t end) {
+  int first, last;
+
+  // ranges [first, last] overlap or touch the new one
+  first = dsda_FirstEndingAfter(start);
+  last = dsda_FirstStartingAfter(end) - 1;
+
+  if (first > last) {
+    if (numclipranges == maxclipranges) {
+      maxclipranges = maxclipranges ? maxclipranges * 2 : 128;
+      clipranges = Z_Realloc(clipranges, maxclipranges * sizeof(*clipranges));
+    }
+
+    memmove(&clipranges[first + 1], &clipranges[first],
+            (numclipranges - first) * sizeof(*clipranges));
+    clipranges[first].start = start;
+    clipranges[first].end = end;
+    numclipranges++;
+    return;
+  }
+
+  if (clipranges[first].start > start)
+    clipranges[first].start = start;
+
+  clipranges[first].end = MAX(end, clipranges[last].end);
+
+  if (last > first) {
+    memmove(&clipranges[first + 1], &clipranges[last + 1],
+            (numclipranges - last - 1) * sizeof(*clipranges));
+    numclipranges -= last - first;
+  }
+}
+
+void dsda_ClearClipRanges(void) {
+  numclipranges = 0;
+}
+
+dboolean dsda_ClipRangeVisible(angle_t start, angle_t end) {
+  if (start > end)
+    return dsda_IsRangeVisible(start, ANGLE_MAX) || dsda_IsRangeVisible(0, end);
+
+  return dsda_IsRangeVisible(start, end);
+}
+
+void dsda_AddClipRange(angle_t start, angle_t end) {
+  if (start > end) {
+    // The range has to added in two parts.
+    dsda_AddRange(start, ANGLE_MAX);
+    dsda_AddRange(0, end);
+  }
+  else {
+    dsda_AddRange(start, end);
+  }
+}
@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Clip Ranges
+//
+
+#ifndef __DSDA_GL_CLIP_RANGES__
+#define __DSDA_GL_CLIP_RANGES__
+
+#include "tables.h"
+
+// A range with start > end wraps around through ANGLE_MAX
+void dsda_ClearClipRanges(void);
+dboolean dsda_ClipRangeVisible(angle_t start, angle_t end);
+void dsda_AddClipRange(angle_t start, angle_t end);
+
+#endif
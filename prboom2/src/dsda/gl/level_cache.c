@@ -0,0 +1,432 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Level Cache
+//
+//  The flat loops and vertices built by gld_PreprocessSectors are stored
+//  in one file per level under the data root. The file name is a hash of
+//  the loaded geometry (vertices, lines, sides, segs, subsectors, nodes)
+//  and the engine version, so rebuilt nodes, a different gl nodes lump,
+//  or anything else that changes what the preprocessor sees gets a new
+//  entry instead of a stale one.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "gl_opengl.h"
+#include "gl_intern.h"
+#include "lprintf.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "r_state.h"
+#include "z_zone.h"
+
+#include "dsda/configuration.h"
+#include "dsda/data_organizer.h"
+#include "dsda/mkdir.h"
+#include "dsda/utility.h"
+
+#include "level_cache.h"
+
+#define GL_LEVEL_CACHE_VERSION 1
+
+static const char gl_level_cache_magic[8] = { 'D', 'S', 'D', 'A', 'G', 'L', 'L', 'C' };
+
+typedef struct {
+  char magic[8];
+  int version;
+  int num_vertexes;
+  int num_sectors;
+  int num_lines;
+  int num_subsectors;
+  int num_sector_loops;
+  int num_subsector_loops;
+} gl_level_cache_header_t;
+
+// The header is followed by:
+//   per sector: loop count, loop flags, closed
+//   per line: isolated
+//   per subsector: loop count
+//   per loop (sectors, then subsectors): index, mode, vertex count, vertex index
+//   the flat vertices
+typedef struct {
+  int loopcount;
+  unsigned int flags;
+  int closed;
+} gl_level_cache_sector_t;
+
+typedef struct {
+  int index;
+  int mode;
+  int vertexcount;
+  int vertexindex;
+} gl_level_cache_loop_t;
+
+typedef struct {
+  struct MD5Context md5;
+  byte buffer[1024];
+  int size;
+} gl_level_cache_key_t;
+
+static char* gl_level_cache_dir;
+
+static void dsda_HashKeyInt(gl_level_cache_key_t* key, int value) {
+  if (key->size + 4 > sizeof(key->buffer)) {
+    MD5Update(&key->md5, key->buffer, key->size);
+    key->size = 0;
+  }
+
+  key->buffer[key->size++] = value & 0xff;
+  key->buffer[key->size++] = (value >> 8) & 0xff;
+  key->buffer[key->size++] = (value >> 16) & 0xff;
+  key->buffer[key->size++] = (value >> 24) & 0xff;
+}
+
+static void dsda_GLLevelCacheKey(dsda_cksum_t* cksum) {
+  gl_level_cache_key_t key;
+  int i;
+
+  MD5Init(&key.md5);
+  MD5Update(&key.md5, (const byte*) PACKAGE_VERSION, strlen(PACKAGE_VERSION));
+  key.size = 0;
+
+  dsda_HashKeyInt(&key, GL_LEVEL_CACHE_VERSION);
+  dsda_HashKeyInt(&key, use_gl_nodes);
+  dsda_HashKeyInt(&key, numvertexes);
+  dsda_HashKeyInt(&key, numsectors);
+  dsda_HashKeyInt(&key, numlines);
+  dsda_HashKeyInt(&key, numsides);
+  dsda_HashKeyInt(&key, numsegs);
+  dsda_HashKeyInt(&key, numsubsectors);
+  dsda_HashKeyInt(&key, numnodes);
+
+  for (i = 0; i < numvertexes; ++i) {
+    dsda_HashKeyInt(&key, vertexes[i].x);
+    dsda_HashKeyInt(&key, vertexes[i].y);
+  }
+
+  for (i = 0; i < numlines; ++i) {
+    dsda_HashKeyInt(&key, lines[i].v1 - vertexes);
+    dsda_HashKeyInt(&key, lines[i].v2 - vertexes);
+    dsda_HashKeyInt(&key, lines[i].sidenum[0]);
+    dsda_HashKeyInt(&key, lines[i].sidenum[1]);
+  }
+
+  for (i = 0; i < numsides; ++i)
+    dsda_HashKeyInt(&key, sides[i].sector - sectors);
+
+  for (i = 0; i < numsegs; ++i) {
+    dsda_HashKeyInt(&key, segs[i].v1 - vertexes);
+    dsda_HashKeyInt(&key, segs[i].v2 - vertexes);
+  }
+
+  for (i = 0; i < numsubsectors; ++i) {
+    dsda_HashKeyInt(&key, subsectors[i].sector - sectors);
+    dsda_HashKeyInt(&key, subsectors[i].firstline);
+    dsda_HashKeyInt(&key, subsectors[i].numlines);
+  }
+
+  for (i = 0; i < numnodes; ++i) {
+    dsda_HashKeyInt(&key, nodes[i].x);
+    dsda_HashKeyInt(&key, nodes[i].y);
+    dsda_HashKeyInt(&key, nodes[i].dx);
+    dsda_HashKeyInt(&key, nodes[i].dy);
+    dsda_HashKeyInt(&key, nodes[i].children[0]);
+    dsda_HashKeyInt(&key, nodes[i].children[1]);
+  }
+
+  MD5Update(&key.md5, key.buffer, key.size);
+  MD5Final(cksum->bytes, &key.md5);
+  dsda_TranslateCheckSum(cksum);
+}
+
+static char* dsda_GLLevelCachePath(void) {
+  dsda_cksum_t cksum;
+  dsda_string_t path;
+
+  if (!dsda_IntConfig(dsda_config_gl_level_cache))
+    return NULL;
+
+  if (!gl_level_cache_dir) {
+    const char* data_root;
+    int length;
+
+    data_root = dsda_DataRoot();
+
+    length = strlen(data_root) + 16; // "/gl_level_cache\0"
+    gl_level_cache_dir = Z_Malloc(length);
+    snprintf(gl_level_cache_dir, length, "%s/gl_level_cache", data_root);
+
+    dsda_MkDir(gl_level_cache_dir, false);
+  }
+
+  dsda_GLLevelCacheKey(&cksum);
+
+  dsda_InitString(&path, gl_level_cache_dir);
+  dsda_StringCat(&path, "/");
+  dsda_StringCat(&path, cksum.string);
+  dsda_StringCat(&path, ".dat");
+
+  return path.string;
+}
+
+static size_t dsda_GLLevelCacheSize(const gl_level_cache_header_t* header) {
+  return sizeof(*header) +
+         header->num_sectors * sizeof(gl_level_cache_sector_t) +
+         header->num_lines * sizeof(int) +
+         header->num_subsectors * sizeof(int) +
+         (size_t) (header->num_sector_loops + header->num_subsector_loops) * sizeof(gl_level_cache_loop_t) +
+         (size_t) header->num_vertexes * sizeof(vbo_xyz_uv_t);
+}
+
+static dboolean dsda_ValidGLLevelCache(const byte* data, int length) {
+  const gl_level_cache_header_t* header;
+
+  if (length < (int) sizeof(*header))
+    return false;
+
+  header = (const gl_level_cache_header_t*) data;
+
+  return !memcmp(header->magic, gl_level_cache_magic, sizeof(gl_level_cache_magic)) &&
+         header->version == GL_LEVEL_CACHE_VERSION &&
+         header->num_vertexes >= 0 &&
+         header->num_sectors == numsectors &&
+         header->num_lines == numlines &&
+         header->num_subsectors == numsubsectors &&
+         header->num_sector_loops >= 0 &&
+         header->num_subsector_loops >= 0 &&
+         dsda_GLLevelCacheSize(header) == length;
+}
+
+static dboolean dsda_ValidLoops(const gl_level_cache_loop_t* loops, int count, int num_vertexes) {
+  int i;
+
+  for (i = 0; i < count; ++i)
+    if (
+      loops[i].vertexcount < 0 || loops[i].vertexindex < 0 ||
+      loops[i].vertexindex + loops[i].vertexcount > num_vertexes
+    )
+      return false;
+
+  return true;
+}
+
+static GLLoopDef* dsda_LoadLoops(const gl_level_cache_loop_t* source, int count) {
+  GLLoopDef* loops;
+  int i;
+
+  if (!count)
+    return NULL;
+
+  loops = Z_Malloc(count * sizeof(*loops));
+
+  for (i = 0; i < count; ++i) {
+    loops[i].index = source[i].index;
+    loops[i].mode = source[i].mode;
+    loops[i].vertexcount = source[i].vertexcount;
+    loops[i].vertexindex = source[i].vertexindex;
+  }
+
+  return loops;
+}
+
+// Fills sectorloops, subsectorloops, and flats_vbo, which the caller has
+// allocated and cleared, and restores the sector and line flags.
+dboolean dsda_LoadGLLevelCache(int* num_vertexes) {
+  const gl_level_cache_header_t* header;
+  const gl_level_cache_sector_t* sector_info;
+  const int* line_info;
+  const int* subsector_info;
+  const gl_level_cache_loop_t* loops;
+  const vbo_xyz_uv_t* vertex_data;
+  char* path;
+  byte* data = NULL;
+  int length;
+  int loop_total;
+  int i;
+
+  path = dsda_GLLevelCachePath();
+
+  if (!path)
+    return false;
+
+  length = M_ReadFile(path, &data);
+
+  if (length <= 0) {
+    Z_Free(path);
+    return false;
+  }
+
+  if (!dsda_ValidGLLevelCache(data, length)) {
+    lprintf(LO_WARN, "dsda_LoadGLLevelCache: ignoring invalid %s\n", path);
+    Z_Free(data);
+    Z_Free(path);
+    return false;
+  }
+
+  header = (const gl_level_cache_header_t*) data;
+  sector_info = (const gl_level_cache_sector_t*) (header + 1);
+  line_info = (const int*) (sector_info + numsectors);
+  subsector_info = line_info + numlines;
+  loops = (const gl_level_cache_loop_t*) (subsector_info + numsubsectors);
+  vertex_data = (const vbo_xyz_uv_t*) (loops + header->num_sector_loops + header->num_subsector_loops);
+
+  loop_total = 0;
+  for (i = 0; i < numsectors && loop_total >= 0; ++i)
+    loop_total = sector_info[i].loopcount < 0 ? -1 : loop_total + sector_info[i].loopcount;
+  for (i = 0; i < numsubsectors && loop_total >= 0; ++i)
+    loop_total = subsector_info[i] < 0 ? -1 : loop_total + subsector_info[i];
+
+  if (
+    loop_total != header->num_sector_loops + header->num_subsector_loops ||
+    !dsda_ValidLoops(loops, loop_total, header->num_vertexes)
+  ) {
+    lprintf(LO_WARN, "dsda_LoadGLLevelCache: ignoring corrupt %s\n", path);
+    Z_Free(data);
+    Z_Free(path);
+    return false;
+  }
+
+  for (i = 0; i < numsectors; ++i) {
+    if (sector_info[i].closed)
+      sectors[i].flags |= SECTOR_IS_CLOSED;
+    else
+      sectors[i].flags &= ~SECTOR_IS_CLOSED;
+
+    sectorloops[i].loopcount = sector_info[i].loopcount;
+    sectorloops[i].flags = sector_info[i].flags;
+    sectorloops[i].loops = dsda_LoadLoops(loops, sector_info[i].loopcount);
+    loops += sector_info[i].loopcount;
+  }
+
+  for (i = 0; i < numlines; ++i)
+    if (line_info[i])
+      lines[i].r_flags |= RF_ISOLATED;
+
+  for (i = 0; i < numsubsectors; ++i) {
+    subsectorloops[i].loopcount = subsector_info[i];
+    subsectorloops[i].loops = dsda_LoadLoops(loops, subsector_info[i]);
+    loops += subsector_info[i];
+  }
+
+  *num_vertexes = header->num_vertexes;
+  flats_vbo = Z_Malloc(MAX(header->num_vertexes, 1) * sizeof(flats_vbo[0]));
+  memcpy(flats_vbo, vertex_data, header->num_vertexes * sizeof(flats_vbo[0]));
+
+  lprintf(LO_DEBUG, "dsda_LoadGLLevelCache: loaded %s\n", path);
+
+  Z_Free(data);
+  Z_Free(path);
+
+  return true;
+}
+
+static void dsda_WriteLoops(FILE* file, const GLLoopDef* loops, int count) {
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    gl_level_cache_loop_t loop;
+
+    loop.index = loops[i].index;
+    loop.mode = loops[i].mode;
+    loop.vertexcount = loops[i].vertexcount;
+    loop.vertexindex = loops[i].vertexindex;
+
+    fwrite(&loop, sizeof(loop), 1, file);
+  }
+}
+
+void dsda_SaveGLLevelCache(int num_vertexes) {
+  gl_level_cache_header_t header = { 0 };
+  dsda_string_t temp_path;
+  char* path;
+  FILE* file;
+  dboolean ok;
+  int i;
+
+  path = dsda_GLLevelCachePath();
+
+  if (!path)
+    return;
+
+  memcpy(header.magic, gl_level_cache_magic, sizeof(gl_level_cache_magic));
+  header.version = GL_LEVEL_CACHE_VERSION;
+  header.num_vertexes = num_vertexes;
+  header.num_sectors = numsectors;
+  header.num_lines = numlines;
+  header.num_subsectors = numsubsectors;
+
+  for (i = 0; i < numsectors; ++i)
+    header.num_sector_loops += sectorloops[i].loopcount;
+  for (i = 0; i < numsubsectors; ++i)
+    header.num_subsector_loops += subsectorloops[i].loopcount;
+
+  // Written under a temporary name, so other processes never see half a file
+  dsda_InitString(&temp_path, path);
+  dsda_StringCat(&temp_path, ".tmp");
+
+  file = fopen(temp_path.string, "wb");
+
+  if (!file) {
+    dsda_FreeString(&temp_path);
+    Z_Free(path);
+    return;
+  }
+
+  fwrite(&header, sizeof(header), 1, file);
+
+  for (i = 0; i < numsectors; ++i) {
+    gl_level_cache_sector_t sector_info;
+
+    sector_info.loopcount = sectorloops[i].loopcount;
+    sector_info.flags = sectorloops[i].flags;
+    sector_info.closed = (sectors[i].flags & SECTOR_IS_CLOSED) != 0;
+
+    fwrite(&sector_info, sizeof(sector_info), 1, file);
+  }
+
+  for (i = 0; i < numlines; ++i) {
+    int isolated = (lines[i].r_flags & RF_ISOLATED) != 0;
+
+    fwrite(&isolated, sizeof(isolated), 1, file);
+  }
+
+  for (i = 0; i < numsubsectors; ++i)
+    fwrite(&subsectorloops[i].loopcount, sizeof(int), 1, file);
+
+  for (i = 0; i < numsectors; ++i)
+    dsda_WriteLoops(file, sectorloops[i].loops, sectorloops[i].loopcount);
+  for (i = 0; i < numsubsectors; ++i)
+    dsda_WriteLoops(file, subsectorloops[i].loops, subsectorloops[i].loopcount);
+
+  if (num_vertexes)
+    fwrite(flats_vbo, sizeof(flats_vbo[0]), num_vertexes, file);
+
+  ok = !ferror(file);
+  ok = !fclose(file) && ok;
+
+  if (!ok || rename(temp_path.string, path)) {
+    lprintf(LO_WARN, "dsda_SaveGLLevelCache: unable to write %s\n", path);
+    remove(temp_path.string);
+  }
+
+  dsda_FreeString(&temp_path);
+  Z_Free(path);
+}
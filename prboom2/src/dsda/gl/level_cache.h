@@ -0,0 +1,26 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Level Cache
+//
+
+#ifndef __DSDA_GL_LEVEL_CACHE__
+#define __DSDA_GL_LEVEL_CACHE__
+
+#include "doomtype.h"
+
+dboolean dsda_LoadGLLevelCache(int* num_vertexes);
+void dsda_SaveGLLevelCache(int num_vertexes);
+
+#endif
@@ -0,0 +1,145 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Sprite Batch
+//
+//  Collects sprite quads during a frame and turns them into one triangle
+//  list, grouped by atlas page and light state. Each group is a single
+//  draw call. There is no gl code here: the caller uploads the vertices
+//  and issues the draws.
+//
+
+#include <stdlib.h>
+
+#include "z_zone.h"
+
+#include "sprite_batch.h"
+
+typedef struct {
+  int page;
+  float light;
+  float fogdensity;
+  int order;
+  dsda_batch_vertex_t corners[4];
+} batch_quad_t;
+
+static batch_quad_t* quads;
+static int quad_count;
+static int quad_capacity;
+
+static dsda_batch_vertex_t* vertices;
+static int vertex_capacity;
+
+static dsda_batch_range_t* ranges;
+static int range_capacity;
+
+static int dsda_CompareBatchQuads(const void* a, const void* b) {
+  const batch_quad_t* q1 = a;
+  const batch_quad_t* q2 = b;
+
+  if (q1->page != q2->page)
+    return q1->page - q2->page;
+
+  if (q1->light != q2->light)
+    return q1->light < q2->light ? -1 : 1;
+
+  if (q1->fogdensity != q2->fogdensity)
+    return q1->fogdensity < q2->fogdensity ? -1 : 1;
+
+  // Keep submission order within a group
+  return q1->order - q2->order;
+}
+
+void dsda_ResetSpriteBatch(void) {
+  quad_count = 0;
+}
+
+void dsda_AddSpriteBatchQuad(int page, float light, float fogdensity,
+                             const dsda_batch_vertex_t corners[4]) {
+  batch_quad_t* quad;
+  int i;
+
+  if (quad_count == quad_capacity) {
+    quad_capacity = quad_capacity ? quad_capacity * 2 : 256;
+    quads = Z_Realloc(quads, quad_capacity * sizeof(*quads));
+  }
+
+  quad = &quads[quad_count];
+  quad->page = page;
+  quad->light = light;
+  quad->fogdensity = fogdensity;
+  quad->order = quad_count;
+  for (i = 0; i < 4; ++i)
+    quad->corners[i] = corners[i];
+
+  ++quad_count;
+}
+
+int dsda_SpriteBatchQuadCount(void) {
+  return quad_count;
+}
+
+int dsda_BuildSpriteBatch(const dsda_batch_vertex_t** vertices_out,
+                          const dsda_batch_range_t** ranges_out) {
+  dsda_batch_range_t* range = NULL;
+  int range_count = 0;
+  int i;
+
+  if (quad_count > 1)
+    qsort(quads, quad_count, sizeof(*quads), dsda_CompareBatchQuads);
+
+  if (quad_count * 6 > vertex_capacity) {
+    vertex_capacity = quad_count * 6;
+    vertices = Z_Realloc(vertices, vertex_capacity * sizeof(*vertices));
+  }
+
+  for (i = 0; i < quad_count; ++i) {
+    const batch_quad_t* quad = &quads[i];
+    dsda_batch_vertex_t* v = &vertices[i * 6];
+
+    if (
+      !range ||
+      range->page != quad->page ||
+      range->light != quad->light ||
+      range->fogdensity != quad->fogdensity
+    ) {
+      if (range_count == range_capacity) {
+        range_capacity = range_capacity ? range_capacity * 2 : 64;
+        ranges = Z_Realloc(ranges, range_capacity * sizeof(*ranges));
+      }
+
+      range = &ranges[range_count++];
+      range->page = quad->page;
+      range->light = quad->light;
+      range->fogdensity = quad->fogdensity;
+      range->first = i * 6;
+      range->count = 0;
+    }
+
+    // Strip order 0 1 2 3 becomes triangles 0 1 2 and 2 1 3
+    v[0] = quad->corners[0];
+    v[1] = quad->corners[1];
+    v[2] = quad->corners[2];
+    v[3] = quad->corners[2];
+    v[4] = quad->corners[1];
+    v[5] = quad->corners[3];
+
+    range->count += 6;
+  }
+
+  *vertices_out = vertices;
+  *ranges_out = ranges;
+
+  return range_count;
+}
@@ -0,0 +1,44 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA GL Sprite Batch
+//
+
+#ifndef __DSDA_GL_SPRITE_BATCH__
+#define __DSDA_GL_SPRITE_BATCH__
+
+typedef struct {
+  float x, y, z;
+  float u, v;
+} dsda_batch_vertex_t;
+
+// Consecutive vertices (triangles) that share a page and light state
+typedef struct {
+  int page;
+  float light;
+  float fogdensity;
+  int first;
+  int count;
+} dsda_batch_range_t;
+
+void dsda_ResetSpriteBatch(void);
+
+// Corners are in triangle strip order: top left, top right, bottom left, bottom right
+void dsda_AddSpriteBatchQuad(int page, float light, float fogdensity,
+                             const dsda_batch_vertex_t corners[4]);
+
+int dsda_SpriteBatchQuadCount(void);
+int dsda_BuildSpriteBatch(const dsda_batch_vertex_t** vertices, const dsda_batch_range_t** ranges);
+
+#endif
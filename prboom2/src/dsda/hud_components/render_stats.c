@@ -15,13 +15,15 @@
 //	DSDA Render Stats HUD Component
 //
 
+#include "v_video.h"
+
 #include "dsda/render_stats.h"
 
 #include "base.h"
 
 #include "render_stats.h"
 
-static dsda_text_t component[2];
+static dsda_text_t component[3];
 
 static void dsda_UpdateCurrentComponentText(char* str, size_t max_size) {
   extern dsda_render_stats_t dsda_render_stats;
@@ -63,19 +65,63 @@ static void dsda_UpdateMaxComponentText(char* str, size_t max_size) {
   );
 }
 
+static void dsda_UpdateDrawCallComponentText(char* str, size_t max_size) {
+  extern dsda_render_stats_t dsda_render_stats;
+  extern dsda_render_stats_t dsda_render_stats_max;
+
+  snprintf(
+    str, max_size,
+    "\x1b%cDRAWS \x1b%c%4d \x1b%cMAX \x1b%c%4d",
+    HUlib_Color(CR_GRAY),
+    dsda_render_stats.drawcalls > 2048 ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    dsda_render_stats.drawcalls,
+    HUlib_Color(CR_GRAY),
+    dsda_render_stats_max.drawcalls > 2048 ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    dsda_render_stats_max.drawcalls
+  );
+}
+
+static void dsda_UpdatePlaneWorkerComponentText(char* str, size_t max_size) {
+  extern int dsda_render_stats_plane_workers;
+  extern int dsda_render_stats_plane_worker_time[];
+  size_t length;
+  int i;
+
+  str[0] = '\0';
+
+  if (dsda_render_stats_plane_workers < 2)
+    return;
+
+  length = snprintf(str, max_size, "\x1b%cPLANE MS\x1b%c", HUlib_Color(CR_GRAY), HUlib_Color(CR_GOLD));
+
+  for (i = 0; i < dsda_render_stats_plane_workers && length < max_size; ++i)
+    length += snprintf(
+      str + length, max_size - length, " %d.%d",
+      dsda_render_stats_plane_worker_time[i] / 1000,
+      dsda_render_stats_plane_worker_time[i] % 1000 / 100
+    );
+}
+
 void dsda_InitRenderStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count) {
   dsda_InitTextHC(&component[0], x_offset, y_offset, vpt);
   dsda_InitTextHC(&component[1], x_offset, y_offset + 8, vpt);
+  dsda_InitTextHC(&component[2], x_offset, y_offset + 16, vpt);
 }
 
 void dsda_UpdateRenderStatsHC(void) {
   dsda_UpdateCurrentComponentText(component[0].msg, sizeof(component[0].msg));
   dsda_UpdateMaxComponentText(component[1].msg, sizeof(component[1].msg));
+  if (V_IsOpenGLMode())
+    dsda_UpdateDrawCallComponentText(component[2].msg, sizeof(component[2].msg));
+  else
+    dsda_UpdatePlaneWorkerComponentText(component[2].msg, sizeof(component[2].msg));
   dsda_RefreshHudText(&component[0]);
   dsda_RefreshHudText(&component[1]);
+  dsda_RefreshHudText(&component[2]);
 }
 
 void dsda_DrawRenderStatsHC(void) {
   dsda_DrawBasicText(&component[0]);
   dsda_DrawBasicText(&component[1]);
+  dsda_DrawBasicText(&component[2]);
 }
@@ -0,0 +1,82 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Sound Stats HUD Component
+//
+
+#include "i_sound.h"
+
+#include "base.h"
+
+#include "sound_stats.h"
+
+static dsda_text_t component[2];
+
+static void dsda_UpdateTimingComponentText(char* str, size_t max_size,
+                                           const sound_callback_stats_t* stats) {
+  snprintf(
+    str, max_size,
+    "\x1b%cMIX \x1b%c%4.1f \x1b%cMAX \x1b%c%4.1f \x1b%cGAP \x1b%c%4.1f \x1b%cMAX \x1b%c%4.1f",
+    HUlib_Color(CR_GRAY),
+    HUlib_Color(CR_GOLD),
+    stats->mix_ms,
+    HUlib_Color(CR_GRAY),
+    stats->mix_ms_max > stats->slice_ms / 2 ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    stats->mix_ms_max,
+    HUlib_Color(CR_GRAY),
+    HUlib_Color(CR_GOLD),
+    stats->spacing_ms,
+    HUlib_Color(CR_GRAY),
+    stats->spacing_ms_max > stats->slice_ms * 3 / 2 ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    stats->spacing_ms_max
+  );
+}
+
+static void dsda_UpdateLoadComponentText(char* str, size_t max_size,
+                                         const sound_callback_stats_t* stats) {
+  snprintf(
+    str, max_size,
+    "\x1b%cCHANNELS \x1b%c%2d \x1b%cMUSIC \x1b%c%4.1f \x1b%cUNDERRUNS \x1b%c%d",
+    HUlib_Color(CR_GRAY),
+    HUlib_Color(CR_GOLD),
+    stats->channels_max,
+    HUlib_Color(CR_GRAY),
+    stats->music_ms_max > stats->slice_ms / 2 ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    stats->music_ms_max,
+    HUlib_Color(CR_GRAY),
+    stats->underruns ? HUlib_Color(CR_RED) : HUlib_Color(CR_GOLD),
+    stats->underruns
+  );
+}
+
+void dsda_InitSoundStatsHC(int x_offset, int y_offset, int vpt, int* args, int arg_count) {
+  dsda_InitTextHC(&component[0], x_offset, y_offset, vpt);
+  dsda_InitTextHC(&component[1], x_offset, y_offset + 8, vpt);
+}
+
+void dsda_UpdateSoundStatsHC(void) {
+  sound_callback_stats_t stats;
+
+  I_GetSoundCallbackStats(&stats);
+
+  dsda_UpdateTimingComponentText(component[0].msg, sizeof(component[0].msg), &stats);
+  dsda_UpdateLoadComponentText(component[1].msg, sizeof(component[1].msg), &stats);
+  dsda_RefreshHudText(&component[0]);
+  dsda_RefreshHudText(&component[1]);
+}
+
+void dsda_DrawSoundStatsHC(void) {
+  dsda_DrawBasicText(&component[0]);
+  dsda_DrawBasicText(&component[1]);
+}
@@ -0,0 +1,542 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Patch Cache
+//
+//  Converted patches and texture composites are stored in a single file
+//  under the data root, keyed on a hash of everything that affects the
+//  conversion. The file is mapped copy-on-write, so cached patches point
+//  straight into the mapping and only the column table gets relocated.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(HAVE_MMAP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/configuration.h"
+#include "dsda/data_organizer.h"
+#include "dsda/utility.h"
+
+#include "patch_cache.h"
+
+#define PATCH_CACHE_VERSION 1
+#define PATCH_CACHE_LIMIT (512 * 1024 * 1024)
+#define PATCH_CACHE_ALIGN(x) (((x) + 7) & ~7)
+
+static const char patch_cache_magic[8] = { 'D', 'S', 'D', 'A', 'P', 'T', 'C', 'H' };
+
+typedef struct {
+  char magic[8];
+  int version;
+  int pointer_size;
+  int column_size;
+  int post_size;
+} patch_cache_header_t;
+
+// Each entry is followed by the patch data in the same layout r_patch uses:
+// pixels, columns, posts, and then a (post index, post count) pair per column
+typedef struct {
+  byte key[DSDA_PATCH_CACHE_KEY_LENGTH];
+  int size;
+  int width;
+  int height;
+  int widthmask;
+  int leftoffset;
+  int topoffset;
+  unsigned int flags;
+  int pixel_size;
+  int post_count;
+  int reserved;
+} patch_cache_entry_t;
+
+typedef struct {
+  const byte* key;
+  patch_cache_entry_t* entry;
+} patch_cache_slot_t;
+
+static dboolean patch_cache_initialized;
+static dboolean patch_cache_enabled;
+static char* patch_cache_filename;
+
+static byte* cache_data;
+static size_t cache_size;
+static size_t cache_end;
+static dboolean cache_valid;
+static dboolean cache_mapped;
+
+#ifdef _WIN32
+static HANDLE cache_file_handle = INVALID_HANDLE_VALUE;
+static HANDLE cache_map_handle;
+#endif
+
+static patch_cache_slot_t* slots;
+static unsigned int slot_mask;
+static unsigned int slot_count;
+
+static byte* pending_data;
+static size_t pending_size;
+static size_t pending_capacity;
+
+static byte (*lump_cksums)[DSDA_PATCH_CACHE_KEY_LENGTH];
+static byte* lump_cksum_ready;
+
+static unsigned int dsda_PatchCacheHash(const byte* key) {
+  return key[0] | (key[1] << 8) | (key[2] << 16) | ((unsigned int) key[3] << 24);
+}
+
+static patch_cache_slot_t* dsda_FindSlot(const byte* key) {
+  unsigned int i;
+
+  for (i = dsda_PatchCacheHash(key) & slot_mask; slots[i].key; i = (i + 1) & slot_mask)
+    if (!memcmp(slots[i].key, key, DSDA_PATCH_CACHE_KEY_LENGTH))
+      break;
+
+  return &slots[i];
+}
+
+static void dsda_GrowSlots(void) {
+  patch_cache_slot_t* old_slots;
+  unsigned int old_size;
+  unsigned int i;
+
+  old_slots = slots;
+  old_size = slots ? slot_mask + 1 : 0;
+
+  slot_mask = old_size ? old_size * 2 - 1 : 1023;
+  slots = Z_Calloc(slot_mask + 1, sizeof(*slots));
+
+  for (i = 0; i < old_size; ++i)
+    if (old_slots[i].key)
+      *dsda_FindSlot(old_slots[i].key) = old_slots[i];
+
+  Z_Free(old_slots);
+}
+
+// Pending entries are indexed by key only, since their data may still move
+static void dsda_IndexEntry(const byte* key, patch_cache_entry_t* entry) {
+  patch_cache_slot_t* slot;
+
+  if (!slots || (slot_count + 1) * 2 > slot_mask + 1)
+    dsda_GrowSlots();
+
+  slot = dsda_FindSlot(key);
+
+  if (!slot->key) {
+    slot->key = key;
+    slot->entry = entry;
+    ++slot_count;
+  }
+}
+
+static int dsda_PatchDataSize(int width, int pixel_size, int post_count) {
+  return pixel_size + width * sizeof(rcolumn_t) + post_count * sizeof(rpost_t) +
+         width * 2 * sizeof(int);
+}
+
+static dboolean dsda_ValidHeader(const byte* data, size_t size) {
+  const patch_cache_header_t* header;
+
+  if (size < sizeof(*header))
+    return false;
+
+  header = (const patch_cache_header_t*) data;
+
+  return !memcmp(header->magic, patch_cache_magic, sizeof(patch_cache_magic)) &&
+         header->version == PATCH_CACHE_VERSION &&
+         header->pointer_size == sizeof(void*) &&
+         header->column_size == sizeof(rcolumn_t) &&
+         header->post_size == sizeof(rpost_t);
+}
+
+static void dsda_IndexCacheData(void) {
+  size_t offset;
+  int count = 0;
+
+  cache_valid = dsda_ValidHeader(cache_data, cache_size);
+
+  if (!cache_valid)
+    return;
+
+  offset = PATCH_CACHE_ALIGN(sizeof(patch_cache_header_t));
+
+  // A truncated tail (e.g. from an interrupted write) ends the scan
+  while (offset + sizeof(patch_cache_entry_t) <= cache_size) {
+    patch_cache_entry_t* entry;
+
+    entry = (patch_cache_entry_t*) (cache_data + offset);
+
+    if (
+      entry->width <= 0 || entry->height <= 0 || entry->post_count < 0 ||
+      entry->pixel_size < entry->width * entry->height ||
+      entry->size < dsda_PatchDataSize(entry->width, entry->pixel_size, entry->post_count) ||
+      (size_t) entry->size > cache_size - offset - sizeof(*entry)
+    )
+      break;
+
+    dsda_IndexEntry(entry->key, entry);
+    ++count;
+
+    offset += sizeof(*entry) + entry->size;
+  }
+
+  cache_end = offset;
+
+  lprintf(LO_DEBUG, "dsda_InitPatchCache: %d cached patches\n", count);
+}
+
+static void dsda_MapCacheFile(void) {
+#ifdef _WIN32
+  LARGE_INTEGER size;
+
+  cache_file_handle = CreateFile(patch_cache_filename, GENERIC_READ, FILE_SHARE_READ,
+                                 NULL, OPEN_EXISTING, 0, NULL);
+  if (cache_file_handle == INVALID_HANDLE_VALUE)
+    return;
+
+  if (!GetFileSizeEx(cache_file_handle, &size) || !size.QuadPart || size.QuadPart > PATCH_CACHE_LIMIT)
+    return;
+
+  cache_map_handle = CreateFileMapping(cache_file_handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if (!cache_map_handle)
+    return;
+
+  cache_data = MapViewOfFile(cache_map_handle, FILE_MAP_COPY, 0, 0, 0);
+  if (!cache_data)
+    return;
+
+  cache_size = (size_t) size.QuadPart;
+  cache_mapped = true;
+#elif defined(HAVE_MMAP)
+  int fd;
+  struct stat st;
+  void* data;
+
+  fd = open(patch_cache_filename, O_RDONLY);
+  if (fd < 0)
+    return;
+
+  if (fstat(fd, &st) || !st.st_size || st.st_size > PATCH_CACHE_LIMIT) {
+    close(fd);
+    return;
+  }
+
+  // Private mapping: relocating the column tables must not touch the file
+  data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return;
+
+  cache_data = data;
+  cache_size = st.st_size;
+  cache_mapped = true;
+#else
+  int length;
+
+  length = M_ReadFile(patch_cache_filename, &cache_data);
+  if (length > 0)
+    cache_size = length;
+#endif
+}
+
+static void dsda_UnmapCacheFile(void) {
+  if (cache_mapped) {
+#ifdef _WIN32
+    UnmapViewOfFile(cache_data);
+#elif defined(HAVE_MMAP)
+    munmap(cache_data, cache_size);
+#endif
+  }
+  else if (cache_data)
+    Z_Free(cache_data);
+
+#ifdef _WIN32
+  if (cache_map_handle)
+    CloseHandle(cache_map_handle);
+  if (cache_file_handle != INVALID_HANDLE_VALUE)
+    CloseHandle(cache_file_handle);
+  cache_map_handle = NULL;
+  cache_file_handle = INVALID_HANDLE_VALUE;
+#endif
+
+  cache_data = NULL;
+  cache_size = 0;
+  cache_mapped = false;
+}
+
+static void dsda_WritePatchCacheHeader(FILE* file) {
+  patch_cache_header_t header = { 0 };
+  byte padding[8] = { 0 };
+
+  memcpy(header.magic, patch_cache_magic, sizeof(patch_cache_magic));
+  header.version = PATCH_CACHE_VERSION;
+  header.pointer_size = sizeof(void*);
+  header.column_size = sizeof(rcolumn_t);
+  header.post_size = sizeof(rpost_t);
+
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(padding, PATCH_CACHE_ALIGN(sizeof(header)) - sizeof(header), 1, file);
+}
+
+// Entries appended after a truncated tail could never be indexed,
+// so in that case the intact part of the file is copied to a new one
+static void dsda_RewritePatchCache(void) {
+  dsda_string_t temp_path;
+  FILE* file;
+  dboolean ok = false;
+
+  dsda_InitString(&temp_path, patch_cache_filename);
+  dsda_StringCat(&temp_path, ".tmp");
+
+  file = fopen(temp_path.string, "wb");
+
+  if (file) {
+    if (cache_valid)
+      fwrite(cache_data, cache_end, 1, file);
+    else
+      dsda_WritePatchCacheHeader(file);
+
+    fwrite(pending_data, pending_size, 1, file);
+
+    ok = !ferror(file);
+    ok = !fclose(file) && ok;
+  }
+
+  dsda_UnmapCacheFile();
+
+  if (ok) {
+#ifdef _WIN32
+    remove(patch_cache_filename);
+#endif
+    ok = !rename(temp_path.string, patch_cache_filename);
+  }
+
+  if (!ok) {
+    lprintf(LO_WARN, "dsda_SavePatchCache: unable to write %s\n", patch_cache_filename);
+    remove(temp_path.string);
+  }
+
+  dsda_FreeString(&temp_path);
+}
+
+static void dsda_SavePatchCache(void) {
+  FILE* file;
+
+  if (!pending_size)
+    return;
+
+  if (cache_valid && cache_end == cache_size) {
+    dsda_UnmapCacheFile();
+
+    file = fopen(patch_cache_filename, "ab");
+
+    if (file) {
+      fwrite(pending_data, pending_size, 1, file);
+      fclose(file);
+    }
+    else
+      lprintf(LO_WARN, "dsda_SavePatchCache: unable to write %s\n", patch_cache_filename);
+  }
+  else
+    dsda_RewritePatchCache();
+
+  Z_Free(pending_data);
+  pending_data = NULL;
+  pending_size = pending_capacity = 0;
+}
+
+static void dsda_InitPatchCache(void) {
+  int length;
+  const char* data_root;
+
+  patch_cache_initialized = true;
+  patch_cache_enabled = dsda_IntConfig(dsda_config_render_patch_cache);
+
+  if (!patch_cache_enabled)
+    return;
+
+  data_root = dsda_DataRoot();
+
+  length = strlen(data_root) + 17; // "/patch_cache.dat\0"
+  patch_cache_filename = Z_Malloc(length);
+  snprintf(patch_cache_filename, length, "%s/patch_cache.dat", data_root);
+
+  dsda_MapCacheFile();
+  dsda_IndexCacheData();
+
+  lump_cksums = Z_Malloc(numlumps * sizeof(*lump_cksums));
+  lump_cksum_ready = Z_Calloc(numlumps, sizeof(*lump_cksum_ready));
+
+  I_AtExit(dsda_SavePatchCache, false, "dsda_SavePatchCache", exit_priority_normal);
+}
+
+dboolean dsda_PatchCacheEnabled(void) {
+  if (!patch_cache_initialized)
+    dsda_InitPatchCache();
+
+  return patch_cache_enabled;
+}
+
+void dsda_PatchLumpCheckSum(int lump, byte* cksum) {
+  if (!lump_cksum_ready[lump]) {
+    struct MD5Context md5;
+
+    MD5Init(&md5);
+    MD5Update(&md5, W_LumpByNum(lump), W_LumpLength(lump));
+    MD5Final(lump_cksums[lump], &md5);
+
+    lump_cksum_ready[lump] = true;
+  }
+
+  memcpy(cksum, lump_cksums[lump], DSDA_PATCH_CACHE_KEY_LENGTH);
+}
+
+dboolean dsda_LoadCachedPatch(const byte* key, rpatch_t* patch) {
+  patch_cache_entry_t* entry;
+  const int* column_info;
+  int x;
+
+  if (!slots)
+    return false;
+
+  entry = dsda_FindSlot(key)->entry;
+
+  if (!entry)
+    return false;
+
+  patch->width = entry->width;
+  patch->height = entry->height;
+  patch->widthmask = entry->widthmask;
+  patch->leftoffset = entry->leftoffset;
+  patch->topoffset = entry->topoffset;
+  patch->flags = entry->flags;
+
+  patch->data = (unsigned char*) (entry + 1);
+  patch->pixels = patch->data;
+  patch->columns = (rcolumn_t*) (patch->pixels + entry->pixel_size);
+  patch->posts = (rpost_t*) (patch->columns + entry->width);
+  column_info = (const int*) (patch->posts + entry->post_count);
+
+  for (x = 0; x < entry->width; ++x) {
+    int first_post = column_info[x * 2];
+    int num_posts = column_info[x * 2 + 1];
+
+    if (first_post < 0 || num_posts < 0 || first_post + num_posts > entry->post_count)
+      I_Error("dsda_LoadCachedPatch: corrupt entry in %s", patch_cache_filename);
+
+    patch->columns[x].pixels = patch->pixels + x * entry->height;
+    patch->columns[x].posts = patch->posts + first_post;
+    patch->columns[x].numPosts = num_posts;
+  }
+
+  return true;
+}
+
+void dsda_StoreCachedPatch(const byte* key, const rpatch_t* patch) {
+  patch_cache_entry_t* entry;
+  byte* pending_key;
+  int* column_info;
+  int pixel_size;
+  int post_count;
+  int data_size;
+  size_t entry_size;
+  int x;
+
+  if (!patch_cache_enabled)
+    return;
+
+  if (slots && dsda_FindSlot(key)->key)
+    return;
+
+  pixel_size = (byte*) patch->columns - patch->pixels;
+  post_count = 0;
+  for (x = 0; x < patch->width; ++x) {
+    int end = patch->columns[x].posts - patch->posts + patch->columns[x].numPosts;
+
+    if (end > post_count)
+      post_count = end;
+  }
+
+  data_size = dsda_PatchDataSize(patch->width, pixel_size, post_count);
+  entry_size = sizeof(*entry) + PATCH_CACHE_ALIGN(data_size);
+
+  if (cache_size + pending_size + entry_size > PATCH_CACHE_LIMIT)
+    return;
+
+  if (pending_size + entry_size > pending_capacity) {
+    pending_capacity = MAX(pending_capacity * 2, pending_size + entry_size);
+    pending_capacity = MAX(pending_capacity, 1024 * 1024);
+    pending_data = Z_Realloc(pending_data, pending_capacity);
+  }
+
+  entry = (patch_cache_entry_t*) (pending_data + pending_size);
+  memset(entry, 0, entry_size);
+
+  memcpy(entry->key, key, DSDA_PATCH_CACHE_KEY_LENGTH);
+  entry->size = entry_size - sizeof(*entry);
+  entry->width = patch->width;
+  entry->height = patch->height;
+  entry->widthmask = patch->widthmask;
+  entry->leftoffset = patch->leftoffset;
+  entry->topoffset = patch->topoffset;
+  entry->flags = patch->flags;
+  entry->pixel_size = pixel_size;
+  entry->post_count = post_count;
+
+  // Column pointers are rebuilt from the trailing info when loading
+  memcpy(entry + 1, patch->pixels, pixel_size);
+  memcpy(
+    (byte*) (entry + 1) + pixel_size + patch->width * sizeof(rcolumn_t),
+    patch->posts, post_count * sizeof(rpost_t)
+  );
+
+  column_info = (int*) ((byte*) (entry + 1) + data_size - patch->width * 2 * sizeof(int));
+  for (x = 0; x < patch->width; ++x) {
+    column_info[x * 2] = patch->columns[x].posts - patch->posts;
+    column_info[x * 2 + 1] = patch->columns[x].numPosts;
+  }
+
+  pending_size += entry_size;
+
+  // Pending keys are only indexed to avoid storing duplicates
+  pending_key = Z_Malloc(DSDA_PATCH_CACHE_KEY_LENGTH);
+  memcpy(pending_key, key, DSDA_PATCH_CACHE_KEY_LENGTH);
+  dsda_IndexEntry(pending_key, NULL);
+}
+
+dboolean dsda_IsCachedPatchData(const void* data) {
+  return cache_data &&
+         (const byte*) data >= cache_data &&
+         (const byte*) data < cache_data + cache_size;
+}
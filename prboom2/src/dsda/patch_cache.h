@@ -0,0 +1,32 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Patch Cache
+//
+
+#ifndef __DSDA_PATCH_CACHE__
+#define __DSDA_PATCH_CACHE__
+
+#include "doomtype.h"
+#include "r_patch.h"
+
+#define DSDA_PATCH_CACHE_KEY_LENGTH 16
+
+dboolean dsda_PatchCacheEnabled(void);
+void dsda_PatchLumpCheckSum(int lump, byte* cksum);
+dboolean dsda_LoadCachedPatch(const byte* key, rpatch_t* patch);
+void dsda_StoreCachedPatch(const byte* key, const rpatch_t* patch);
+dboolean dsda_IsCachedPatchData(const void* data);
+
+#endif
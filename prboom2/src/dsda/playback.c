@@ -157,14 +157,25 @@ int dsda_PlaybackTics(void) {
   return playback_tics;
 }
 
+// The position is stored as an offset so that exported key frames
+// remain valid in another process playing the same demo
 void dsda_StorePlaybackPosition(void) {
+  intptr_t playback_offset;
+
+  playback_offset = playback_p ? playback_p - playback_origin_p : -1;
+
   P_SAVE_X(playback_tics);
-  P_SAVE_X(playback_p);
+  P_SAVE_X(playback_offset);
 }
 
 void dsda_RestorePlaybackPosition(void) {
+  intptr_t playback_offset;
+
   P_LOAD_X(playback_tics);
-  P_LOAD_X(playback_p);
+  P_LOAD_X(playback_offset);
+
+  playback_p = playback_origin_p && playback_offset >= 0 ?
+               playback_origin_p + playback_offset : NULL;
 }
 
 void dsda_ClearPlaybackStream(void) {
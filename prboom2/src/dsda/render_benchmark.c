@@ -0,0 +1,581 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Render Benchmark
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "e6y.h"
+#include "g_game.h"
+#include "i_main.h"
+#include "i_video.h"
+#include "lprintf.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "r_main.h"
+#include "r_state.h"
+#include "v_video.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/configuration.h"
+#include "dsda/global.h"
+#include "dsda/map_format.h"
+#include "dsda/render_stats.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "render_benchmark.h"
+
+// The last column holds the time for the whole frame
+#define BENCHMARK_FRAME DSDA_RENDER_STAGE_COUNT
+#define BENCHMARK_COLUMNS (DSDA_RENDER_STAGE_COUNT + 1)
+
+#define DEFAULT_FRAMES 35
+#define WARMUP_FRAMES 2
+#define START_HEADINGS 8
+#define CAMERA_PATH_INTERVAL TICRATE
+
+typedef struct {
+  char map[9];
+  fixed_t x;
+  fixed_t y;
+  fixed_t z;
+  angle_t angle;
+  angle_t pitch;
+} camera_point_t;
+
+typedef struct {
+  unsigned long long* values;
+  int count;
+  int capacity;
+} benchmark_samples_t;
+
+static FILE* camera_path_export;
+
+static camera_point_t* camera_path;
+static int camera_path_count;
+
+static benchmark_samples_t map_samples[BENCHMARK_COLUMNS];
+static benchmark_samples_t all_samples[BENCHMARK_COLUMNS];
+
+static int benchmark_frames;
+static FILE* benchmark_csv;
+static const char* benchmark_renderer;
+
+// -render_benchmark_hashes: one line per view with the hash of the first
+// recorded frame and the mean frame time over the view
+static FILE* benchmark_hashes;
+static int view_index;
+static int view_frames;
+static unsigned long long view_time;
+static dsda_cksum_t view_hash;
+
+static angle_t DegreesToAngle(double degrees) {
+  return (angle_t) (long long) (degrees * ANG1);
+}
+
+static double AngleToDegrees(angle_t angle) {
+  return (double) angle / ANG1;
+}
+
+static double PitchToDegrees(angle_t pitch) {
+  return (double) (int) pitch / ANG1;
+}
+
+void dsda_InitCameraPathExport(const char* name) {
+  camera_path_export = fopen(name, "w");
+
+  if (camera_path_export == NULL)
+    I_Error("dsda_InitCameraPathExport: failed to open %s", name);
+
+  fprintf(camera_path_export, "# map x y z angle pitch\n");
+}
+
+void dsda_ExportCameraPathFrame(void) {
+  player_t* player;
+
+  if (!camera_path_export || gamestate != GS_LEVEL || leveltime % CAMERA_PATH_INTERVAL)
+    return;
+
+  player = &players[displayplayer];
+
+  if (!player->mo)
+    return;
+
+  fprintf(
+    camera_path_export, "%s %.3f %.3f %.3f %.3f %.3f\n",
+    MAPNAME(gameepisode, gamemap),
+    (double) player->mo->x / FRACUNIT,
+    (double) player->mo->y / FRACUNIT,
+    (double) player->viewz / FRACUNIT,
+    AngleToDegrees(player->mo->angle),
+    PitchToDegrees(P_PlayerPitch(player))
+  );
+}
+
+static void dsda_LoadCameraPath(const char* name) {
+  char* buffer;
+  char* line;
+  int capacity = 0;
+
+  if (M_ReadFileToString(name, &buffer) < 0)
+    I_Error("dsda_LoadCameraPath: failed to read %s", name);
+
+  for (line = strtok(buffer, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+    camera_point_t* point;
+    char map[9];
+    double x, y, z, angle, pitch = 0;
+
+    if (line[0] == '#')
+      continue;
+
+    if (sscanf(line, "%8s %lf %lf %lf %lf %lf", map, &x, &y, &z, &angle, &pitch) < 5)
+      continue;
+
+    if (camera_path_count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      camera_path = Z_Realloc(camera_path, capacity * sizeof(*camera_path));
+    }
+
+    point = &camera_path[camera_path_count++];
+    strcpy(point->map, map);
+    M_Strupr(point->map);
+    point->x = (fixed_t) (x * FRACUNIT);
+    point->y = (fixed_t) (y * FRACUNIT);
+    point->z = (fixed_t) (z * FRACUNIT);
+    point->angle = DegreesToAngle(angle);
+    point->pitch = DegreesToAngle(pitch);
+  }
+
+  Z_Free(buffer);
+
+  if (!camera_path_count)
+    I_Error("dsda_LoadCameraPath: no camera positions in %s", name);
+}
+
+static void dsda_AddSample(benchmark_samples_t* samples, unsigned long long value) {
+  if (samples->count == samples->capacity) {
+    samples->capacity = samples->capacity ? samples->capacity * 2 : 1024;
+    samples->values = Z_Realloc(samples->values, samples->capacity * sizeof(*samples->values));
+  }
+
+  samples->values[samples->count++] = value;
+}
+
+static int dsda_CompareSamples(const void* a, const void* b) {
+  unsigned long long x = *(const unsigned long long*) a;
+  unsigned long long y = *(const unsigned long long*) b;
+
+  return (x > y) - (x < y);
+}
+
+static void dsda_WriteSamples(const char* map, const char* stage, benchmark_samples_t* samples) {
+  unsigned long long total = 0;
+  int p99_index;
+  int i;
+
+  if (!samples->count)
+    return;
+
+  for (i = 0; i < samples->count; ++i)
+    total += samples->values[i];
+
+  // Stages that never ran belong to the other renderer
+  if (!total)
+    return;
+
+  qsort(samples->values, samples->count, sizeof(*samples->values), dsda_CompareSamples);
+
+  p99_index = (samples->count * 99 + 99) / 100 - 1;
+
+  fprintf(
+    benchmark_csv, "%s,%s,%s,%d,%.3f,%.3f\n",
+    benchmark_renderer, map, stage, samples->count,
+    (double) total / samples->count / 1000,
+    (double) samples->values[p99_index] / 1000
+  );
+}
+
+static const char* dsda_ColumnName(int column) {
+  return column == BENCHMARK_FRAME ? "frame" : dsda_RenderStageName(column);
+}
+
+static void dsda_FinishMapSamples(const char* map) {
+  int column;
+
+  for (column = 0; column < BENCHMARK_COLUMNS; ++column) {
+    benchmark_samples_t* samples = &map_samples[column];
+    int i;
+
+    for (i = 0; i < samples->count; ++i)
+      dsda_AddSample(&all_samples[column], samples->values[i]);
+
+    dsda_WriteSamples(map, dsda_ColumnName(column), samples);
+    samples->count = 0;
+  }
+
+  fflush(benchmark_csv);
+}
+
+// Only the visible part of each row is hashed, so the pitch doesn't matter
+static void dsda_HashScreen(dsda_cksum_t* cksum) {
+  struct MD5Context md5;
+  int y;
+
+  MD5Init(&md5);
+
+  for (y = 0; y < SCREENHEIGHT; ++y)
+    MD5Update(&md5, screens[0].data + y * screens[0].pitch, SCREENWIDTH);
+
+  MD5Final(cksum->bytes, &md5);
+
+  dsda_TranslateCheckSum(cksum);
+}
+
+static void dsda_BeginBenchmarkView(void) {
+  view_frames = 0;
+  view_time = 0;
+}
+
+static void dsda_EndBenchmarkView(void) {
+  if (!benchmark_hashes || !view_frames)
+    return;
+
+  fprintf(
+    benchmark_hashes, "%s %d %dx%d %s %.3f\n",
+    MAPNAME(gameepisode, gamemap), view_index++, SCREENWIDTH, SCREENHEIGHT,
+    view_hash.string, (double) view_time / view_frames / 1000
+  );
+}
+
+static void dsda_RenderBenchmarkFrame(dboolean record) {
+  unsigned long long start;
+  unsigned long long frame_time;
+  int stage;
+
+  // The camera doesn't move during a frame
+  walkcamera.PrevX = walkcamera.x;
+  walkcamera.PrevY = walkcamera.y;
+  walkcamera.PrevZ = walkcamera.z;
+  walkcamera.PrevAngle = walkcamera.angle;
+  walkcamera.PrevPitch = walkcamera.pitch;
+
+  wipegamestate = gamestate;
+
+  dsda_ResetRenderStageTimes();
+
+  start = dsda_TimeNS();
+  D_Display(FRACUNIT);
+  frame_time = dsda_TimeNS() - start;
+
+  if (!record)
+    return;
+
+  if (benchmark_hashes && !view_frames)
+    dsda_HashScreen(&view_hash);
+
+  view_time += frame_time;
+  ++view_frames;
+
+  for (stage = 0; stage < DSDA_RENDER_STAGE_COUNT; ++stage)
+    dsda_AddSample(&map_samples[stage], dsda_render_stage_time[stage]);
+
+  dsda_AddSample(&map_samples[BENCHMARK_FRAME], frame_time);
+}
+
+static void dsda_SetBenchmarkCamera(fixed_t x, fixed_t y, fixed_t z, angle_t angle, angle_t pitch) {
+  walkcamera.type = 2;
+  walkcamera.x = x;
+  walkcamera.y = y;
+  walkcamera.z = z;
+  walkcamera.angle = angle;
+  walkcamera.pitch = pitch;
+}
+
+static void dsda_BenchmarkView(fixed_t x, fixed_t y, fixed_t z, angle_t angle, angle_t pitch) {
+  int i;
+
+  I_StartTic();
+
+  dsda_SetBenchmarkCamera(x, y, z, angle, pitch);
+
+  for (i = 0; i < WARMUP_FRAMES; ++i)
+    dsda_RenderBenchmarkFrame(false);
+
+  dsda_BeginBenchmarkView();
+
+  for (i = 0; i < benchmark_frames; ++i)
+    dsda_RenderBenchmarkFrame(true);
+
+  dsda_EndBenchmarkView();
+}
+
+static void dsda_BenchmarkStart(const mapthing_t* start) {
+  fixed_t z;
+  int i;
+
+  z = R_PointInSubsector(start->x, start->y)->sector->floorheight + g_viewheight;
+
+  for (i = 0; i < START_HEADINGS; ++i)
+    dsda_BenchmarkView(
+      start->x, start->y, z,
+      DegreesToAngle(start->angle) + i * (ANG90 / 2), 0
+    );
+}
+
+static void dsda_BenchmarkPlayerStarts(void) {
+  mapthing_t* start;
+  int i;
+
+  for (i = 0; i < MAX_MAXPLAYERS; ++i)
+    if (playerstarts[0][i].options)
+      dsda_BenchmarkStart(&playerstarts[0][i]);
+
+  for (start = deathmatchstarts; start < deathmatch_p; ++start)
+    dsda_BenchmarkStart(start);
+}
+
+// The camera travels between consecutive waypoints on the same map
+static void dsda_BenchmarkCameraPath(const camera_point_t* first, int count) {
+  int i, frame;
+
+  if (count == 1) {
+    dsda_BenchmarkView(first->x, first->y, first->z, first->angle, first->pitch);
+    return;
+  }
+
+  dsda_SetBenchmarkCamera(first->x, first->y, first->z, first->angle, first->pitch);
+
+  for (i = 0; i < WARMUP_FRAMES; ++i)
+    dsda_RenderBenchmarkFrame(false);
+
+  for (i = 0; i < count - 1; ++i) {
+    const camera_point_t* a = &first[i];
+    const camera_point_t* b = &first[i + 1];
+
+    I_StartTic();
+
+    dsda_BeginBenchmarkView();
+
+    for (frame = 0; frame < benchmark_frames; ++frame) {
+      fixed_t t = frame * FRACUNIT / benchmark_frames;
+
+      dsda_SetBenchmarkCamera(
+        a->x + FixedMul(t, b->x - a->x),
+        a->y + FixedMul(t, b->y - a->y),
+        a->z + FixedMul(t, b->z - a->z),
+        a->angle + FixedMul(t, (int) (b->angle - a->angle)),
+        a->pitch + FixedMul(t, (int) (b->pitch - a->pitch))
+      );
+
+      dsda_RenderBenchmarkFrame(true);
+    }
+
+    dsda_EndBenchmarkView();
+  }
+}
+
+static dboolean dsda_FindMap(const char* name, int* episode, int* map) {
+  int e, m;
+  int last_episode, last_map;
+
+  if (gamemode == commercial || map_format.map99) {
+    last_episode = 1;
+    last_map = 99;
+  }
+  else {
+    last_episode = 9;
+    last_map = 9;
+  }
+
+  for (e = 1; e <= last_episode; ++e)
+    for (m = 1; m <= last_map; ++m)
+      if (!strcmp(MAPNAME(e, m), name)) {
+        *episode = e;
+        *map = m;
+        return true;
+      }
+
+  return false;
+}
+
+static void dsda_BenchmarkMap(int episode, int map) {
+  char name[9];
+
+  strcpy(name, MAPNAME(episode, map));
+
+  lprintf(LO_INFO, "dsda_RunRenderBenchmark: %s\n", name);
+
+  G_InitNew(startskill, episode, map, true);
+
+  view_index = 0;
+
+  if (camera_path_count) {
+    int i = 0;
+
+    while (i < camera_path_count) {
+      int count = 1;
+
+      while (i + count < camera_path_count && !strcmp(camera_path[i].map, camera_path[i + count].map))
+        ++count;
+
+      if (!strcmp(camera_path[i].map, name))
+        dsda_BenchmarkCameraPath(&camera_path[i], count);
+
+      i += count;
+    }
+  }
+  else
+    dsda_BenchmarkPlayerStarts();
+
+  dsda_FinishMapSamples(name);
+}
+
+static void dsda_BenchmarkAllMaps(void) {
+  int e, m;
+  int last_episode, last_map;
+  dboolean pwad_maps = false;
+
+  if (gamemode == commercial || map_format.map99) {
+    last_episode = 1;
+    last_map = 99;
+  }
+  else {
+    last_episode = 9;
+    last_map = 9;
+  }
+
+  // Only benchmark the pwad maps when there are any
+  for (e = 1; e <= last_episode; ++e)
+    for (m = 1; m <= last_map; ++m) {
+      int lump = W_CheckNumForName(MAPNAME(e, m));
+
+      if (lump != LUMP_NOT_FOUND && lumpinfo[lump].source == source_pwad)
+        pwad_maps = true;
+    }
+
+  for (e = 1; e <= last_episode; ++e)
+    for (m = 1; m <= last_map; ++m) {
+      int lump = W_CheckNumForName(MAPNAME(e, m));
+
+      if (lump == LUMP_NOT_FOUND)
+        continue;
+
+      if (pwad_maps && lumpinfo[lump].source != source_pwad)
+        continue;
+
+      dsda_BenchmarkMap(e, m);
+    }
+}
+
+static void dsda_BenchmarkPathMaps(void) {
+  int i;
+
+  for (i = 0; i < camera_path_count; ++i) {
+    int episode, map;
+    int j;
+
+    // Each map is benchmarked once, in order of first appearance
+    for (j = 0; j < i; ++j)
+      if (!strcmp(camera_path[j].map, camera_path[i].map))
+        break;
+
+    if (j < i)
+      continue;
+
+    if (!dsda_FindMap(camera_path[i].map, &episode, &map) || !W_LumpNameExists(camera_path[i].map)) {
+      lprintf(LO_WARN, "dsda_RunRenderBenchmark: map %s not found\n", camera_path[i].map);
+      continue;
+    }
+
+    dsda_BenchmarkMap(episode, map);
+  }
+}
+
+void dsda_RunRenderBenchmark(void) {
+  dsda_arg_t* arg;
+  int column;
+
+  arg = dsda_Arg(dsda_arg_render_benchmark);
+
+  benchmark_csv = fopen(arg->value.v_string, "w");
+
+  if (benchmark_csv == NULL)
+    I_Error("dsda_RunRenderBenchmark: failed to open %s", arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_render_benchmark_path);
+  if (arg->found)
+    dsda_LoadCameraPath(arg->value.v_string);
+
+  benchmark_frames = DEFAULT_FRAMES;
+  arg = dsda_Arg(dsda_arg_render_benchmark_frames);
+  if (arg->found)
+    benchmark_frames = arg->value.v_int;
+
+  benchmark_renderer = V_IsOpenGLMode() ? "opengl" : "software";
+
+  arg = dsda_Arg(dsda_arg_render_benchmark_hashes);
+  if (arg->found) {
+    if (V_IsOpenGLMode())
+      I_Error("dsda_RunRenderBenchmark: -render_benchmark_hashes requires the software renderer");
+
+    benchmark_hashes = fopen(arg->value.v_string, "w");
+
+    if (benchmark_hashes == NULL)
+      I_Error("dsda_RunRenderBenchmark: failed to open %s", arg->value.v_string);
+
+    fprintf(benchmark_hashes, "# map view resolution md5 mean_us\n");
+
+    // Keep frame-to-frame noise off the screen
+    dsda_UpdateIntConfig(dsda_config_exhud, 0, false);
+    dsda_UpdateIntConfig(dsda_config_show_fps, 0, false);
+    dsda_UpdateIntConfig(dsda_config_show_messages, 0, false);
+  }
+
+  // Anything that changes the work per frame skews the results
+  dsda_UpdateIntConfig(dsda_config_fps_limit, 0, false);
+  dsda_UpdateIntConfig(dsda_config_render_dynamic_resolution, 0, false);
+
+  fprintf(benchmark_csv, "renderer,map,stage,frames,mean_us,p99_us\n");
+
+  G_ReloadDefaults();
+  netgame = solo_net;
+  deathmatch = false;
+
+  dsda_render_stage_timing = true;
+
+  if (camera_path_count)
+    dsda_BenchmarkPathMaps();
+  else
+    dsda_BenchmarkAllMaps();
+
+  dsda_render_stage_timing = false;
+
+  for (column = 0; column < BENCHMARK_COLUMNS; ++column)
+    dsda_WriteSamples("all", dsda_ColumnName(column), &all_samples[column]);
+
+  fclose(benchmark_csv);
+
+  if (benchmark_hashes)
+    fclose(benchmark_hashes);
+
+  I_SafeExit(0);
+}
@@ -28,6 +28,24 @@ dsda_render_stats_t dsda_render_stats;
 dsda_render_stats_t dsda_render_stats_max;
 int dsda_render_stats_fps = 35;
 
+// Average time per frame spent by each plane worker, in microseconds
+static unsigned long long plane_worker_time[DSDA_MAX_PLANE_WORKERS];
+static int plane_worker_count;
+int dsda_render_stats_plane_workers;
+int dsda_render_stats_plane_worker_time[DSDA_MAX_PLANE_WORKERS];
+
+dboolean dsda_render_stage_timing;
+unsigned long long dsda_render_stage_time[DSDA_RENDER_STAGE_COUNT];
+static unsigned long long render_stage_start[DSDA_RENDER_STAGE_COUNT];
+
+static const char* render_stage_names[DSDA_RENDER_STAGE_COUNT] = {
+  [dsda_render_stage_setup] = "setup",
+  [dsda_render_stage_bsp_nodes] = "bsp_nodes",
+  [dsda_render_stage_draw_planes] = "draw_planes",
+  [dsda_render_stage_draw_masked] = "draw_masked",
+  [dsda_render_stage_draw_scene] = "draw_scene",
+};
+
 static void dsda_UpdateMaxValues(dsda_render_stats_t* x, dsda_render_stats_t* y) {
   if (x->visplanes < y->visplanes)
     x->visplanes = y->visplanes;
@@ -37,6 +55,9 @@ static void dsda_UpdateMaxValues(dsda_render_stats_t* x, dsda_render_stats_t* y)
 
   if (x->vissprites < y->vissprites)
     x->vissprites = y->vissprites;
+
+  if (x->drawcalls < y->drawcalls)
+    x->drawcalls = y->drawcalls;
 }
 
 void dsda_BeginRenderStats(void) {
@@ -44,6 +65,9 @@ void dsda_BeginRenderStats(void) {
   ZERO_DATA(interval_stats);
   ZERO_DATA(dsda_render_stats);
   ZERO_DATA(dsda_render_stats_max);
+  ZERO_DATA(plane_worker_time);
+  plane_worker_count = 0;
+  dsda_render_stats_plane_workers = 0;
 
   dsda_StartTimer(dsda_timer_render_stats);
 }
@@ -72,6 +96,32 @@ void dsda_RecordDrawSegs(int n) {
   frame_stats.drawsegs += n;
 }
 
+void dsda_RecordDrawCall(void) {
+  ++frame_stats.drawcalls;
+}
+
+void dsda_RecordDrawCalls(int n) {
+  frame_stats.drawcalls += n;
+}
+
+void dsda_RecordPlaneWorkerTime(int worker, unsigned long long time) {
+  plane_worker_time[worker] += time;
+
+  if (plane_worker_count <= worker)
+    plane_worker_count = worker + 1;
+}
+
+static void dsda_UpdatePlaneWorkerStats(void) {
+  int i;
+
+  dsda_render_stats_plane_workers = plane_worker_count;
+  for (i = 0; i < plane_worker_count; ++i)
+    dsda_render_stats_plane_worker_time[i] = plane_worker_time[i] / 1000 / frame_count;
+
+  ZERO_DATA(plane_worker_time);
+  plane_worker_count = 0;
+}
+
 void dsda_UpdateRenderStats(void) {
   dsda_UpdateMaxValues(&interval_stats, &frame_stats);
 
@@ -83,7 +133,25 @@ void dsda_UpdateRenderStats(void) {
     ZERO_DATA(interval_stats);
     dsda_UpdateMaxValues(&dsda_render_stats_max, &dsda_render_stats);
     dsda_render_stats_fps = frame_count * 1000 / dsda_ElapsedTimeMS(dsda_timer_render_stats);
+    dsda_UpdatePlaneWorkerStats();
     frame_count = 0;
     dsda_StartTimer(dsda_timer_render_stats);
   }
 }
+
+const char* dsda_RenderStageName(dsda_render_stage_t stage) {
+  return render_stage_names[stage];
+}
+
+void dsda_ResetRenderStageTimes(void) {
+  ZERO_DATA(dsda_render_stage_time);
+}
+
+void dsda_StartRenderStageTimer(dsda_render_stage_t stage) {
+  render_stage_start[stage] = dsda_TimeNS();
+}
+
+// Times are accumulated, since a stage can run more than once per frame
+void dsda_EndRenderStageTimer(dsda_render_stage_t stage) {
+  dsda_render_stage_time[stage] += dsda_TimeNS() - render_stage_start[stage];
+}
@@ -18,12 +18,29 @@
 #ifndef __RENDER_STATS__
 #define __RENDER_STATS__
 
+#include "doomtype.h"
+
 typedef struct {
   int visplanes;
   int drawsegs;
   int vissprites;
+  int drawcalls;
 } dsda_render_stats_t;
 
+#define DSDA_MAX_PLANE_WORKERS 8
+
+typedef enum {
+  dsda_render_stage_setup,
+  dsda_render_stage_bsp_nodes,
+  dsda_render_stage_draw_planes,
+  dsda_render_stage_draw_masked,
+  dsda_render_stage_draw_scene,
+  DSDA_RENDER_STAGE_COUNT
+} dsda_render_stage_t;
+
+extern dboolean dsda_render_stage_timing;
+extern unsigned long long dsda_render_stage_time[DSDA_RENDER_STAGE_COUNT];
+
 void dsda_BeginRenderStats(void);
 void dsda_RecordVisSprite(void);
 void dsda_RecordVisSprites(int n);
@@ -31,6 +48,19 @@ void dsda_RecordVisPlane(void);
 void dsda_RecordVisPlanes(int n);
 void dsda_RecordDrawSeg(void);
 void dsda_RecordDrawSegs(int n);
+void dsda_RecordDrawCall(void);
+void dsda_RecordDrawCalls(int n);
+void dsda_RecordPlaneWorkerTime(int worker, unsigned long long time);
 void dsda_UpdateRenderStats(void);
+const char* dsda_RenderStageName(dsda_render_stage_t stage);
+void dsda_ResetRenderStageTimes(void);
+void dsda_StartRenderStageTimer(dsda_render_stage_t stage);
+void dsda_EndRenderStageTimer(dsda_render_stage_t stage);
+
+// Stage timing is only active during the render benchmark
+#define DSDA_START_RENDER_STAGE(x) \
+  do { if (dsda_render_stage_timing) dsda_StartRenderStageTimer(x); } while (0)
+#define DSDA_END_RENDER_STAGE(x) \
+  do { if (dsda_render_stage_timing) dsda_EndRenderStageTimer(x); } while (0)
 
 #endif
@@ -37,14 +37,19 @@
 static char* dsda_base_save_dir;
 static char* dsda_wad_save_dir;
 
-#define TRACKING_SIZE sizeof(int)
+#define TRACKING_SIZE (2 * sizeof(int))
+
+// -1 if the save doesn't have it
+static int restored_music_tics = -1;
 
 static void dsda_ArchiveInternal(void) {
   extern int dsda_max_kill_requirement;
-  int internal_size = sizeof(dsda_max_kill_requirement);
+  int music_tics = S_MusicTics();
+  int internal_size = sizeof(dsda_max_kill_requirement) + sizeof(music_tics);
 
   P_SAVE_X(internal_size);
   P_SAVE_X(dsda_max_kill_requirement);
+  P_SAVE_X(music_tics);
 }
 
 static void dsda_UnArchiveInternal(void) {
@@ -56,6 +61,10 @@ static void dsda_UnArchiveInternal(void) {
   if (internal_size > 0)
     P_LOAD_X(dsda_max_kill_requirement);
 
+  restored_music_tics = -1;
+  if (internal_size > sizeof(int))
+    P_LOAD_X(restored_music_tics);
+
   if (internal_size > TRACKING_SIZE)
   {
     save_p += internal_size - TRACKING_SIZE;
@@ -160,6 +169,14 @@ void dsda_UnArchiveAll(void) {
   dsda_UnArchiveInternal();
 }
 
+// The music can change after unarchiving (MUSINFO), so this comes last
+void dsda_RestoreMusicPosition(void) {
+  if (restored_music_tics >= 0)
+    S_SeekMusic(restored_music_tics);
+
+  restored_music_tics = -1;
+}
+
 void dsda_InitSaveDir(void) {
   dsda_base_save_dir = dsda_DetectDirectory("DOOMSAVEDIR", dsda_arg_save);
 }
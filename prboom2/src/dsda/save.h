@@ -20,6 +20,7 @@
 
 void dsda_ArchiveAll(void);
 void dsda_UnArchiveAll(void);
+void dsda_RestoreMusicPosition(void);
 void dsda_InitSaveDir(void);
 char* dsda_SaveGameName(int slot, dboolean via_excmd);
 void dsda_ResetDemoSaveSlots(void);
@@ -0,0 +1,495 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Segment Capture
+//
+//  -viddump_segments splits a video dump across several processes:
+//
+//  1. The demo is played once without video or sound, and a key frame is
+//     exported shortly before each segment boundary.
+//  2. Each segment is captured by its own process, which restores the key
+//     frame and plays up to the boundary without keeping any frames. The
+//     pre-roll lets sounds started before the boundary carry into it.
+//  3. The segment videos are joined with cap_concatcommand.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_capture.h"
+#include "i_main.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_misc.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/configuration.h"
+#include "dsda/key_frame.h"
+#include "dsda/mkdir.h"
+#include "dsda/playback.h"
+#include "dsda/thread_pool.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "segment_capture.h"
+
+#define DEFAULT_SEGMENT_LENGTH 60
+
+// Key frames are taken between these many tics before a boundary
+#define PRE_ROLL_MAX (3 * TICRATE)
+#define PRE_ROLL_MIN TICRATE
+
+#define SEGMENT_LIST "segments.txt"
+#define CONCAT_LIST "segments.ffconcat"
+
+static const char* segment_dir;
+
+// key frame pass
+static dboolean exporting_key_frames;
+static int segment_tics;
+static int next_boundary;
+
+// segment pass
+static dboolean capturing_segment;
+static dboolean segment_started;
+static int segment_start;
+static int segment_end;
+
+typedef struct {
+  char** commands;
+  int* results;
+  int count;
+  SDL_atomic_t next;
+} segment_jobs_t;
+
+static char* dsda_SegmentPath(const char* dir, const char* name) {
+  char* path;
+
+  path = Z_Malloc(strlen(dir) + strlen(name) + 2);
+  sprintf(path, "%s/%s", dir, name);
+
+  return path;
+}
+
+static void dsda_AppendArg(dsda_string_t* command, const char* arg) {
+  dboolean quote;
+
+  quote = strchr(arg, ' ') != NULL;
+
+  if (command->string)
+    dsda_StringCat(command, " ");
+  if (quote)
+    dsda_StringCat(command, "\"");
+  dsda_StringCat(command, arg);
+  if (quote)
+    dsda_StringCat(command, "\"");
+}
+
+static void dsda_AppendIntArg(dsda_string_t* command, int value) {
+  char buffer[16];
+
+  snprintf(buffer, sizeof(buffer), "%d", value);
+  dsda_AppendArg(command, buffer);
+}
+
+static dboolean dsda_OrchestrationArg(const char* arg) {
+  static const char* names[] = {
+    "-playdemo", "-timedemo", "-fastdemo", "-viddump",
+    "-viddump_segments", "-viddump_segment_length", "-viddump_segment_dir",
+    "-viddump_segment", "-viddump_key_frames", NULL
+  };
+  int i;
+
+  for (i = 0; names[i]; ++i)
+    if (!strcasecmp(arg, names[i]))
+      return true;
+
+  return false;
+}
+
+// The command line of this process without the demo and capture arguments
+static void dsda_InitChildCommand(dsda_string_t* command) {
+  extern int dsda_argc;
+  extern char** dsda_argv;
+  int i;
+
+  dsda_InitString(command, NULL);
+  dsda_AppendArg(command, dsda_argv[0]);
+
+  for (i = 1; i < dsda_argc; ++i) {
+    if (dsda_OrchestrationArg(dsda_argv[i])) {
+      while (i + 1 < dsda_argc && dsda_argv[i + 1][0] != '-')
+        ++i;
+      continue;
+    }
+
+    dsda_AppendArg(command, dsda_argv[i]);
+  }
+}
+
+static int dsda_RunCommand(const char* command) {
+#ifdef _WIN32
+  // cmd.exe strips the outer quotes
+  int result;
+  char* wrapped;
+
+  wrapped = Z_Malloc(strlen(command) + 3);
+  sprintf(wrapped, "\"%s\"", command);
+  result = system(wrapped);
+  Z_Free(wrapped);
+
+  return result;
+#else
+  return system(command);
+#endif
+}
+
+static void dsda_SegmentJob(int index, void* data) {
+  segment_jobs_t* jobs = data;
+  int segment;
+
+  while ((segment = SDL_AtomicAdd(&jobs->next, 1)) < jobs->count)
+    jobs->results[segment] = dsda_RunCommand(jobs->commands[segment]);
+}
+
+// Replaces %l with the list file, %f with the output file and %% with %
+static char* dsda_ConcatCommand(const char* list, const char* output) {
+  dsda_string_t command;
+  const char* in;
+  char c[2] = { 0 };
+
+  dsda_InitString(&command, NULL);
+
+  for (in = dsda_StringConfig(dsda_config_cap_concatcommand); *in; ++in) {
+    if (*in == '%' && in[1] == 'l') {
+      dsda_StringCat(&command, list);
+      ++in;
+    }
+    else if (*in == '%' && in[1] == 'f') {
+      dsda_StringCat(&command, output);
+      ++in;
+    }
+    else if (*in == '%' && in[1] == '%') {
+      dsda_StringCat(&command, "%");
+      ++in;
+    }
+    else {
+      c[0] = *in;
+      dsda_StringCat(&command, c);
+    }
+  }
+
+  return command.string;
+}
+
+void dsda_RunSegmentCapture(void) {
+  dsda_arg_t* arg;
+  const char* demo = NULL;
+  const char* output;
+  const char* concat_command;
+  char* dir;
+  char* path;
+  char* list;
+  char* cursor;
+  int workers;
+  int length;
+  int* boundaries;
+  int boundary_count;
+  int i;
+  dsda_string_t base;
+  dsda_string_t command;
+  segment_jobs_t jobs;
+  dsda_thread_pool_t* pool;
+  unsigned long long start_time;
+  FILE* file;
+
+  arg = dsda_Arg(dsda_arg_viddump);
+  if (!arg->found)
+    I_Error("dsda_RunSegmentCapture: -viddump_segments requires -viddump");
+  output = arg->value.v_string;
+
+  if (dsda_Arg(dsda_arg_timedemo)->found)
+    demo = dsda_Arg(dsda_arg_timedemo)->value.v_string;
+  else if (dsda_Arg(dsda_arg_playdemo)->found)
+    demo = dsda_Arg(dsda_arg_playdemo)->value.v_string;
+  else if (dsda_Arg(dsda_arg_fastdemo)->found)
+    demo = dsda_Arg(dsda_arg_fastdemo)->value.v_string;
+
+  if (!demo)
+    I_Error("dsda_RunSegmentCapture: -viddump_segments requires a demo");
+
+  workers = dsda_Arg(dsda_arg_viddump_segments)->value.v_int;
+
+  arg = dsda_Arg(dsda_arg_viddump_segment_length);
+  length = arg->found ? arg->value.v_int : DEFAULT_SEGMENT_LENGTH;
+
+  dir = Z_Malloc(strlen(output) + sizeof(".segments"));
+  sprintf(dir, "%s.segments", output);
+  dsda_MkDir(dir, true);
+
+  start_time = dsda_TimeNS();
+
+  dsda_InitChildCommand(&base);
+
+  // Pass 1: key frames
+
+  path = dsda_SegmentPath(dir, SEGMENT_LIST);
+  remove(path);
+
+  dsda_InitString(&command, base.string);
+  dsda_AppendArg(&command, "-fastdemo");
+  dsda_AppendArg(&command, demo);
+  dsda_AppendArg(&command, "-nodraw");
+  dsda_AppendArg(&command, "-nosound");
+  dsda_AppendArg(&command, "-viddump_key_frames");
+  dsda_AppendArg(&command, "-viddump_segment_dir");
+  dsda_AppendArg(&command, dir);
+  dsda_AppendArg(&command, "-viddump_segment_length");
+  dsda_AppendIntArg(&command, length);
+
+  lprintf(LO_INFO, "dsda_RunSegmentCapture: exporting key frames\n  %s\n", command.string);
+
+  if (dsda_RunCommand(command.string))
+    I_Error("dsda_RunSegmentCapture: key frame pass failed");
+
+  dsda_FreeString(&command);
+
+  boundaries = Z_Malloc(sizeof(*boundaries));
+  boundaries[0] = 0;
+  boundary_count = 1;
+
+  // A demo shorter than one segment leaves no list behind
+  if (M_ReadFileToString(path, &list) >= 0) {
+    cursor = list;
+
+    while (true) {
+      char* end;
+      long tic;
+
+      tic = strtol(cursor, &end, 10);
+      if (end == cursor)
+        break;
+
+      boundaries = Z_Realloc(boundaries, (boundary_count + 1) * sizeof(*boundaries));
+      boundaries[boundary_count++] = tic;
+      cursor = end;
+    }
+
+    Z_Free(list);
+  }
+
+  Z_Free(path);
+
+  // Pass 2: segments
+
+  jobs.count = boundary_count;
+  jobs.commands = Z_Malloc(jobs.count * sizeof(*jobs.commands));
+  jobs.results = Z_Calloc(jobs.count, sizeof(*jobs.results));
+  SDL_AtomicSet(&jobs.next, 0);
+
+  for (i = 0; i < jobs.count; ++i) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "segment_%04d.mkv", i);
+
+    dsda_InitString(&command, base.string);
+    dsda_AppendArg(&command, "-timedemo");
+    dsda_AppendArg(&command, demo);
+    dsda_AppendArg(&command, "-viddump");
+    dsda_AppendArg(&command, name);
+    dsda_AppendArg(&command, "-viddump_segment_dir");
+    dsda_AppendArg(&command, dir);
+    dsda_AppendArg(&command, "-viddump_segment");
+    dsda_AppendIntArg(&command, boundaries[i]);
+    dsda_AppendIntArg(&command, i + 1 < boundary_count ? boundaries[i + 1] : 0);
+
+    jobs.commands[i] = command.string;
+  }
+
+  lprintf(LO_INFO, "dsda_RunSegmentCapture: capturing %d segments with %d processes\n",
+          jobs.count, workers);
+
+  pool = dsda_CreateThreadPool("segment_capture", workers);
+  dsda_RunThreadPool(pool, dsda_SegmentJob, &jobs);
+  dsda_DestroyThreadPool(pool);
+
+  for (i = 0; i < jobs.count; ++i)
+    if (jobs.results[i])
+      I_Error("dsda_RunSegmentCapture: segment %d failed\n  %s", i, jobs.commands[i]);
+
+  // Pass 3: concatenation
+
+  path = dsda_SegmentPath(dir, CONCAT_LIST);
+
+  file = fopen(path, "w");
+  if (!file)
+    I_Error("dsda_RunSegmentCapture: unable to write %s", path);
+
+  fprintf(file, "ffconcat version 1.0\n");
+  for (i = 0; i < jobs.count; ++i)
+    fprintf(file, "file 'segment_%04d.mkv'\n", i);
+
+  fclose(file);
+
+  concat_command = dsda_ConcatCommand(path, output);
+
+  lprintf(LO_INFO, "dsda_RunSegmentCapture: joining segments\n  %s\n", concat_command);
+
+  if (dsda_RunCommand(concat_command))
+    I_Error("dsda_RunSegmentCapture: concatenation failed");
+
+  lprintf(LO_INFO, "dsda_RunSegmentCapture: finished in %.1f s\n",
+          (double) (dsda_TimeNS() - start_time) / 1000000000);
+
+  I_SafeExit(0);
+}
+
+static void dsda_ExportBoundaryKeyFrame(void) {
+  char name[32];
+  char* path;
+  dsda_key_frame_t key_frame = { 0 };
+  FILE* file;
+
+  dsda_StoreKeyFrame(&key_frame, false, false);
+
+  snprintf(name, sizeof(name), "keyframe_%d.kf", next_boundary);
+  path = dsda_SegmentPath(segment_dir, name);
+
+  if (!M_WriteFile(path, key_frame.buffer, key_frame.buffer_length))
+    I_Error("dsda_ExportBoundaryKeyFrame: failed to write %s", path);
+
+  Z_Free(path);
+  Z_Free(key_frame.buffer);
+
+  path = dsda_SegmentPath(segment_dir, SEGMENT_LIST);
+
+  file = fopen(path, "a");
+  if (!file)
+    I_Error("dsda_ExportBoundaryKeyFrame: unable to write %s", path);
+
+  fprintf(file, "%d\n", next_boundary);
+  fclose(file);
+
+  Z_Free(path);
+}
+
+static void dsda_RestoreBoundaryKeyFrame(void) {
+  char name[32];
+  char* path;
+  dsda_key_frame_t key_frame = { 0 };
+  int skipped_tics;
+
+  snprintf(name, sizeof(name), "keyframe_%d.kf", segment_start);
+  path = dsda_SegmentPath(segment_dir, name);
+
+  if (M_ReadFile(path, &key_frame.buffer) < 0)
+    I_Error("dsda_RestoreBoundaryKeyFrame: unable to read %s", path);
+
+  Z_Free(path);
+
+  skipped_tics = -dsda_PlaybackTics();
+  dsda_RestoreKeyFrame(&key_frame, true);
+  skipped_tics += dsda_PlaybackTics();
+
+  Z_Free(key_frame.buffer);
+
+  // Keep the capture in step with an uninterrupted run
+  I_CaptureSkipTics(skipped_tics);
+}
+
+static void dsda_InitSegmentCapture(void) {
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_viddump_segment_dir);
+  if (!arg->found)
+    return;
+
+  segment_dir = arg->value.v_string;
+
+  if (dsda_Flag(dsda_arg_viddump_key_frames)) {
+    arg = dsda_Arg(dsda_arg_viddump_segment_length);
+
+    exporting_key_frames = true;
+    segment_tics = (arg->found ? arg->value.v_int : DEFAULT_SEGMENT_LENGTH) * TICRATE;
+    next_boundary = segment_tics;
+
+    return;
+  }
+
+  arg = dsda_Arg(dsda_arg_viddump_segment);
+  if (arg->found && capturing_video) {
+    capturing_segment = true;
+    segment_start = arg->value.v_int_array[0];
+    segment_end = arg->value.v_int_array[1];
+    segment_started = !segment_start;
+  }
+}
+
+void dsda_UpdateSegmentCapture(void) {
+  int tic;
+
+  DO_ONCE
+    dsda_InitSegmentCapture();
+  END_ONCE
+
+  if (!demoplayback)
+    return;
+
+  tic = dsda_PlaybackTics();
+
+  if (exporting_key_frames) {
+    // Boundaries without a usable tic in front of them join the next segment
+    while (tic > next_boundary - PRE_ROLL_MIN) {
+      lprintf(LO_WARN, "dsda_UpdateSegmentCapture: no key frame for tic %d\n", next_boundary);
+      next_boundary += segment_tics;
+    }
+
+    if (
+      tic >= next_boundary - PRE_ROLL_MAX &&
+      gamestate == GS_LEVEL &&
+      gameaction == ga_nothing
+    ) {
+      dsda_ExportBoundaryKeyFrame();
+      next_boundary += segment_tics;
+    }
+  }
+  else if (capturing_segment) {
+    if (!segment_started && gamestate == GS_LEVEL && gameaction == ga_nothing) {
+      dsda_RestoreBoundaryKeyFrame();
+      segment_started = true;
+    }
+
+    if (segment_end && tic >= segment_end)
+      I_SafeExit(0);
+  }
+}
+
+dboolean dsda_SegmentCapturePreRoll(void) {
+  return capturing_segment &&
+         (!segment_started || (segment_start && dsda_PlaybackTics() <= segment_start));
+}
+
+const char* dsda_SegmentCaptureDir(void) {
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_viddump_segment_dir);
+
+  return arg->found ? arg->value.v_string : NULL;
+}
@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Segment Capture
+//
+
+#ifndef __DSDA_SEGMENT_CAPTURE__
+#define __DSDA_SEGMENT_CAPTURE__
+
+#include "doomtype.h"
+
+void dsda_RunSegmentCapture(void);
+void dsda_UpdateSegmentCapture(void);
+dboolean dsda_SegmentCapturePreRoll(void);
+const char* dsda_SegmentCaptureDir(void);
+
+#endif
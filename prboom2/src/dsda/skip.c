@@ -101,7 +101,7 @@ void dsda_ExitSkipMode(void) {
   I_Init2();
   I_InitSound();
   S_Init();
-  S_RestartMusic();
+  S_RestartMusicAt(S_MusicTics());
 
   if (V_IsOpenGLMode())
     gld_PreprocessLevel();
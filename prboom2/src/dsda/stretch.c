@@ -20,6 +20,7 @@
 #include "r_main.h"
 #include "st_stuff.h"
 #include "v_video.h"
+#include "z_zone.h"
 
 #include "dsda/configuration.h"
 
@@ -46,6 +47,10 @@ static stretch_param_t stretch_params_table[patch_stretch_max][VPT_ALIGN_MAX];
 static int ex_text_scale;
 static int ex_text_top_displacement;
 
+static int* view_xlookup;
+static int view_xlookup_width;
+static int view_xlookup_source_width;
+
 static void GenLookup(short* lookup1, short* lookup2, int size, int max, int step) {
   int i;
   fixed_t frac, lastfrac;
@@ -267,3 +272,51 @@ void dsda_EvaluatePatchScale(void) {
   wide_offsetx = wide_offset2x / 2;
   wide_offsety = wide_offset2y / 2;
 }
+
+static void GenViewLookup(int source_width, int width) {
+  int x;
+
+  if (view_xlookup && view_xlookup_width == width && view_xlookup_source_width == source_width)
+    return;
+
+  view_xlookup = Z_Realloc(view_xlookup, width * sizeof(*view_xlookup));
+  view_xlookup_width = width;
+  view_xlookup_source_width = source_width;
+
+  for (x = 0; x < width; x++)
+    view_xlookup[x] = (int) ((int64_t) x * source_width / width);
+}
+
+// Nearest neighbour upscale of a reduced resolution view into screens[0]
+void dsda_StretchViewBuffer(const byte* source, int source_pitch,
+                            int source_width, int source_height,
+                            int width, int height) {
+  int x, y;
+  int source_y, last_source_y;
+  byte* dest;
+  byte* last_dest;
+
+  GenViewLookup(source_width, width);
+
+  last_source_y = -1;
+  last_dest = NULL;
+  dest = screens[0].data;
+
+  for (y = 0; y < height; y++, dest += screens[0].pitch) {
+    source_y = (int) ((int64_t) y * source_height / height);
+
+    // Rows that sample the same source line are identical
+    if (source_y == last_source_y) {
+      memcpy(dest, last_dest, width);
+    }
+    else {
+      const byte* line = source + source_y * source_pitch;
+
+      for (x = 0; x < width; x++)
+        dest[x] = line[view_xlookup[x]];
+
+      last_source_y = source_y;
+      last_dest = dest;
+    }
+  }
+}
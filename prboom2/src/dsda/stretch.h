@@ -61,3 +61,6 @@ extern int patches_scaley;
 stretch_param_t* dsda_StretchParams(int flags);
 void dsda_SetupStretchParams(void);
 void dsda_EvaluatePatchScale(void);
+void dsda_StretchViewBuffer(const byte* source, int source_pitch,
+                            int source_width, int source_height,
+                            int width, int height);
@@ -0,0 +1,125 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Thread Pool
+//
+//	A fork / join pool: every job runs once per worker, with worker 0
+//	being the calling thread, and the call returns when all are done.
+//
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "doomtype.h"
+#include "lprintf.h"
+#include "z_zone.h"
+
+#include "thread_pool.h"
+
+typedef struct {
+  dsda_thread_pool_t* pool;
+  SDL_Thread* thread;
+  SDL_sem* start;
+  int index;
+} dsda_worker_t;
+
+struct dsda_thread_pool_s {
+  dsda_worker_t* workers;
+  int count;
+  SDL_sem* done;
+  dsda_thread_job_t job;
+  void* data;
+  dboolean quit;
+};
+
+static int dsda_WorkerThread(void* data) {
+  dsda_worker_t* worker = data;
+  dsda_thread_pool_t* pool = worker->pool;
+
+  while (1) {
+    SDL_SemWait(worker->start);
+
+    if (pool->quit)
+      break;
+
+    pool->job(worker->index, pool->data);
+
+    SDL_SemPost(pool->done);
+  }
+
+  return 0;
+}
+
+dsda_thread_pool_t* dsda_CreateThreadPool(const char* name, int count) {
+  dsda_thread_pool_t* pool;
+  int i;
+
+  pool = Z_Calloc(1, sizeof(*pool));
+  pool->workers = Z_Calloc(count, sizeof(*pool->workers));
+  pool->count = count;
+  pool->done = SDL_CreateSemaphore(0);
+
+  for (i = 1; i < count; ++i) {
+    dsda_worker_t* worker = &pool->workers[i];
+
+    worker->pool = pool;
+    worker->index = i;
+    worker->start = SDL_CreateSemaphore(0);
+    worker->thread = SDL_CreateThread(dsda_WorkerThread, name, worker);
+
+    if (!worker->thread) {
+      lprintf(LO_WARN, "dsda_CreateThreadPool: %s\n", SDL_GetError());
+      SDL_DestroySemaphore(worker->start);
+      pool->count = i;
+      break;
+    }
+  }
+
+  return pool;
+}
+
+void dsda_DestroyThreadPool(dsda_thread_pool_t* pool) {
+  int i;
+
+  pool->quit = true;
+
+  for (i = 1; i < pool->count; ++i) {
+    SDL_SemPost(pool->workers[i].start);
+    SDL_WaitThread(pool->workers[i].thread, NULL);
+    SDL_DestroySemaphore(pool->workers[i].start);
+  }
+
+  SDL_DestroySemaphore(pool->done);
+  Z_Free(pool->workers);
+  Z_Free(pool);
+}
+
+int dsda_ThreadPoolSize(dsda_thread_pool_t* pool) {
+  return pool->count;
+}
+
+void dsda_RunThreadPool(dsda_thread_pool_t* pool, dsda_thread_job_t job, void* data) {
+  int i;
+
+  pool->job = job;
+  pool->data = data;
+
+  for (i = 1; i < pool->count; ++i)
+    SDL_SemPost(pool->workers[i].start);
+
+  job(0, data);
+
+  for (i = 1; i < pool->count; ++i)
+    SDL_SemWait(pool->done);
+}
@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Thread Pool
+//
+
+#ifndef __DSDA_THREAD_POOL__
+#define __DSDA_THREAD_POOL__
+
+typedef void (*dsda_thread_job_t)(int index, void* data);
+
+typedef struct dsda_thread_pool_s dsda_thread_pool_t;
+
+dsda_thread_pool_t* dsda_CreateThreadPool(const char* name, int count);
+void dsda_DestroyThreadPool(dsda_thread_pool_t* pool);
+int dsda_ThreadPoolSize(dsda_thread_pool_t* pool);
+void dsda_RunThreadPool(dsda_thread_pool_t* pool, dsda_thread_job_t job, void* data);
+
+#endif
@@ -67,6 +67,14 @@ unsigned long long dsda_ElapsedTime(int timer) {
          (now.tv_sec - dsda_time[timer].tv_sec) * 1000000;
 }
 
+unsigned long long dsda_TimeNS(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (unsigned long long) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 unsigned long long dsda_ElapsedTimeMS(int timer) {
   return dsda_ElapsedTime(timer) / 1000;
 }
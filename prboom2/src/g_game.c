@@ -95,8 +95,10 @@
 #include "dsda/excmd.h"
 #include "dsda/exdemo.h"
 #include "dsda/features.h"
+#include "dsda/frame_stats.h"
 #include "dsda/key_frame.h"
 #include "dsda/save.h"
+#include "dsda/segment_capture.h"
 #include "dsda/settings.h"
 #include "dsda/input.h"
 #include "dsda/map_format.h"
@@ -1440,6 +1442,7 @@ void G_Ticker (void)
     int buf = gametic % BACKUPTICS;
 
     dsda_UpdateAutoKeyFrames();
+    dsda_UpdateSegmentCapture();
 
     if (dsda_BruteForce())
     {
@@ -2311,6 +2314,8 @@ void G_AfterLoad(void)
     S_ChangeMusInfoMusic(musinfo.current_item, true);
   }
 
+  dsda_RestoreMusicPosition();
+
   RecalculateDrawnSubsectors();
 
   if (hexen)
@@ -3918,6 +3923,7 @@ dboolean G_CheckDemoStatus (void)
     lprintf(LO_INFO, "Timed %u gametics in %u realtics = %-.1f frames per second\n",
              (unsigned) gametic,realtics,
              (unsigned) gametic * (double) TICRATE / realtics);
+    dsda_ReportFrameStats();
     I_SafeExit(0);
   }
 
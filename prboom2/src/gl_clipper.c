@@ -75,118 +75,18 @@
 #include "r_main.h"
 #include "e6y.h"
 
-float frustum[6][4];
-
-typedef struct clipnode_s
-{
-  struct clipnode_s *prev, *next;
-  angle_t start, end;
-} clipnode_t;
-
-clipnode_t *freelist;
-clipnode_t *clipnodes;
-clipnode_t *cliphead;
-
-static clipnode_t * gld_clipnode_GetNew(void);
-static clipnode_t * gld_clipnode_NewRange(angle_t start, angle_t end);
-static dboolean gld_clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle);
-static void gld_clipper_AddClipRange(angle_t start, angle_t end);
-static void gld_clipper_RemoveRange(clipnode_t * range);
-static void gld_clipnode_Free(clipnode_t *node);
-
-static clipnode_t * gld_clipnode_GetNew(void)
-{
-  if (freelist)
-  {
-    clipnode_t * p = freelist;
-    freelist = p->next;
-    return p;
-  }
-  else
-  {
-    return Z_Malloc(sizeof(clipnode_t));
-  }
-}
+#include "dsda/gl/clip_ranges.h"
 
-static clipnode_t * gld_clipnode_NewRange(angle_t start, angle_t end)
-{
-  clipnode_t * c = gld_clipnode_GetNew();
-  c->start = start;
-  c->end = end;
-  c->next = c->prev=NULL;
-  return c;
-}
+float frustum[6][4];
 
 dboolean gld_clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle)
 {
-  if(startAngle > endAngle)
-  {
-    return (gld_clipper_IsRangeVisible(startAngle, ANGLE_MAX) || gld_clipper_IsRangeVisible(0, endAngle));
-  }
-
-  return gld_clipper_IsRangeVisible(startAngle, endAngle);
-}
-
-static dboolean gld_clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle)
-{
-  clipnode_t *ci;
-  ci = cliphead;
-
-  if (endAngle == 0 && ci && ci->start == 0)
-    return false;
-
-  while (ci != NULL && ci->start < endAngle)
-  {
-    if (startAngle >= ci->start && endAngle <= ci->end)
-    {
-      return false;
-    }
-    ci = ci->next;
-  }
-
-  return true;
-}
-
-static void gld_clipnode_Free(clipnode_t *node)
-{
-  node->next = freelist;
-  freelist = node;
-}
-
-static void gld_clipper_RemoveRange(clipnode_t *range)
-{
-  if (range == cliphead)
-  {
-    cliphead = cliphead->next;
-  }
-  else
-  {
-    if (range->prev)
-    {
-      range->prev->next = range->next;
-    }
-    if (range->next)
-    {
-      range->next->prev = range->prev;
-    }
-  }
-
-  gld_clipnode_Free(range);
+  return dsda_ClipRangeVisible(startAngle, endAngle);
 }
 
 void gld_clipper_SafeAddClipRange(angle_t startangle, angle_t endangle)
 {
-  if(startangle > endangle)
-  {
-    // The range has to added in two parts.
-    gld_clipper_AddClipRange(startangle, ANGLE_MAX);
-    gld_clipper_AddClipRange(0, endangle);
-  }
-  else
-  {
-    // Add the range as usual.
-    gld_clipper_AddClipRange(startangle, endangle);
-  }
+  dsda_AddClipRange(startangle, endangle);
 }
 
 angle_t gld_clipper_AngleToPseudo(angle_t ang)
@@ -209,130 +109,6 @@ static void gld_clipper_SafeAddClipRangeRealAngles(angle_t startangle, angle_t e
     gld_clipper_AngleToPseudo(endangle));
 }
 
-
-static void gld_clipper_AddClipRange(angle_t start, angle_t end)
-{
-  clipnode_t *node, *temp, *prevNode, *node2, *delnode;
-
-  if (cliphead)
-  {
-    //check to see if range contains any old ranges
-    node = cliphead;
-    while (node != NULL && node->start < end)
-    {
-      if (node->start >= start && node->end <= end)
-      {
-        temp = node;
-        node = node->next;
-        gld_clipper_RemoveRange(temp);
-      }
-      else
-      {
-        if (node->start <= start && node->end >= end)
-        {
-          return;
-        }
-        else
-        {
-          node = node->next;
-        }
-      }
-    }
-
-    //check to see if range overlaps a range (or possibly 2)
-    node = cliphead;
-    while (node != NULL && node->start <= end)
-    {
-      if (node->end >= start)
-      {
-        // we found the first overlapping node
-        if (node->start > start)
-        {
-          // the new range overlaps with this node's start point
-          node->start = start;
-        }
-        if (node->end < end)
-        {
-          node->end = end;
-        }
-
-        node2 = node->next;
-        while (node2 && node2->start <= node->end)
-        {
-          if (node2->end > node->end)
-          {
-            node->end = node2->end;
-          }
-
-          delnode = node2;
-          node2 = node2->next;
-          gld_clipper_RemoveRange(delnode);
-        }
-        return;
-      }
-      node = node->next;
-    }
-
-    //just add range
-    node = cliphead;
-    prevNode = NULL;
-    temp = gld_clipnode_NewRange(start, end);
-    while (node != NULL && node->start < end)
-    {
-      prevNode = node;
-      node = node->next;
-    }
-    temp->next = node;
-    if (node == NULL)
-    {
-      temp->prev = prevNode;
-      if (prevNode)
-      {
-        prevNode->next = temp;
-      }
-      if (!cliphead)
-      {
-        cliphead = temp;
-      }
-    }
-    else
-    {
-      if (node == cliphead)
-      {
-        cliphead->prev = temp;
-        cliphead = temp;
-      }
-      else
-      {
-        temp->prev = prevNode;
-        prevNode->next = temp;
-        node->prev = temp;
-      }
-    }
-  }
-  else
-  {
-    temp = gld_clipnode_NewRange(start, end);
-    cliphead = temp;
-    return;
-  }
-}
-
-static void gld_clipper_Clear(void)
-{
-  clipnode_t *node = cliphead;
-  clipnode_t *temp;
-
-  while (node != NULL)
-  {
-    temp = node;
-    node = node->next;
-    gld_clipnode_Free(temp);
-  }
-
-  cliphead = NULL;
-}
-
 static angle_t gld_FrustumAngle(void)
 {
   double floatangle;
@@ -383,7 +159,7 @@ void gld_FrustumSetup(void)
   float clip[16];
   angle_t a1 = gld_FrustumAngle();
 
-  gld_clipper_Clear();
+  dsda_ClearClipRanges();
   gld_clipper_SafeAddClipRangeRealAngles(viewangle + a1, viewangle - a1);
 
   clip[0]  = CALCMATRIX(0, 0, 1, 4, 2, 8, 3, 12);
@@ -370,6 +370,77 @@ void gld_InitHiRes(void)
   gl_has_hires = 0;
 }
 
+// Decodes an in-wad hires lump to RGBA and smooths its edges.
+// No GL or zone calls, so gld_Precache runs this on worker threads.
+SDL_Surface *gld_HiRes_DecodeLump(GLTexture *gltexture, const void *data, int size)
+{
+  SDL_RWops *rw_data = SDL_RWFromConstMem(data, size);
+  SDL_Surface *surf_tmp = IMG_Load_RW(rw_data, false);
+  SDL_Surface *surf;
+
+  // SDL can't load some TGA with common method
+  if (!surf_tmp)
+  {
+    surf_tmp = IMG_LoadTyped_RW(rw_data, false, "TGA");
+  }
+
+  SDL_FreeRW(rw_data);
+
+  if (!surf_tmp)
+    return NULL;
+
+  surf = SDL_ConvertSurface(surf_tmp, &RGBAFormat, 0);
+  SDL_FreeSurface(surf_tmp);
+
+  if (surf && SDL_LockSurface(surf) >= 0)
+  {
+    if (SmoothEdges(surf->pixels, surf->pitch / 4, surf->h))
+      gltexture->flags |= GLTEXTURE_HASHOLES;
+    else
+      gltexture->flags &= ~GLTEXTURE_HASHOLES;
+    SDL_UnlockSurface(surf);
+  }
+
+  return surf;
+}
+
+// Uploads a decoded hires surface as the default texture and frees it
+void gld_HiRes_UploadSurface(GLTexture *gltexture, SDL_Surface *surf)
+{
+  GLuint *texid = &gltexture->glTexExID[CR_DEFAULT][0][0];
+
+  gld_HiRes_Bind(gltexture, texid);
+  gld_BuildTexture(gltexture, surf->pixels, true, surf->w, surf->h);
+
+  SDL_FreeSurface(surf);
+}
+
+// Returns the in-wad hires lump gld_LoadHiresTex would decode next.
+// When there is none and nothing is loaded yet, the texture is flagged
+// exactly as gld_LoadHiresTex would flag it.
+int gld_HiRes_PrecacheLump(GLTexture *gltexture)
+{
+  const char *lumpname;
+  int lump;
+
+  if (V_IsWorldLightmodeIndexed())
+    return LUMP_NOT_FOUND;
+
+  if (gltexture->flags & GLTEXTURE_HASNOHIRES)
+    return LUMP_NOT_FOUND;
+
+  if (gltexture->glTexExID[CR_DEFAULT][0][0])
+    return LUMP_NOT_FOUND;
+
+  lumpname = gld_HiRes_GetInternalName(gltexture);
+  lump = lumpname ? W_CheckNumForName2(lumpname, ns_hires) : LUMP_NOT_FOUND;
+
+  if (lump == LUMP_NOT_FOUND)
+    gltexture->flags |= GLTEXTURE_HASNOHIRES;
+
+  return lump;
+}
+
 int gld_LoadHiresTex(GLTexture *gltexture, int cm)
 {
   int result = false;
@@ -403,41 +474,15 @@ int gld_LoadHiresTex(GLTexture *gltexture, int cm)
           int lump = W_CheckNumForName2(lumpname, ns_hires);
           if (lump != LUMP_NOT_FOUND)
           {
-            SDL_RWops *rw_data = SDL_RWFromConstMem(W_LumpByNum(lump), W_LumpLength(lump));
-            SDL_Surface *surf_tmp = IMG_Load_RW(rw_data, false);
+            SDL_Surface *surf = gld_HiRes_DecodeLump(gltexture, W_LumpByNum(lump), W_LumpLength(lump));
 
-            // SDL can't load some TGA with common method
-            if (!surf_tmp)
-            {
-              surf_tmp = IMG_LoadTyped_RW(rw_data, false, "TGA");
-            }
-
-            SDL_FreeRW(rw_data);
-
-            if (!surf_tmp)
+            if (!surf)
             {
               lprintf(LO_WARN, "gld_LoadHiresTex: %s\n", SDL_GetError());
             }
             else
             {
-              SDL_Surface *surf = SDL_ConvertSurface(surf_tmp, &RGBAFormat, 0);
-              SDL_FreeSurface(surf_tmp);
-
-              if (surf)
-              {
-                if (SDL_LockSurface(surf) >= 0)
-                {
-                  if (SmoothEdges(surf->pixels, surf->pitch / 4, surf->h))
-                    gltexture->flags |= GLTEXTURE_HASHOLES;
-                  else
-                    gltexture->flags &= ~GLTEXTURE_HASHOLES;
-                  SDL_UnlockSurface(surf);
-                }
-                gld_HiRes_Bind(gltexture, texid);
-                gld_BuildTexture(gltexture, surf->pixels, true, surf->w, surf->h);
-
-                SDL_FreeSurface(surf);
-              }
+              gld_HiRes_UploadSurface(gltexture, surf);
             }
           }
         }
@@ -385,6 +385,18 @@ GLTexture *gld_RegisterTexture(int texture_num, dboolean mipmap, dboolean force,
 void gld_BindTexture(GLTexture *gltexture, unsigned int flags);
 GLTexture *gld_RegisterPatch(int lump, int cm, dboolean is_sprite, dboolean indexed);
 void gld_BindPatch(GLTexture *gltexture, int cm);
+
+// Position of a patch inside a sprite atlas page, in page coordinates
+typedef struct
+{
+  int page;
+  float u, v;
+  float su, sv;
+} GLAtlasPatch;
+
+dboolean gld_GetSpriteAtlasPatch(GLTexture *gltexture, int cm, GLAtlasPatch *atlas_patch);
+void gld_BindSpriteAtlasPage(int page);
+void gld_ResetSpriteAtlas(void);
 GLTexture *gld_RegisterRaw(int lump, int width, int height, dboolean mipmap, dboolean indexed);
 void gld_BindRaw(GLTexture *gltexture, unsigned int flags);
 #define gld_RegisterFlat(lump, mipmap, indexed) \
@@ -425,6 +437,11 @@ extern unsigned int gl_has_hires;
 int gld_HiRes_BuildTables(void);
 void gld_InitHiRes(void);
 int gld_LoadHiresTex(GLTexture *gltexture, int cm);
+#ifdef HAVE_LIBSDL2_IMAGE
+struct SDL_Surface *gld_HiRes_DecodeLump(GLTexture *gltexture, const void *data, int size);
+void gld_HiRes_UploadSurface(GLTexture *gltexture, struct SDL_Surface *surf);
+int gld_HiRes_PrecacheLump(GLTexture *gltexture);
+#endif
 void gld_GetTextureTexID(GLTexture *gltexture, int cm);
 GLuint CaptureScreenAsTexID(void);
 void gld_ProgressUpdate(const char * text, int progress, int total);
@@ -41,6 +41,7 @@
 
 #include "z_zone.h"
 #include <math.h>
+#include <stddef.h>
 #include <SDL.h>
 #include "doomtype.h"
 #include "w_wad.h"
@@ -77,6 +78,7 @@
 #include "dsda/settings.h"
 #include "dsda/stretch.h"
 #include "dsda/gl/render_scale.h"
+#include "dsda/gl/sprite_batch.h"
 
 int gl_preprocessed = false;
 
@@ -1516,6 +1518,7 @@ static void gld_DrawWall(GLWall *wall)
   unsigned int flags;
 
   dsda_RecordDrawSeg();
+  dsda_RecordDrawCall();
 
   has_detail =
     scene_has_details &&
@@ -2172,6 +2175,8 @@ static void gld_DrawFlat(GLFlat *flat)
 
   if (flat->sectornum>=0)
   {
+    dsda_RecordDrawCalls(sectorloops[flat->sectornum].loopcount);
+
     // go through all loops of this sector
     for (loopnum=0; loopnum<sectorloops[flat->sectornum].loopcount; loopnum++)
     {
@@ -2423,33 +2428,9 @@ void gld_AddPlane(int subsectornum, visplane_t *floor, visplane_t *ceiling)
  *               *
  *****************/
 
-static void gld_DrawSprite(GLSprite *sprite)
+// Corners are in triangle strip order: top left, top right, bottom left, bottom right
+static void gld_CalcSpriteCorners(GLSprite *sprite, dsda_batch_vertex_t *corners)
 {
-  GLint blend_src, blend_dst;
-  int restore = 0;
-
-  dsda_RecordVisSprite();
-
-  gld_BindPatch(sprite->gltexture,sprite->cm);
-
-  if (!(sprite->flags & MF_NO_DEPTH_TEST))
-  {
-    if(sprite->flags & g_mf_shadow)
-    {
-      glGetIntegerv(GL_BLEND_SRC, &blend_src);
-      glGetIntegerv(GL_BLEND_DST, &blend_dst);
-      restore = 1;
-      gld_StartFuzz((float)sprite->gltexture->width, (float)sprite->gltexture->height);
-    }
-    else
-    {
-      if (sprite->alpha != 1.f)
-        gld_StaticLightAlpha(sprite->light, sprite->alpha);
-      else
-        gld_StaticLight(sprite->light);
-    }
-  }
-
   if (!(sprite->flags & (MF_SOLID | MF_SPAWNCEILING)))
   {
     float x1, x2, x3, x4, z1, z2, z3, z4;
@@ -2477,12 +2458,10 @@ static void gld_DrawSprite(GLSprite *sprite)
     z3 = -(sprite->x1 * sin_inv_yaw + y2z2_y * cos_inv_yaw) + sprite->z;
     z4 = -(sprite->x2 * sin_inv_yaw + y2z2_y * cos_inv_yaw) + sprite->z;
 
-    glBegin(GL_TRIANGLE_STRIP);
-    glTexCoord2f(sprite->ul, sprite->vt); glVertex3f(x1, y1, z1);
-    glTexCoord2f(sprite->ur, sprite->vt); glVertex3f(x2, y1, z2);
-    glTexCoord2f(sprite->ul, sprite->vb); glVertex3f(x3, y2, z3);
-    glTexCoord2f(sprite->ur, sprite->vb); glVertex3f(x4, y2, z4);
-    glEnd();
+    corners[0].x = x1; corners[0].y = y1; corners[0].z = z1;
+    corners[1].x = x2; corners[1].y = y1; corners[1].z = z2;
+    corners[2].x = x3; corners[2].y = y2; corners[2].z = z3;
+    corners[3].x = x4; corners[3].y = y2; corners[3].z = z4;
   }
   else
   {
@@ -2497,14 +2476,58 @@ static void gld_DrawSprite(GLSprite *sprite)
     z2 = -(sprite->x1 * sin_inv_yaw) + sprite->z;
     z1 = -(sprite->x2 * sin_inv_yaw) + sprite->z;
 
-    glBegin(GL_TRIANGLE_STRIP);
-    glTexCoord2f(sprite->ul, sprite->vt); glVertex3f(x1, y1, z2);
-    glTexCoord2f(sprite->ur, sprite->vt); glVertex3f(x2, y1, z1);
-    glTexCoord2f(sprite->ul, sprite->vb); glVertex3f(x1, y2, z2);
-    glTexCoord2f(sprite->ur, sprite->vb); glVertex3f(x2, y2, z1);
-    glEnd();
+    corners[0].x = x1; corners[0].y = y1; corners[0].z = z2;
+    corners[1].x = x2; corners[1].y = y1; corners[1].z = z1;
+    corners[2].x = x1; corners[2].y = y2; corners[2].z = z2;
+    corners[3].x = x2; corners[3].y = y2; corners[3].z = z1;
   }
 
+  corners[0].u = sprite->ul; corners[0].v = sprite->vt;
+  corners[1].u = sprite->ur; corners[1].v = sprite->vt;
+  corners[2].u = sprite->ul; corners[2].v = sprite->vb;
+  corners[3].u = sprite->ur; corners[3].v = sprite->vb;
+}
+
+static void gld_DrawSprite(GLSprite *sprite)
+{
+  GLint blend_src, blend_dst;
+  dsda_batch_vertex_t corners[4];
+  int restore = 0;
+  int i;
+
+  dsda_RecordVisSprite();
+  dsda_RecordDrawCall();
+
+  gld_BindPatch(sprite->gltexture,sprite->cm);
+
+  if (!(sprite->flags & MF_NO_DEPTH_TEST))
+  {
+    if(sprite->flags & g_mf_shadow)
+    {
+      glGetIntegerv(GL_BLEND_SRC, &blend_src);
+      glGetIntegerv(GL_BLEND_DST, &blend_dst);
+      restore = 1;
+      gld_StartFuzz((float)sprite->gltexture->width, (float)sprite->gltexture->height);
+    }
+    else
+    {
+      if (sprite->alpha != 1.f)
+        gld_StaticLightAlpha(sprite->light, sprite->alpha);
+      else
+        gld_StaticLight(sprite->light);
+    }
+  }
+
+  gld_CalcSpriteCorners(sprite, corners);
+
+  glBegin(GL_TRIANGLE_STRIP);
+  for (i = 0; i < 4; i++)
+  {
+    glTexCoord2f(corners[i].u, corners[i].v);
+    glVertex3f(corners[i].x, corners[i].y, corners[i].z);
+  }
+  glEnd();
+
   if (restore)
   {
     glBlendFunc(blend_src, blend_dst);
@@ -2512,6 +2535,104 @@ static void gld_DrawSprite(GLSprite *sprite)
   }
 }
 
+//
+// Sprite batching
+//
+// Opaque sprites whose patches fit in the sprite atlas are gathered into
+// one streamed vertex buffer and drawn with a call per atlas page and
+// light level. Everything else goes through gld_DrawSprite.
+//
+
+static GLuint sprite_batch_vbo_id = 0;
+
+static dboolean gld_AddSpriteToBatch(GLSprite *sprite)
+{
+  GLAtlasPatch atlas_patch;
+  dsda_batch_vertex_t corners[4];
+  int i;
+
+  if (sprite->alpha != 1.f || sprite->flags & (MF_NO_DEPTH_TEST | g_mf_shadow))
+    return false;
+
+  if (!gld_GetSpriteAtlasPatch(sprite->gltexture, sprite->cm, &atlas_patch))
+    return false;
+
+  dsda_RecordVisSprite();
+
+  gld_CalcSpriteCorners(sprite, corners);
+  for (i = 0; i < 4; i++)
+  {
+    corners[i].u = atlas_patch.u + corners[i].u * atlas_patch.su;
+    corners[i].v = atlas_patch.v + corners[i].v * atlas_patch.sv;
+  }
+
+  dsda_AddSpriteBatchQuad(atlas_patch.page, sprite->light, sprite->fogdensity, corners);
+
+  return true;
+}
+
+static void gld_DrawSpriteBatch(GLDrawItemType itemtype)
+{
+  const dsda_batch_vertex_t *vertices;
+  const dsda_batch_range_t *ranges;
+  int range_count;
+  int i;
+
+  dsda_ResetSpriteBatch();
+
+  for (i = gld_drawinfo.num_items[itemtype] - 1; i >= 0; i--)
+  {
+    GLSprite *sprite = gld_drawinfo.items[itemtype][i].item.sprite;
+
+    if (!gld_AddSpriteToBatch(sprite))
+    {
+      gld_SetFog(sprite->fogdensity);
+      gld_DrawSprite(sprite);
+    }
+  }
+
+  if (!dsda_SpriteBatchQuadCount())
+    return;
+
+  range_count = dsda_BuildSpriteBatch(&vertices, &ranges);
+
+  if (gl_ext_arb_vertex_buffer_object)
+  {
+    if (!sprite_batch_vbo_id)
+      GLEXT_glGenBuffersARB(1, &sprite_batch_vbo_id);
+
+    GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, sprite_batch_vbo_id);
+    GLEXT_glBufferDataARB(GL_ARRAY_BUFFER,
+      dsda_SpriteBatchQuadCount() * 6 * sizeof(vertices[0]),
+      vertices, GL_STREAM_DRAW_ARB);
+    glVertexPointer(3, GL_FLOAT, sizeof(vertices[0]), (void *)offsetof(dsda_batch_vertex_t, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(vertices[0]), (void *)offsetof(dsda_batch_vertex_t, u));
+  }
+  else
+  {
+    glVertexPointer(3, GL_FLOAT, sizeof(vertices[0]), &vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(vertices[0]), &vertices[0].u);
+  }
+
+  for (i = 0; i < range_count; i++)
+  {
+    dsda_RecordDrawCall();
+
+    gld_BindSpriteAtlasPage(ranges[i].page);
+    gld_SetFog(ranges[i].fogdensity);
+    gld_StaticLight(ranges[i].light);
+    glDrawArrays(GL_TRIANGLES, ranges[i].first, ranges[i].count);
+  }
+
+  // back to the flat vertices for everything else in the scene
+  if (gl_ext_arb_vertex_buffer_object)
+  {
+    GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, flats_vbo_id);
+  }
+  glVertexPointer(3, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_x);
+  glTexCoordPointer(2, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_u);
+}
+
 static void gld_AddHealthBar(mobj_t* thing, GLSprite *sprite)
 {
   if (((thing->flags & (MF_COUNTKILL | MF_CORPSE)) == MF_COUNTKILL) && (thing->health > 0))
@@ -3188,10 +3309,17 @@ void gld_DrawScene(player_t *player)
 
   // opaque sprites
   gld_DrawItemsSortSprites(GLDIT_SPRITE);
-  for (i = gld_drawinfo.num_items[GLDIT_SPRITE] - 1; i >= 0; i--)
+  if (dsda_IntConfig(dsda_config_gl_sprite_batching))
   {
-    gld_SetFog(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite->fogdensity);
-    gld_DrawSprite(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite);
+    gld_DrawSpriteBatch(GLDIT_SPRITE);
+  }
+  else
+  {
+    for (i = gld_drawinfo.num_items[GLDIT_SPRITE] - 1; i >= 0; i--)
+    {
+      gld_SetFog(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite->fogdensity);
+      gld_DrawSprite(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite);
+    }
   }
 
   // mode for viewing all the alive monsters
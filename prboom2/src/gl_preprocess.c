@@ -54,6 +54,8 @@
 #include "am_map.h"
 #include "lprintf.h"
 
+#include "dsda/gl/level_cache.h"
+
 static FILE *levelinfo;
 
 static int gld_max_vertexes = 0;
@@ -894,6 +896,15 @@ static void gld_PreprocessSectors(void)
   flats_vbo = NULL;
   gld_max_vertexes=0;
   gld_num_vertexes=0;
+
+  if (dsda_LoadGLLevelCache(&gld_num_vertexes))
+  {
+    gld_max_vertexes = gld_num_vertexes;
+    gld_ProcessTexturedMap();
+    if (levelinfo) fclose(levelinfo);
+    return;
+  }
+
   if (numvertexes)
   {
     gld_AddGlobalVertexes(numvertexes*2);
@@ -997,6 +1008,8 @@ static void gld_PreprocessSectors(void)
 
   //e6y: for seamless rendering
   gld_MarkSectorsForClamp();
+
+  dsda_SaveGLLevelCache(gld_num_vertexes);
 }
 
 static void gld_PreprocessSegs(void)
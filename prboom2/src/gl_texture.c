@@ -70,6 +70,10 @@
 #include "p_spec.h"
 #include "e6y.h"
 
+#include "dsda/configuration.h"
+#include "dsda/thread_pool.h"
+#include "dsda/gl/atlas.h"
+
 int imageformats[5] = {0, GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA};
 
 /* TEXTURES */
@@ -1337,6 +1341,159 @@ void gld_BindPatch(GLTexture *gltexture, int cm)
   gld_SetTexClamp(gltexture, GLTEXTURE_CLAMPXY);
 }
 
+//
+// Sprite atlas
+//
+// Opaque sprites are copied into a few large pages so that gld_DrawScene
+// can draw them in batches instead of binding every patch separately.
+// Patches are keyed by texid_p, so every colormap variant gets its own
+// region, exactly like the standalone textures made by gld_BindPatch.
+//
+
+#define SPRITE_ATLAS_PAGE_SIZE 2048
+#define SPRITE_ATLAS_MAX_PAGES 8
+
+static dsda_atlas_t *sprite_atlas;
+static GLuint sprite_atlas_pages[SPRITE_ATLAS_MAX_PAGES];
+
+void gld_ResetSpriteAtlas(void)
+{
+  int i;
+
+  for (i = 0; i < SPRITE_ATLAS_MAX_PAGES; i++)
+  {
+    if (sprite_atlas_pages[i])
+    {
+      glDeleteTextures(1, &sprite_atlas_pages[i]);
+      sprite_atlas_pages[i] = 0;
+    }
+  }
+
+  if (sprite_atlas)
+    dsda_ResetAtlas(sprite_atlas);
+}
+
+void gld_BindSpriteAtlasPage(int page)
+{
+  glBindTexture(GL_TEXTURE_2D, sprite_atlas_pages[page]);
+  last_glTexID = NULL;
+}
+
+static void gld_CreateSpriteAtlasPage(int page)
+{
+  int size = dsda_AtlasPageSize(sprite_atlas);
+
+  glGenTextures(1, &sprite_atlas_pages[page]);
+  glBindTexture(GL_TEXTURE_2D, sprite_atlas_pages[page]);
+
+  glTexImage2D(GL_TEXTURE_2D, 0, gl_tex_format,
+    size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLEXT_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLEXT_CLAMP_TO_EDGE);
+}
+
+// The patch is written with a one texel border that repeats its edges,
+// which stands in for the clamping of a standalone texture
+static void gld_UploadSpriteAtlasPatch(GLTexture *gltexture, int cm, const dsda_atlas_region_t *region)
+{
+  unsigned char *buffer, *padded;
+  int width, height, padded_width, padded_height;
+  int y;
+
+  width = gltexture->buffer_width;
+  height = gltexture->buffer_height;
+  padded_width = width + 2;
+  padded_height = height + 2;
+
+  buffer = Z_Calloc(1, gltexture->buffer_size);
+  gld_AddPatchToTexture(gltexture, buffer, R_PatchByNum(gltexture->index), 0, 0, cm, 0);
+  if (gltexture->flags & GLTEXTURE_HASHOLES)
+  {
+    SmoothEdges(buffer, width, height);
+  }
+
+  padded = Z_Malloc(padded_width * padded_height * 4);
+  for (y = 0; y < padded_height; y++)
+  {
+    int source_y = (y == 0 ? 0 : y == padded_height - 1 ? height - 1 : y - 1);
+    const unsigned char *source = buffer + source_y * width * 4;
+    unsigned char *dest = padded + y * padded_width * 4;
+
+    memcpy(dest, source, 4);
+    memcpy(dest + 4, source, width * 4);
+    memcpy(dest + (padded_width - 1) * 4, source + (width - 1) * 4, 4);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, sprite_atlas_pages[region->page]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, region->x - 1, region->y - 1,
+    padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, padded);
+  last_glTexID = NULL;
+
+  Z_Free(padded);
+  Z_Free(buffer);
+}
+
+dboolean gld_GetSpriteAtlasPatch(GLTexture *gltexture, int cm, GLAtlasPatch *atlas_patch)
+{
+  const dsda_atlas_region_t *region;
+  int page_size;
+  float size;
+
+  if (!gltexture || gltexture->textype != GLDT_PATCH)
+    return false;
+
+  // Scaled down patches don't match their uv coordinates
+  if (gltexture->buffer_width != gltexture->tex_width ||
+      gltexture->buffer_height != gltexture->tex_height)
+    return false;
+
+#ifdef HAVE_LIBSDL2_IMAGE
+  // gld_BindPatch looks for a hires replacement the first time the patch
+  // is drawn, and marks the patches that don't have one
+  if (!V_IsWorldLightmodeIndexed() && !(gltexture->flags & GLTEXTURE_HASNOHIRES))
+    return false;
+#endif
+
+  if (!sprite_atlas)
+  {
+    sprite_atlas = dsda_CreateAtlas(MIN(gl_max_texture_size, SPRITE_ATLAS_PAGE_SIZE),
+                                    SPRITE_ATLAS_MAX_PAGES, 1);
+  }
+
+  gld_GetTextureTexID(gltexture, cm);
+
+  region = dsda_AtlasFind(sprite_atlas, gltexture->texid_p);
+  if (!region)
+  {
+    region = dsda_AtlasInsert(sprite_atlas, gltexture->texid_p,
+                              gltexture->buffer_width, gltexture->buffer_height);
+
+    if (region->page >= 0)
+    {
+      if (!sprite_atlas_pages[region->page])
+        gld_CreateSpriteAtlasPage(region->page);
+
+      gld_UploadSpriteAtlasPatch(gltexture, cm, region);
+    }
+  }
+
+  if (region->page < 0)
+    return false;
+
+  page_size = dsda_AtlasPageSize(sprite_atlas);
+  size = (float)page_size;
+  atlas_patch->page = region->page;
+  atlas_patch->u = (float)region->x / size;
+  atlas_patch->v = (float)region->y / size;
+  atlas_patch->su = (float)gltexture->tex_width / size;
+  atlas_patch->sv = (float)gltexture->tex_height / size;
+
+  return true;
+}
+
 GLTexture *gld_RegisterRaw(int lump, int width, int height, dboolean mipmap, dboolean indexed)
 {
   GLTexture *gltexture;
@@ -1757,6 +1914,8 @@ void gld_FlushTextures(void)
   gld_CleanTexItems(gld_numGLColormaps, &gld_GLFullbrightColormapTextures);
   gld_CleanTexItems(numtextures * gld_numGLColormaps, &gld_GLIndexedSkyTextures);
 
+  gld_ResetSpriteAtlas();
+
   gl_has_hires = 0;
 
   gld_ResetLastTexture();
@@ -1787,6 +1946,257 @@ static void CalcHitsCount(const byte *hitlist, int size, int *hit, int*hitcount)
   }
 }
 
+//
+// gld_Precache registers everything on the main thread, then converts
+// the patches to RGBA (or decodes their hires replacements) on a worker
+// pool in batches. Only the uploads happen on the main thread.
+//
+
+#define PRECACHE_BATCH_ITEMS 256
+#define PRECACHE_BATCH_BYTES (64 * 1024 * 1024)
+
+typedef enum
+{
+  precache_flat,
+  precache_texture,
+  precache_patch,
+} precache_kind_t;
+
+typedef struct
+{
+  GLTexture *gltexture;
+  precache_kind_t kind;
+  int cm;
+  const void *source;
+  int hires_size;
+  unsigned char *buffer;
+#ifdef HAVE_LIBSDL2_IMAGE
+  struct SDL_Surface *surface;
+#endif
+} precache_item_t;
+
+typedef struct
+{
+  precache_item_t items[PRECACHE_BATCH_ITEMS];
+  int count;
+  size_t bytes;
+  SDL_atomic_t next;
+  const char *text;
+  int hit;
+  int hitcount;
+} precache_batch_t;
+
+static precache_batch_t precache_batch;
+static dsda_thread_pool_t *precache_pool;
+static int precache_pool_request;
+
+static void gld_PrecacheProgress(void)
+{
+  gld_ProgressUpdate(precache_batch.text, ++precache_batch.hit, precache_batch.hitcount);
+}
+
+static void gld_PrecacheBind(precache_item_t *item)
+{
+  switch (item->kind)
+  {
+    case precache_flat:
+      gld_BindFlat(item->gltexture, 0);
+      break;
+    case precache_texture:
+      gld_BindTexture(item->gltexture, 0);
+      break;
+    case precache_patch:
+      gld_BindPatch(item->gltexture, item->cm);
+      break;
+  }
+}
+
+static void gld_PrecacheJob(int index, void *data)
+{
+  precache_batch_t *batch = data;
+  int i;
+
+  while ((i = SDL_AtomicAdd(&batch->next, 1)) < batch->count)
+  {
+    precache_item_t *item = &batch->items[i];
+    GLTexture *gltexture = item->gltexture;
+
+#ifdef HAVE_LIBSDL2_IMAGE
+    if (item->hires_size)
+    {
+      item->surface = gld_HiRes_DecodeLump(gltexture, item->source, item->hires_size);
+      continue;
+    }
+#endif
+
+    if (!item->buffer)
+      continue;
+
+    memset(item->buffer, 0, gltexture->buffer_size);
+
+    if (item->kind == precache_flat)
+    {
+      gld_AddRawToTexture(gltexture, item->buffer, item->source, 0);
+    }
+    else
+    {
+      gld_AddPatchToTexture(gltexture, item->buffer, item->source, 0, 0, item->cm, 0);
+
+      if (gltexture->flags & GLTEXTURE_HASHOLES)
+      {
+        SmoothEdges(item->buffer, gltexture->buffer_width, gltexture->buffer_height);
+      }
+    }
+  }
+}
+
+static void gld_PrecacheUpload(precache_item_t *item)
+{
+  GLTexture *gltexture = item->gltexture;
+
+#ifdef HAVE_LIBSDL2_IMAGE
+  if (item->surface)
+  {
+    gld_HiRes_UploadSurface(gltexture, item->surface);
+    item->surface = NULL;
+  }
+#endif
+
+  // Hires textures and anything that wasn't prepared take the usual path
+  if (!item->buffer)
+  {
+    gld_PrecacheBind(item);
+    return;
+  }
+
+  if (*gltexture->texid_p == 0)
+    glGenTextures(1, gltexture->texid_p);
+  glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+
+  gld_BuildTexture(gltexture, item->buffer, false, gltexture->buffer_width, gltexture->buffer_height);
+  item->buffer = NULL;
+
+  gld_SetTexClamp(gltexture, item->kind == precache_patch ? GLTEXTURE_CLAMPXY : 0);
+  last_glTexID = gltexture->texid_p;
+}
+
+static void gld_PrecacheFlush(void)
+{
+  int threads;
+  int i;
+
+  if (!precache_batch.count)
+    return;
+
+  threads = dsda_IntConfig(dsda_config_gl_precache_threads);
+
+  if (!precache_pool || precache_pool_request != threads)
+  {
+    if (precache_pool)
+      dsda_DestroyThreadPool(precache_pool);
+
+    precache_pool = dsda_CreateThreadPool("precache worker", threads);
+    precache_pool_request = threads;
+  }
+
+  SDL_AtomicSet(&precache_batch.next, 0);
+  dsda_RunThreadPool(precache_pool, gld_PrecacheJob, &precache_batch);
+
+  for (i = 0; i < precache_batch.count; i++)
+  {
+    gld_PrecacheProgress();
+    gld_PrecacheUpload(&precache_batch.items[i]);
+  }
+
+  precache_batch.count = 0;
+  precache_batch.bytes = 0;
+}
+
+static void gld_PrecacheBegin(const char *text, int hitcount)
+{
+  precache_batch.text = text;
+  precache_batch.hit = 0;
+  precache_batch.hitcount = hitcount;
+}
+
+static void gld_PrecacheItem(GLTexture *gltexture, precache_kind_t kind, int cm)
+{
+  static const int textypes[] = { GLDT_FLAT, GLDT_TEXTURE, GLDT_PATCH };
+  precache_item_t *item;
+  int i;
+
+  if (!gltexture)
+  {
+    gld_PrecacheProgress();
+    return;
+  }
+
+  // Sprite rotations often share a lump
+  for (i = 0; i < precache_batch.count; i++)
+    if (precache_batch.items[i].gltexture == gltexture)
+    {
+      gld_PrecacheProgress();
+      return;
+    }
+
+  if (
+    precache_batch.count == PRECACHE_BATCH_ITEMS ||
+    precache_batch.bytes + gltexture->buffer_size > PRECACHE_BATCH_BYTES
+  )
+    gld_PrecacheFlush();
+
+  item = &precache_batch.items[precache_batch.count++];
+  memset(item, 0, sizeof(*item));
+  item->gltexture = gltexture;
+  item->kind = kind;
+  item->cm = cm;
+
+  if (gltexture->textype != textypes[kind])
+    return;
+
+#ifdef HAVE_LIBSDL2_IMAGE
+  {
+    int lump = gld_HiRes_PrecacheLump(gltexture);
+
+    if (lump != LUMP_NOT_FOUND)
+    {
+      item->source = W_LumpByNum(lump);
+      item->hires_size = W_LumpLength(lump);
+
+      // Rough guess at the decoded size
+      precache_batch.bytes += 4 * item->hires_size;
+      return;
+    }
+
+    // A hires texture is already loaded
+    if (!V_IsWorldLightmodeIndexed() && !(gltexture->flags & GLTEXTURE_HASNOHIRES))
+      return;
+  }
+#endif
+
+  gld_GetTextureTexID(gltexture, cm);
+
+  if (*gltexture->texid_p != 0)
+    return;
+
+  // Lumps and composites are cached on first use, which isn't thread safe
+  switch (kind)
+  {
+    case precache_flat:
+      item->source = W_LumpByNum(gltexture->index);
+      break;
+    case precache_texture:
+      item->source = R_TextureCompositePatchByNum(gltexture->index);
+      break;
+    case precache_patch:
+      item->source = R_PatchByNum(gltexture->index);
+      break;
+  }
+
+  item->buffer = Z_Malloc(gltexture->buffer_size);
+  precache_batch.bytes += gltexture->buffer_size;
+}
+
 void gld_Precache(void)
 {
   int i;
@@ -1811,6 +2221,9 @@ void gld_Precache(void)
 
   gld_ProgressStart();
 
+  // The palette is also loaded on first use
+  V_GetPlaypal();
+
   {
     size_t size = numflats > num_sprites  ? numflats : num_sprites;
     hitlist = Z_Malloc((size_t)numtextures > size ? (size_t)numtextures : size);
@@ -1851,18 +2264,17 @@ void gld_Precache(void)
   }
 
   CalcHitsCount(hitlist, numflats, &hit, &hitcount);
+  gld_PrecacheBegin("Loading Flats...", hitcount);
 
   for (i = numflats; --i >= 0; )
     if (hitlist[i])
     {
-      gld_ProgressUpdate("Loading Flats...", ++hit, hitcount);
       gltexture = gld_RegisterFlat(i, true, indexed);
-      if (gltexture)
-      {
-        gld_BindFlat(gltexture, 0);
-      }
+      gld_PrecacheItem(gltexture, precache_flat, CR_DEFAULT);
     }
 
+  gld_PrecacheFlush();
+
   // Precache textures.
 
   memset(hitlist, 0, numtextures);
@@ -1948,18 +2360,17 @@ void gld_Precache(void)
   }
 
   CalcHitsCount(hitlist, numtextures, &hit, &hitcount);
+  gld_PrecacheBegin("Loading Textures...", hitcount);
 
   for (i = numtextures; --i >= 0; )
     if (hitlist[i])
     {
-      gld_ProgressUpdate("Loading Textures...", ++hit, hitcount);
       gltexture = gld_RegisterTexture(i, i != skytexture, false, indexed);
-      if (gltexture)
-      {
-        gld_BindTexture(gltexture, 0);
-      }
+      gld_PrecacheItem(gltexture, precache_texture, CR_DEFAULT);
     }
 
+  gld_PrecacheFlush();
+
   // Precache sprites.
   memset(hitlist, 0, num_sprites);
 
@@ -1981,6 +2392,8 @@ void gld_Precache(void)
       hitcount += 7 * sprites[i].numframes;
   }
 
+  gld_PrecacheBegin("Loading Sprites...", hitcount);
+
   for (i=num_sprites; --i >= 0;)
     if (hitlist[i])
       {
@@ -1991,16 +2404,15 @@ void gld_Precache(void)
             int k = 7;
             do
             {
-              gld_ProgressUpdate("Loading Sprites...", ++hit, hitcount);
               gltexture = gld_RegisterPatch(firstspritelump + sflump[k], CR_LIMIT, true, indexed);
-              if (gltexture)
-              {
-                gld_BindPatch(gltexture, CR_LIMIT);
-              }
+              gld_PrecacheItem(gltexture, precache_patch, CR_LIMIT);
             }
             while (--k >= 0);
           }
       }
+
+  gld_PrecacheFlush();
+
   Z_Free(hitlist);
 
   gld_ProgressEnd();
@@ -2025,6 +2437,7 @@ void gld_CleanMemory(void)
   gld_CleanTexItems(numtextures, &gld_GLIndexedTextures);
   gld_CleanTexItems(numlumps, &gld_GLIndexedPatchTextures);
   gld_CleanTexItems(numtextures * gld_numGLColormaps, &gld_GLIndexedSkyTextures);
+  gld_ResetSpriteAtlas();
   gl_preprocessed = false;
 }
 
@@ -538,7 +538,8 @@ void SetCrosshairTarget(void)
 
       if (V_IsSoftwareMode())
       {
-        winy += (float)(viewheight/2 - centery);
+        // centery is in view buffer pixels, which may be scaled down
+        winy += (float)(viewheight/2 - centery) * SCREENHEIGHT / render_screenheight;
       }
 
       top = SCREENHEIGHT;
@@ -547,7 +548,7 @@ void SetCrosshairTarget(void)
       {
         h = h * params->video->height / 200;
       }
-      bottom = top - viewheight + h;
+      bottom = top - screen_viewheight + h;
       winy = BETWEEN(bottom, top, winy);
 
       if (!hudadd_crosshair_scale)
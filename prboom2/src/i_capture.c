@@ -33,13 +33,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "i_sound.h"
 #include "i_video.h"
 #include "lprintf.h"
 #include "i_system.h"
 #include "i_capture.h"
+#include "z_zone.h"
+#include "v_video.h"
 
 #include "dsda/configuration.h"
+#include "dsda/segment_capture.h"
+#include "dsda/time.h"
 
 int capturing_video = 0;
 static const char *vid_fname;
@@ -47,6 +52,7 @@ static const char *vid_fname;
 typedef struct
 { // information on a running pipe
   char command[PATH_MAX];
+  const char *cwd; // working directory of the child, or NULL
   FILE *f_stdin;
   FILE *f_stdout;
   FILE *f_stderr;
@@ -61,10 +67,57 @@ static pipeinfo_t soundpipe;
 static pipeinfo_t videopipe;
 static pipeinfo_t muxpipe;
 
+// what to do when the encoder can't keep up
+typedef enum
+{
+  cap_queue_block, // wait for the writer (no frames lost)
+  cap_queue_drop,  // skip the frame entirely (keeps the game running)
+} cap_queue_policy_t;
+
+typedef struct
+{ // ring of buffers drained into a pipe by a dedicated writer thread
+  pipeinfo_t *pipe;
+  const char *name;
+  unsigned char **buffers;
+  size_t *sizes;
+  size_t *capacities;
+  int count;
+  int head;
+  int queued;
+  int done;
+  SDL_mutex *mutex;
+  SDL_cond *not_empty;
+  SDL_cond *not_full;
+  SDL_Thread *thread;
+
+  // statistics, reported at I_CaptureFinish
+  int frames;
+  int max_queued;
+  int stalls;
+  unsigned long long stall_time;
+  unsigned long long max_stall_time;
+  int write_errors;
+} capturequeue_t;
+
+static capturequeue_t soundqueue;
+static capturequeue_t videoqueue;
+static cap_queue_policy_t cap_queue_policy;
+static int dropped_frames;
+
+// indexed capture (see docs/capture_pal8_format.md)
+#define PAL8_HEADER_SIZE 20
+#define PAL8_PALETTE_SIZE (256 * 3)
+
+static int cap_pal8;
+static int pal8_header_sent;
+static int pal8_palette_generation;
+
 int cap_fps;
 int cap_frac;
 int cap_wipescreen;
 
+static int partsof35 = 0; // correct for sync when samplerate % 35 != 0
+
 // parses a command with simple printf-style replacements.
 
 // %w video width (px)
@@ -87,10 +140,10 @@ static int parsecommand (char *out, const char *in, int len)
       switch (in[1])
       {
         case 'w':
-          i = snprintf (out, len, "%u", renderW);
+          i = snprintf (out, len, "%u", cap_pal8 ? SCREENWIDTH : renderW);
           break;
         case 'h':
-          i = snprintf (out, len, "%u", renderH);
+          i = snprintf (out, len, "%u", cap_pal8 ? SCREENHEIGHT : renderH);
           break;
         case 's':
           i = snprintf (out, len, "%u", snd_samplerate);
@@ -221,7 +274,7 @@ static int my_popen3 (pipeinfo_t *p)
        TRUE,              // handles are inherited
        DETACHED_PROCESS,  // creation flags
        NULL,              // use parent's environment
-       NULL,              // use parent's current directory
+       p->cwd,            // NULL uses parent's current directory
        &siStartInfo,      // STARTUPINFO pointer
        &piProcInfo))      // receives PROCESS_INFORMATION
   {
@@ -372,6 +425,9 @@ static int my_popen3 (pipeinfo_t *p)
     close (parent_hout);
     close (parent_herr);
 
+    if (p->cwd && chdir (p->cwd))
+      _exit (1);
+
     // does this work? otherwise we have to parse cmd into an **argv style array
     execl ("/bin/sh", "sh", "-c", p->command, NULL);
     // exit forked process if command failed
@@ -446,11 +502,17 @@ typedef struct
 } threaddata_t;
 
 
+static void dumpstream (FILE *in, FILE *out)
+{
+  char block[4096];
+  size_t n;
+
+  while ((n = fread (block, 1, sizeof (block), in)) > 0)
+    fwrite (block, 1, n, out);
+}
+
 static int threadstdoutproc (void *data)
 { // simple thread proc dumps stdout
-  // not terribly fast
-  int c;
-
   pipeinfo_t *p = (pipeinfo_t *) data;
 
   FILE *f = fopen (p->stdoutdumpname, "w");
@@ -458,8 +520,7 @@ static int threadstdoutproc (void *data)
   if (!f || !p->f_stdout)
     return 0;
 
-  while ((c = fgetc (p->f_stdout)) != EOF)
-    fputc (c, f);
+  dumpstream (p->f_stdout, f);
 
   fclose (f);
   fclose (p->f_stdout);
@@ -468,9 +529,6 @@ static int threadstdoutproc (void *data)
 
 static int threadstderrproc (void *data)
 { // simple thread proc dumps stderr
-  // not terribly fast
-  int c;
-
   pipeinfo_t *p = (pipeinfo_t *) data;
 
   FILE *f = fopen (p->stderrdumpname, "w");
@@ -478,8 +536,7 @@ static int threadstderrproc (void *data)
   if (!f || !p->f_stderr)
     return 0;
 
-  while ((c = fgetc (p->f_stderr)) != EOF)
-    fputc (c, f);
+  dumpstream (p->f_stderr, f);
 
   fclose (f);
   fclose (p->f_stderr);
@@ -487,6 +544,233 @@ static int threadstderrproc (void *data)
 }
 
 
+// capture queues
+// the game thread copies each frame into the next free buffer of the ring,
+// and the writer thread pushes queued buffers into the pipe in order
+
+static int threadwriterproc (void *data)
+{
+  capturequeue_t *q = (capturequeue_t *) data;
+
+  SDL_LockMutex (q->mutex);
+
+  while (1)
+  {
+    int tail;
+
+    while (!q->queued && !q->done)
+      SDL_CondWait (q->not_empty, q->mutex);
+
+    if (!q->queued)
+      break;
+
+    tail = (q->head - q->queued + q->count) % q->count;
+
+    // the buffer stays queued until it's written, so it can't be reused early
+    SDL_UnlockMutex (q->mutex);
+    if (fwrite (q->buffers[tail], q->sizes[tail], 1, q->pipe->f_stdin) != 1)
+      q->write_errors++;
+    SDL_LockMutex (q->mutex);
+
+    q->queued--;
+    SDL_CondSignal (q->not_full);
+  }
+
+  SDL_UnlockMutex (q->mutex);
+
+  fflush (q->pipe->f_stdin);
+  return 1;
+}
+
+static void startqueue (capturequeue_t *q, pipeinfo_t *pipe, const char *name, int count)
+{
+  memset (q, 0, sizeof (*q));
+
+  q->pipe = pipe;
+  q->name = name;
+  q->count = count;
+  q->buffers = Z_Calloc (count, sizeof (*q->buffers));
+  q->sizes = Z_Calloc (count, sizeof (*q->sizes));
+  q->capacities = Z_Calloc (count, sizeof (*q->capacities));
+  q->mutex = SDL_CreateMutex ();
+  q->not_empty = SDL_CreateCond ();
+  q->not_full = SDL_CreateCond ();
+  q->thread = SDL_CreateThread (threadwriterproc, name, q);
+}
+
+static int queuefull (capturequeue_t *q)
+{
+  int full;
+
+  SDL_LockMutex (q->mutex);
+  full = (q->queued == q->count);
+  SDL_UnlockMutex (q->mutex);
+
+  return full;
+}
+
+// returns the next free buffer, waiting for the writer if the ring is full
+static unsigned char *reserveframe (capturequeue_t *q, size_t size)
+{
+  SDL_LockMutex (q->mutex);
+
+  if (q->queued == q->count)
+  {
+    unsigned long long start, stall;
+
+    start = dsda_TimeNS ();
+
+    while (q->queued == q->count)
+      SDL_CondWait (q->not_full, q->mutex);
+
+    stall = dsda_TimeNS () - start;
+    q->stalls++;
+    q->stall_time += stall;
+    if (stall > q->max_stall_time)
+      q->max_stall_time = stall;
+  }
+
+  SDL_UnlockMutex (q->mutex);
+
+  // the head buffer is not visible to the writer until it's queued
+  if (size > q->capacities[q->head])
+  {
+    q->buffers[q->head] = Z_Realloc (q->buffers[q->head], size);
+    q->capacities[q->head] = size;
+  }
+  q->sizes[q->head] = size;
+
+  return q->buffers[q->head];
+}
+
+// hands the reserved buffer to the writer
+static void commitframe (capturequeue_t *q)
+{
+  SDL_LockMutex (q->mutex);
+
+  q->head = (q->head + 1) % q->count;
+  q->queued++;
+  if (q->queued > q->max_queued)
+    q->max_queued = q->queued;
+  q->frames++;
+  SDL_CondSignal (q->not_empty);
+
+  SDL_UnlockMutex (q->mutex);
+}
+
+static void queueframe (capturequeue_t *q, const unsigned char *data, size_t size)
+{
+  memcpy (reserveframe (q, size), data, size);
+  commitframe (q);
+}
+
+static unsigned char *writeint (unsigned char *out, unsigned int value)
+{ // little endian
+  *out++ = value & 0xff;
+  *out++ = (value >> 8) & 0xff;
+  *out++ = (value >> 16) & 0xff;
+  *out++ = (value >> 24) & 0xff;
+  return out;
+}
+
+// queues the paletted screen, preceded by the stream header on the first
+// frame and by the palette whenever it has changed
+static void queuepal8frame (void)
+{
+  unsigned char palette[PAL8_PALETTE_SIZE];
+  unsigned char *out;
+  size_t size;
+  int generation;
+  int y;
+
+  generation = I_GrabPalette (palette);
+
+  size = 1 + SCREENWIDTH * SCREENHEIGHT;
+  if (!pal8_header_sent)
+    size += PAL8_HEADER_SIZE;
+  if (generation != pal8_palette_generation)
+    size += 1 + PAL8_PALETTE_SIZE;
+
+  out = reserveframe (&videoqueue, size);
+
+  if (!pal8_header_sent)
+  {
+    memcpy (out, "DSDAPAL8", 8);
+    out = writeint (out + 8, 1);
+    out = writeint (out, SCREENWIDTH);
+    out = writeint (out, SCREENHEIGHT);
+    pal8_header_sent = 1;
+  }
+
+  if (generation != pal8_palette_generation)
+  {
+    *out++ = 'P';
+    memcpy (out, palette, PAL8_PALETTE_SIZE);
+    out += PAL8_PALETTE_SIZE;
+    pal8_palette_generation = generation;
+  }
+
+  *out++ = 'F';
+  for (y = 0; y < SCREENHEIGHT; y++)
+  {
+    memcpy (out, screens[0].data + y * screens[0].pitch, SCREENWIDTH);
+    out += SCREENWIDTH;
+  }
+
+  commitframe (&videoqueue);
+}
+
+// waits for the queue to drain and releases it
+static void finishqueue (capturequeue_t *q)
+{
+  int i, s;
+
+  if (!q->thread)
+    return;
+
+  SDL_LockMutex (q->mutex);
+  q->done = 1;
+  SDL_CondSignal (q->not_empty);
+  SDL_UnlockMutex (q->mutex);
+
+  SDL_WaitThread (q->thread, &s);
+
+  lprintf (LO_INFO, "I_CaptureFinish: %s: %d frames, queue peak %d/%d, "
+           "%d stalls (%.1f ms total, %.1f ms max)\n",
+           q->name, q->frames, q->max_queued, q->count,
+           q->stalls, (double) q->stall_time / 1000000,
+           (double) q->max_stall_time / 1000000);
+
+  if (q->write_errors)
+    lprintf (LO_WARN, "I_CaptureFinish: %s: %d write errors\n", q->name, q->write_errors);
+
+  for (i = 0; i < q->count; i++)
+    Z_Free (q->buffers[i]);
+  Z_Free (q->buffers);
+  Z_Free (q->sizes);
+  Z_Free (q->capacities);
+  SDL_DestroyCond (q->not_empty);
+  SDL_DestroyCond (q->not_full);
+  SDL_DestroyMutex (q->mutex);
+
+  q->thread = NULL;
+}
+
+
+// files the game writes itself go where the pipes run
+static const char *capturepath (const char *name)
+{
+  const char *dir = dsda_SegmentCaptureDir ();
+  char *path;
+
+  if (!dir)
+    return name;
+
+  path = Z_Malloc (strlen (dir) + strlen (name) + 2);
+  sprintf (path, "%s/%s", dir, name);
+  return path;
+}
+
 // init and open sound, video pipes
 // fn is filename passed from command line, typically final output file
 void I_CapturePrep (const char *fn)
@@ -501,8 +785,26 @@ void I_CapturePrep (const char *fn)
   cap_wipescreen = dsda_IntConfig(dsda_config_cap_wipescreen);
   cap_fps = dsda_IntConfig(dsda_config_cap_fps);
 
+  // indexed capture needs the software renderer's 8-bit screen
+  cap_pal8 = dsda_IntConfig(dsda_config_cap_pal8);
+  if (cap_pal8 && V_IsOpenGLMode())
+  {
+    lprintf (LO_WARN, "I_CapturePrep: cap_pal8 is not supported in opengl, using rgb24\n");
+    cap_pal8 = 0;
+  }
+  if (cap_pal8)
+  {
+    cap_videocommand = dsda_StringConfig(dsda_config_cap_videocommand_pal8);
+    pal8_header_sent = 0;
+    pal8_palette_generation = -1;
+  }
+
   vid_fname = fn;
 
+  soundpipe.cwd = dsda_SegmentCaptureDir ();
+  videopipe.cwd = soundpipe.cwd;
+  muxpipe.cwd = soundpipe.cwd;
+
   if (!parsecommand (soundpipe.command, cap_soundcommand, sizeof(soundpipe.command)))
   {
     lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_soundcommand);
@@ -541,13 +843,19 @@ void I_CapturePrep (const char *fn)
   lprintf (LO_INFO, "I_CapturePrep: video capture started\n");
   capturing_video = 1;
 
+  // start writer threads
+  cap_queue_policy = dsda_IntConfig(dsda_config_cap_queue_policy);
+  dropped_frames = 0;
+  startqueue (&soundqueue, &soundpipe, "soundpipe.writer", dsda_IntConfig(dsda_config_cap_queue_frames));
+  startqueue (&videoqueue, &videopipe, "videopipe.writer", dsda_IntConfig(dsda_config_cap_queue_frames));
+
   // start reader threads
-  soundpipe.stdoutdumpname = "sound_stdout.txt";
-  soundpipe.stderrdumpname = "sound_stderr.txt";
+  soundpipe.stdoutdumpname = capturepath ("sound_stdout.txt");
+  soundpipe.stderrdumpname = capturepath ("sound_stderr.txt");
   soundpipe.outthread = SDL_CreateThread (threadstdoutproc, "soundpipe.outthread", &soundpipe);
   soundpipe.errthread = SDL_CreateThread (threadstderrproc, "soundpipe.errthread", &soundpipe);
-  videopipe.stdoutdumpname = "video_stdout.txt";
-  videopipe.stderrdumpname = "video_stderr.txt";
+  videopipe.stdoutdumpname = capturepath ("video_stdout.txt");
+  videopipe.stderrdumpname = capturepath ("video_stderr.txt");
   videopipe.outthread = SDL_CreateThread (threadstdoutproc, "videopipe.outthread", &videopipe);
   videopipe.errthread = SDL_CreateThread (threadstderrproc, "videopipe.errthread", &videopipe);
 
@@ -559,42 +867,88 @@ void I_CapturePrep (const char *fn)
 // capture a single frame of video (and corresponding audio length)
 // and send it to pipes
 // Modified to work with SDL2 resizeable window and fullscreen desktop - DTIED
+static int framesamples (void)
+{
+  int nsampreq;
+
+  nsampreq = snd_samplerate / cap_fps;
+  partsof35 += snd_samplerate % cap_fps;
+  if (partsof35 >= cap_fps)
+  {
+    partsof35 -= cap_fps;
+    nsampreq++;
+  }
+
+  return nsampreq;
+}
+
 void I_CaptureFrame (void)
 {
   unsigned char *snd;
   unsigned char *vid;
-  static int partsof35 = 0; // correct for sync when samplerate % 35 != 0
   int nsampreq;
 
   if (!capturing_video)
     return;
 
-  nsampreq = snd_samplerate / cap_fps;
-  partsof35 += snd_samplerate % cap_fps;
-  if (partsof35 >= cap_fps)
+  // before a segment starts, only keep the mixer running
+  // so that sounds already playing carry over into it
+  if (dsda_SegmentCapturePreRoll ())
   {
-    partsof35 -= cap_fps;
-    nsampreq++;
+    I_GrabSound (framesamples ());
+    return;
+  }
+
+  // drop audio and video together so the streams stay in sync
+  if (cap_queue_policy == cap_queue_drop &&
+      (queuefull (&soundqueue) || queuefull (&videoqueue)))
+  {
+    dropped_frames++;
+    return;
   }
 
+  nsampreq = framesamples ();
+
   snd = I_GrabSound (nsampreq);
   if (snd)
   {
-    if (fwrite (snd, nsampreq * 4, 1, soundpipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing soundpipe.\n");
+    queueframe (&soundqueue, snd, nsampreq * 4);
     //Z_Free (snd); // static buffer
   }
+  if (cap_pal8)
+  {
+    queuepal8frame ();
+    return;
+  }
   vid = I_GrabScreen ();
   if (vid)
   {
-    if (fwrite (vid, renderW * renderH * 3, 1, videopipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing videopipe.\n");
+    queueframe (&videoqueue, vid, renderW * renderH * 3);
     //Z_Free (vid); // static buffer
   }
 
 }
 
 
+// advance the frame timing over tics that were jumped over
+// (mirrors the capture loop in D_DoomLoop)
+void I_CaptureSkipTics (int tics)
+{
+  int cap_step = TICRATE * FRACUNIT / cap_fps;
+
+  while (tics-- > 0)
+  {
+    cap_frac += cap_step;
+    while (cap_frac <= FRACUNIT)
+    {
+      framesamples ();
+      cap_frac += cap_step;
+    }
+    cap_frac -= FRACUNIT + cap_step;
+  }
+}
+
+
 // close pipes, call muxcommand, finalize
 void I_CaptureFinish (void)
 {
@@ -609,14 +963,19 @@ void I_CaptureFinish (void)
   // is there a better way to do this?
 
   // (on windows, it doesn't matter what order we do it in)
+  finishqueue (&videoqueue);
   my_pclose3 (&videopipe);
   SDL_WaitThread (videopipe.outthread, &s);
   SDL_WaitThread (videopipe.errthread, &s);
 
+  finishqueue (&soundqueue);
   my_pclose3 (&soundpipe);
   SDL_WaitThread (soundpipe.outthread, &s);
   SDL_WaitThread (soundpipe.errthread, &s);
 
+  if (dropped_frames)
+    lprintf (LO_WARN, "I_CaptureFinish: dropped %d frames\n", dropped_frames);
+
   // muxing and temp file cleanup
 
   lprintf (LO_INFO, "I_CaptureFinish: opening pipe \"%s\"\n", muxpipe.command);
@@ -627,8 +986,8 @@ void I_CaptureFinish (void)
     return;
   }
 
-  muxpipe.stdoutdumpname = "mux_stdout.txt";
-  muxpipe.stderrdumpname = "mux_stderr.txt";
+  muxpipe.stdoutdumpname = capturepath ("mux_stdout.txt");
+  muxpipe.stderrdumpname = capturepath ("mux_stderr.txt");
   muxpipe.outthread = SDL_CreateThread (threadstdoutproc, "muxpipe.outthread", &muxpipe);
   muxpipe.errthread = SDL_CreateThread (threadstderrproc, "muxpipe.errthread", &muxpipe);
 
@@ -646,7 +1005,7 @@ void I_CaptureFinish (void)
     cap_tempfile1 = dsda_StringConfig(dsda_config_cap_tempfile1);
     cap_tempfile2 = dsda_StringConfig(dsda_config_cap_tempfile2);
 
-    remove (cap_tempfile1);
-    remove (cap_tempfile2);
+    remove (capturepath (cap_tempfile1));
+    remove (capturepath (cap_tempfile2));
   }
 }
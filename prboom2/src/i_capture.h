@@ -46,6 +46,9 @@ void I_CapturePrep (const char *fn);
 // and send it to pipes
 void I_CaptureFrame (void);
 
+// advance the frame timing over tics that were jumped over
+void I_CaptureSkipTics (int tics);
+
 // close pipes, call muxcommand, finalize
 void I_CaptureFinish (void);
 
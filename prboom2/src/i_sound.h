@@ -80,6 +80,39 @@ dboolean I_AnySoundStillPlaying(void);
 //  and pitch of a sound channel.
 void I_UpdateSoundParams(int handle, sfx_params_t *params);
 
+// Sound commands waiting for the mixer, the most seen at once,
+//  and how many were lost because the queue was full
+typedef struct
+{
+  int depth;
+  int peak;
+  int dropped;
+} sound_queue_stats_t;
+
+void I_GetSoundQueueStats(sound_queue_stats_t *stats);
+
+// Audio callback timings over the last few callbacks, in ms.
+// An underrun is a callback that came more than half a slice late.
+typedef struct
+{
+  int callbacks;
+  float slice_ms;
+  float mix_ms;
+  float mix_ms_max;
+  float spacing_ms;
+  float spacing_ms_max;
+  float music_ms;
+  float music_ms_max;
+  int channels;
+  int channels_max;
+  int underruns;
+} sound_callback_stats_t;
+
+void I_GetSoundCallbackStats(sound_callback_stats_t *stats);
+
+// Decodes the sounds ahead of time, in the background
+void I_PrecacheSounds(const int *sfx_ids, int count);
+
 // NSM sound capture routines
 // silences sound output, and instead allows sound capture to work
 // call this before sound startup
@@ -111,6 +144,9 @@ int I_RegisterSong(const void *data, size_t len);
 // Horrible thing to do, considering.
 void I_PlaySong(int handle, int looping);
 
+// Moves a playing song to a position in ms from its start.
+void I_SeekSong(int handle, int position);
+
 // Stops a song over 3 seconds.
 void I_StopSong(int handle);
 
@@ -68,9 +68,15 @@ void I_SetPalette(int pal); /* CPhipps - pass down palette number */
 
 void I_FinishUpdate (void);
 
+// true when rendering without a window (-offscreen)
+dboolean I_Offscreen (void);
+
 int I_ScreenShot (const char *fname);
 // NSM expose lower level screen data grab for vidcap
 unsigned char *I_GrabScreen (void);
+// current palette as 256 RGB triplets for indexed vidcap
+// returns a counter that changes whenever the palette does
+int I_GrabPalette (unsigned char *rgb);
 
 /* I_StartTic
  * Called by D_DoomLoop,
@@ -204,6 +204,10 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_full_sounds),
   MIGRATED_SETTING(dsda_config_snd_samplerate),
   MIGRATED_SETTING(dsda_config_snd_samplecount),
+  MIGRATED_SETTING(dsda_config_snd_reference_mixer),
+  MIGRATED_SETTING(dsda_config_snd_music_lookahead),
+  MIGRATED_SETTING(dsda_config_snd_music_resampler),
+  MIGRATED_SETTING(dsda_config_snd_cache_size),
   MIGRATED_SETTING(dsda_config_sfx_volume),
   MIGRATED_SETTING(dsda_config_music_volume),
   MIGRATED_SETTING(dsda_config_mus_pause_opt),
@@ -247,6 +251,12 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_render_patches_scalex),
   MIGRATED_SETTING(dsda_config_render_patches_scaley),
   MIGRATED_SETTING(dsda_config_render_stretchsky),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_fps),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_min),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_max),
+  MIGRATED_SETTING(dsda_config_render_plane_threads),
+  MIGRATED_SETTING(dsda_config_render_patch_cache),
   MIGRATED_SETTING(dsda_config_freelook),
 
   SETTING_HEADING("OpenGL settings"),
@@ -259,6 +269,9 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_gl_skymode),
   MIGRATED_SETTING(dsda_config_gl_usegamma),
   MIGRATED_SETTING(dsda_config_gl_health_bar),
+  MIGRATED_SETTING(dsda_config_gl_precache_threads),
+  MIGRATED_SETTING(dsda_config_gl_level_cache),
+  MIGRATED_SETTING(dsda_config_gl_sprite_batching),
 
   SETTING_HEADING("Mouse settings"),
   MIGRATED_SETTING(dsda_config_use_mouse),
@@ -403,12 +416,17 @@ cfg_def_t cfg_defs[] =
   SETTING_HEADING("Video capture encoding settings"),
   MIGRATED_SETTING(dsda_config_cap_soundcommand),
   MIGRATED_SETTING(dsda_config_cap_videocommand),
+  MIGRATED_SETTING(dsda_config_cap_videocommand_pal8),
   MIGRATED_SETTING(dsda_config_cap_muxcommand),
   MIGRATED_SETTING(dsda_config_cap_tempfile1),
   MIGRATED_SETTING(dsda_config_cap_tempfile2),
   MIGRATED_SETTING(dsda_config_cap_remove_tempfiles),
   MIGRATED_SETTING(dsda_config_cap_wipescreen),
   MIGRATED_SETTING(dsda_config_cap_fps),
+  MIGRATED_SETTING(dsda_config_cap_queue_frames),
+  MIGRATED_SETTING(dsda_config_cap_queue_policy),
+  MIGRATED_SETTING(dsda_config_cap_pal8),
+  MIGRATED_SETTING(dsda_config_cap_concatcommand),
 
   SETTING_HEADING("Overrun settings"),
   MIGRATED_SETTING(dsda_config_overrun_spechit_warn),
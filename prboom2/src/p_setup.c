@@ -3956,6 +3956,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   // preload graphics
   R_PrecacheLevel();
 
+  // preload sounds
+  S_PrecacheLevel();
+
   if (V_IsOpenGLMode())
   {
     // e6y
@@ -60,6 +60,15 @@ byte *viewimage;
 int  viewwidth;
 int  viewheight;
 
+// Size of the software view buffer and the height of the view on screen.
+// These differ from SCREENWIDTH / viewheight when dynamic resolution is on.
+int  render_screenwidth = 320;
+int  render_screenheight = 200;
+int  screen_viewheight;
+
+// Separate buffer for the view when it is rendered below native resolution
+static byte *view_buffer;
+
 // Color tables for different players,
 //  translate a limited part to another
 //  (color ramps used for  suit colors).
@@ -136,12 +145,12 @@ draw_vars_t drawvars = {
 
 dboolean R_FullView(void)
 {
-  return viewheight == SCREENHEIGHT;
+  return screen_viewheight == SCREENHEIGHT;
 }
 
 dboolean R_PartialView(void)
 {
-  return viewheight != SCREENHEIGHT;
+  return screen_viewheight != SCREENHEIGHT;
 }
 
 dboolean R_StatusBarVisible(void)
@@ -477,11 +486,60 @@ void R_InitBuffer(int width, int height)
 {
   int i;
 
-  drawvars.topleft = screens[0].data;
-  drawvars.pitch = screens[0].pitch;
+  if (view_buffer)
+  {
+    Z_Free(view_buffer);
+    view_buffer = NULL;
+  }
+
+  if (width != SCREENWIDTH || height != SCREENHEIGHT)
+  {
+    view_buffer = Z_Malloc(width * height);
+
+    drawvars.topleft = view_buffer;
+    drawvars.pitch = width;
+  }
+  else
+  {
+    drawvars.topleft = screens[0].data;
+    drawvars.pitch = screens[0].pitch;
+  }
 
   for (i=0; i<FUZZTABLE; i++)
-    fuzzoffset[i] = fuzzoffset_org[i]*screens[0].pitch;
+    fuzzoffset[i] = fuzzoffset_org[i]*drawvars.pitch;
+}
+
+//
+// R_FillViewWindow
+// Fills the view window with a solid color
+//
+
+void R_FillViewWindow(byte color)
+{
+  int y;
+
+  if (!view_buffer)
+  {
+    V_FillRect(0, 0, 0, viewwidth, viewheight, color);
+    return;
+  }
+
+  for (y = 0; y < viewheight; y++)
+    memset(view_buffer + y * drawvars.pitch, color, viewwidth);
+}
+
+//
+// R_FlushViewBuffer
+// Scales a reduced resolution view up to the screen
+//
+
+void R_FlushViewBuffer(void)
+{
+  if (!view_buffer)
+    return;
+
+  dsda_StretchViewBuffer(view_buffer, drawvars.pitch, viewwidth, viewheight,
+                         SCREENWIDTH, screen_viewheight);
 }
 
 //
@@ -127,6 +127,8 @@ R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type, enum draw_filter
 void R_DrawSpan(draw_span_vars_t *dsvars);
 
 void R_InitBuffer(int width, int height);
+void R_FillViewWindow(byte color);
+void R_FlushViewBuffer(void);
 
 void R_InitBuffersRes(void);
 
@@ -62,6 +62,7 @@
 #include "xs_Float.h"
 
 #include "dsda/configuration.h"
+#include "dsda/dynamic_resolution.h"
 #include "dsda/exhud.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
@@ -503,8 +504,8 @@ int R_Project(float objx, float objy, float objz, float *winx, float *winy, floa
 void R_SetupViewport(void)
 {
   viewport[0] = 0;
-  viewport[1] = (SCREENHEIGHT - viewheight) / 2;
-  viewport[2] = viewwidth;
+  viewport[1] = (SCREENHEIGHT - screen_viewheight) / 2;
+  viewport[2] = SCREENWIDTH;
   viewport[3] = SCREENHEIGHT;
 }
 
@@ -583,31 +584,39 @@ void R_BuildModelViewMatrix(void)
 }
 
 //
-// R_ExecuteSetViewSize
+// R_ExecuteSetViewScale
+// Sets up the view geometry for the current internal resolution.
+// Called directly when only the dynamic resolution scale changes.
 //
 
-void R_ExecuteSetViewSize (void)
+void R_ExecuteSetViewScale(void)
 {
   int i;
   int cheight;
-
-  setsizeneeded = false;
+  int scale;
 
   SetRatio(SCREENWIDTH, SCREENHEIGHT);
 
+  scale = dsda_DynamicResolutionScale();
+
+  render_screenwidth = SCREENWIDTH * scale / 100;
+  render_screenheight = SCREENHEIGHT * scale / 100;
+
   if (setblocks == 11)
   {
-    viewheight = SCREENHEIGHT;
+    screen_viewheight = SCREENHEIGHT;
+    viewheight = render_screenheight;
     freelookviewheight = viewheight;
   }
   // proff 09/24/98: Added for high-res
   else
   {
-    viewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
-    freelookviewheight = SCREENHEIGHT;
+    screen_viewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
+    viewheight = screen_viewheight * scale / 100;
+    freelookviewheight = render_screenheight;
   }
 
-  viewwidth = SCREENWIDTH;
+  viewwidth = render_screenwidth;
 
   viewheightfrac = viewheight<<FRACBITS;//e6y
 
@@ -619,12 +628,12 @@ void R_ExecuteSetViewSize (void)
   if (tallscreen)
   {
     wide_centerx = centerx;
-    cheight = SCREENHEIGHT * ratio_multiplier / ratio_scale;
+    cheight = render_screenheight * ratio_multiplier / ratio_scale;
   }
   else
   {
     wide_centerx = centerx * ratio_multiplier / ratio_scale;
-    cheight = SCREENHEIGHT;
+    cheight = render_screenheight;
   }
 
   // e6y: wide-res
@@ -632,13 +641,11 @@ void R_ExecuteSetViewSize (void)
 
 // proff 11/06/98: Added for high-res
   // calculate projectiony using int64_t math to avoid overflow when SCREENWIDTH>4228
-  projectiony = (fixed_t)((((int64_t)cheight * centerx * 320) / 200) / SCREENWIDTH * FRACUNIT);
+  projectiony = (fixed_t)((((int64_t)cheight * centerx * 320) / 200) / render_screenwidth * FRACUNIT);
   // e6y: this is a precalculated value for more precise flats drawing (see R_MapPlane)
   viewfocratio = projectiony / wide_centerx;
 
-  dsda_SetupStretchParams();
-
-  R_InitBuffer (SCREENWIDTH, viewheight);
+  R_InitBuffer (render_screenwidth, render_screenheight);
 
   R_InitTextureMapping();
 
@@ -660,7 +667,7 @@ void R_ExecuteSetViewSize (void)
   pspritexscale_f = (float)wide_centerx/160.0f;
   pspriteyscale_f = (float)cheight / 200.0f;
 
-  skyiscale = (200 << FRACBITS) / SCREENHEIGHT;
+  skyiscale = (200 << FRACBITS) / render_screenheight;
 
 	// [RH] Sky height fix for screens not 200 (or 240) pixels tall
 	R_InitSkyMap();
@@ -700,6 +707,19 @@ void R_ExecuteSetViewSize (void)
         c_scalelight[t][i][j] = colormaps[t] + level;
     }
   }
+}
+
+//
+// R_ExecuteSetViewSize
+//
+
+void R_ExecuteSetViewSize (void)
+{
+  setsizeneeded = false;
+
+  R_ExecuteSetViewScale();
+
+  dsda_SetupStretchParams();
 
   if (V_IsOpenGLMode())
     dsda_GLSetRenderViewportParams();
@@ -904,7 +924,7 @@ static void R_InitDrawScene(void)
     if (dsda_IntConfig(dsda_config_flashing_hom))
     { // killough 2/10/98: add flashing red HOM indicators
       unsigned char color=(gametic % 20) < 9 ? 0xb0 : 0;
-      V_FillRect(0, 0, 0, viewwidth, viewheight, color);
+      R_FillViewWindow(color);
       R_DrawViewBorder();
     }
 
@@ -945,6 +965,7 @@ void R_RenderPlayerView (player_t* player)
 {
   r_frame_count++;
 
+  DSDA_START_RENDER_STAGE(dsda_render_stage_setup);
   DSDA_ADD_CONTEXT(sf_setup_frame);
   R_SetupFrame (player);
   DSDA_REMOVE_CONTEXT(sf_setup_frame);
@@ -968,17 +989,23 @@ void R_RenderPlayerView (player_t* player)
     DSDA_REMOVE_CONTEXT(sf_gl_frustum);
   }
 
+  DSDA_END_RENDER_STAGE(dsda_render_stage_setup);
+
+  DSDA_START_RENDER_STAGE(dsda_render_stage_bsp_nodes);
   DSDA_ADD_CONTEXT(sf_bsp_nodes);
   R_RenderBSPNodes();
   DSDA_REMOVE_CONTEXT(sf_bsp_nodes);
+  DSDA_END_RENDER_STAGE(dsda_render_stage_bsp_nodes);
 
   FakeNetUpdate();
 
   if (V_IsSoftwareMode())
   {
+    DSDA_START_RENDER_STAGE(dsda_render_stage_draw_planes);
     DSDA_ADD_CONTEXT(sf_draw_planes);
     R_DrawPlanes();
     DSDA_REMOVE_CONTEXT(sf_draw_planes);
+    DSDA_END_RENDER_STAGE(dsda_render_stage_draw_planes);
   }
 
   DSDA_ADD_CONTEXT(sf_reset_column_buffer);
@@ -988,18 +1015,24 @@ void R_RenderPlayerView (player_t* player)
   FakeNetUpdate();
 
   if (V_IsSoftwareMode()) {
+    DSDA_START_RENDER_STAGE(dsda_render_stage_draw_masked);
     DSDA_ADD_CONTEXT(sf_draw_masked);
     R_DrawMasked ();
     R_ResetColumnBuffer();
     DSDA_REMOVE_CONTEXT(sf_draw_masked);
+
+    R_FlushViewBuffer();
+    DSDA_END_RENDER_STAGE(dsda_render_stage_draw_masked);
   }
 
   FakeNetUpdate();
 
   if (V_IsOpenGLMode() && !automap_on) {
+    DSDA_START_RENDER_STAGE(dsda_render_stage_draw_scene);
     DSDA_ADD_CONTEXT(sf_draw_scene);
     gld_DrawScene(player);
     gld_EndDrawScene();
     DSDA_REMOVE_CONTEXT(sf_draw_scene);
+    DSDA_END_RENDER_STAGE(dsda_render_stage_draw_scene);
   }
 }
@@ -53,6 +53,9 @@ extern fixed_t  viewtancos;
 extern fixed_t  viewtansin;
 extern int      viewwidth;
 extern int      viewheight;
+extern int      render_screenwidth;
+extern int      render_screenheight;
+extern int      screen_viewheight;
 extern int      centerx;
 extern int      centery;
 extern fixed_t  globaluclip;
@@ -147,6 +150,7 @@ void R_RenderPlayerView(player_t *player);   // Called by G_Drawer.
 void R_Init(void);                           // Called by startup code.
 void R_SetViewSize(void);              // Called by M_Responder.
 void R_ExecuteSetViewSize(void);             // cph - called by D_Display to complete a view resize
+void R_ExecuteSetViewScale(void);
 dboolean R_FullView(void);
 dboolean R_PartialView(void);
 dboolean R_StatusBarVisible(void);
@@ -71,9 +71,11 @@
 #include "lprintf.h"
 #include "r_patch.h"
 #include "v_video.h"
+#include "md5.h"
 #include <assert.h>
 
 #include "dsda/palette.h"
+#include "dsda/patch_cache.h"
 
 // posts are runs of non masked source pixels
 typedef struct
@@ -156,7 +158,7 @@ void R_FlushAllPatches(void) {
   if (texture_composites)
   {
     for (i=0; i<numtextures; i++)
-      if (texture_composites[i].data)
+      if (texture_composites[i].data && !dsda_IsCachedPatchData(texture_composites[i].data))
         Z_Free(texture_composites[i].data);
     Z_Free(texture_composites);
     texture_composites = NULL;
@@ -377,6 +379,58 @@ static void StorePixel(rpatch_t *patch, int x, int y, byte color)
   patch->pixels[x * patch->height + y] = color;
 }
 
+//---------------------------------------------------------------------------
+// The cache key covers the lump contents and everything else the
+// conversion depends on
+//---------------------------------------------------------------------------
+static void getPatchCacheKey(int id, byte *key) {
+  struct MD5Context md5;
+  byte cksum[DSDA_PATCH_CACHE_KEY_LENGTH];
+  int params[4];
+
+  params[0] = 0; // patch
+  params[1] = playpal_transparent;
+  params[2] = playpal_duplicate;
+  params[3] = V_IsOpenGLMode() && !strncasecmp(lumpinfo[id].name, "M_THERMM", 8);
+
+  dsda_PatchLumpCheckSum(id, cksum);
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const byte *)params, sizeof(params));
+  MD5Update(&md5, cksum, sizeof(cksum));
+  MD5Final(key, &md5);
+}
+
+static void getTextureCompositeCacheKey(int id, byte *key) {
+  struct MD5Context md5;
+  byte cksum[DSDA_PATCH_CACHE_KEY_LENGTH];
+  const texture_t *texture = textures[id];
+  int params[7];
+  int i;
+
+  params[0] = 1; // composite
+  params[1] = playpal_transparent;
+  params[2] = playpal_duplicate;
+  params[3] = texture->width;
+  params[4] = texture->height;
+  params[5] = texture->widthmask;
+  params[6] = texture->patchcount;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const byte *)params, sizeof(params));
+
+  for (i=0; i<texture->patchcount; i++) {
+    const texpatch_t *texpatch = &texture->patches[i];
+
+    dsda_PatchLumpCheckSum(texpatch->patch, cksum);
+    MD5Update(&md5, (const byte *)&texpatch->originx, sizeof(texpatch->originx));
+    MD5Update(&md5, (const byte *)&texpatch->originy, sizeof(texpatch->originy));
+    MD5Update(&md5, cksum, sizeof(cksum));
+  }
+
+  MD5Final(key, &md5);
+}
+
 //---------------------------------------------------------------------------
 static void createPatch(int id) {
   rpatch_t *patch;
@@ -393,6 +447,7 @@ static void createPatch(int id) {
   const unsigned char *oldColumnPixelData;
   int numPostsUsedSoFar;
   int edgeSlope;
+  byte cacheKey[DSDA_PATCH_CACHE_KEY_LENGTH];
 
 #ifdef RANGECHECK
   if (id >= numlumps)
@@ -405,6 +460,13 @@ static void createPatch(int id) {
       (patchNum < numlumps ? lumpinfo[patchNum].name : NULL));
   }
 
+  if (dsda_PatchCacheEnabled())
+  {
+    getPatchCacheKey(id, cacheKey);
+    if (dsda_LoadCachedPatch(cacheKey, &patches[id]))
+      return;
+  }
+
   oldPatch = (const patch_t*)W_LumpByNum(patchNum);
 
   patch = &patches[id];
@@ -541,6 +603,9 @@ static void createPatch(int id) {
 
   FillEmptySpace(patch);
 
+  if (dsda_PatchCacheEnabled())
+    dsda_StoreCachedPatch(cacheKey, patch);
+
   Z_Free(numPostsInColumn);
 }
 
@@ -600,6 +665,7 @@ static void createTextureCompositePatch(int id) {
   int numPostsUsedSoFar;
   int edgeSlope;
   count_t *countsInColumn;
+  byte cacheKey[DSDA_PATCH_CACHE_KEY_LENGTH];
 
 #ifdef RANGECHECK
   if (id >= numtextures)
@@ -608,6 +674,13 @@ static void createTextureCompositePatch(int id) {
 
   composite_patch = &texture_composites[id];
 
+  if (dsda_PatchCacheEnabled())
+  {
+    getTextureCompositeCacheKey(id, cacheKey);
+    if (dsda_LoadCachedPatch(cacheKey, composite_patch))
+      return;
+  }
+
   texture = textures[id];
 
   composite_patch->width = texture->width;
@@ -823,6 +896,9 @@ static void createTextureCompositePatch(int id) {
 
   FillEmptySpace(composite_patch);
 
+  if (dsda_PatchCacheEnabled())
+    dsda_StoreCachedPatch(cacheKey, composite_patch);
+
   Z_Free(countsInColumn);
 }
 
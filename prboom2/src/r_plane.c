@@ -61,8 +61,11 @@
 #include "v_video.h"
 #include "lprintf.h"
 
+#include "dsda/configuration.h"
 #include "dsda/map_format.h"
 #include "dsda/render_stats.h"
+#include "dsda/thread_pool.h"
+#include "dsda/time.h"
 
 int Sky1Texture;
 int Sky2Texture;
@@ -99,6 +102,7 @@ int *ceilingclip = NULL;
 
 // e6y: resolution limitation is removed
 static int *spanstart = NULL;                // killough 2/8/98
+static int *plane_spanstart[DSDA_MAX_PLANE_WORKERS];
 
 //
 // texture mapping
@@ -114,10 +118,19 @@ fixed_t *distscale = NULL;
 
 void R_InitPlanesRes(void)
 {
+  int i;
+
   if (floorclip) Z_Free(floorclip);
   if (ceilingclip) Z_Free(ceilingclip);
   if (spanstart) Z_Free(spanstart);
 
+  for (i = 0; i < DSDA_MAX_PLANE_WORKERS; i++)
+    if (plane_spanstart[i])
+    {
+      Z_Free(plane_spanstart[i]);
+      plane_spanstart[i] = NULL;
+    }
+
   if (cachedheight) Z_Free(cachedheight);
 
   if (yslope) Z_Free(yslope);
@@ -377,7 +390,7 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop)
 
 static void R_MakeSpans(int x, unsigned int t1, unsigned int b1,
                         unsigned int t2, unsigned int b2,
-                        draw_span_vars_t *dsvars)
+                        draw_span_vars_t *dsvars, int *spanstart)
 {
   for (; t1 < t2 && t1 <= b1; t1++)
     R_MapPlane(t1, spanstart[t1], x-1, dsvars);
@@ -389,16 +402,41 @@ static void R_MakeSpans(int x, unsigned int t1, unsigned int b1,
     spanstart[b2--] = x;
 }
 
+//
+// Plane jobs
+//
+// Everything that touches shared state (lump and composite caches,
+// the visplane sentinels) is set up on the main thread. Drawing a job
+// only writes pixels in the rows it is given, so the view can be split
+// into bands that are drawn in parallel with identical results.
+//
+
+typedef struct {
+  visplane_t *pl;
+  int top, bottom; // rows touched by the plane
+  dboolean sky;
+
+  // sky flat
+  draw_column_vars_t dcvars;
+  const rpatch_t *tex_patch;
+  angle_t an, flip;
+
+  // regular flat
+  draw_span_vars_t dsvars;
+} plane_job_t;
+
 // New function, by Lee Killough
 
-static void R_DoDrawPlane(visplane_t *pl)
+static void R_SetupPlaneJob(visplane_t *pl, plane_job_t *job, dboolean find_rows)
 {
-  register int x;
   draw_column_vars_t dcvars;
-  R_DrawColumn_f colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, RDRAW_FILTER_POINT);
 
   R_SetDefaultDrawColumnVars(&dcvars);
 
+  job->pl = pl;
+  job->top = 0;
+  job->bottom = viewheight - 1;
+
   if (pl->minx <= pl->maxx) {
     // hexen_note: Skies
     // if (pl->picnum == skyflatnum)
@@ -569,15 +607,11 @@ static void R_DoDrawPlane(visplane_t *pl)
 
       tex_patch = R_TextureCompositePatchByNum(texture);
 
-      // killough 10/98: Use sky scrolling offset, and possibly flip picture
-      for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
-        if ((dcvars.yl = pl->top[x]) != SHRT_MAX && dcvars.yl <= (dcvars.yh = pl->bottom[x])) // dropoff overflow
-        {
-          dcvars.source = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT);
-          dcvars.prevsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x-1])^flip) >> ANGLETOSKYSHIFT);
-          dcvars.nextsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x+1])^flip) >> ANGLETOSKYSHIFT);
-          colfunc(&dcvars);
-        }
+      job->sky = true;
+      job->dcvars = dcvars;
+      job->tex_patch = tex_patch;
+      job->an = an;
+      job->flip = flip;
     }
     else {     // regular flat
 
@@ -709,13 +743,241 @@ static void R_DoDrawPlane(visplane_t *pl)
       dsvars.planezlight = zlight[light];
       pl->top[pl->minx-1] = pl->top[stop] = SHRT_MAX; // dropoff overflow
 
-      for (x = pl->minx ; x <= stop ; x++)
-         R_MakeSpans(x,pl->top[x-1],pl->bottom[x-1],
-                     pl->top[x],pl->bottom[x], &dsvars);
+      job->sky = false;
+      job->dsvars = dsvars;
+    }
+  }
+
+  if (find_rows)
+  {
+    int x;
+
+    job->top = viewheight;
+    job->bottom = -1;
+
+    for (x = pl->minx; x <= pl->maxx; x++)
+      if (pl->top[x] != SHRT_MAX && pl->top[x] <= pl->bottom[x])
+      {
+        if (pl->top[x] < job->top)
+          job->top = pl->top[x];
+        if (pl->bottom[x] > job->bottom)
+          job->bottom = pl->bottom[x];
+      }
+  }
+}
+
+// Restricts a plane column to the rows y1..y2
+static inline void R_ClipPlaneColumn(const visplane_t *pl, int x, int y1, int y2,
+                                     unsigned int *top, unsigned int *bottom)
+{
+  *top = pl->top[x];
+  *bottom = pl->bottom[x];
+
+  if (*top == SHRT_MAX) // dropoff overflow
+    return;
+
+  if (*top < (unsigned int) y1)
+    *top = y1;
+  if (*bottom > (unsigned int) y2)
+    *bottom = y2;
+}
+
+static void R_DrawPlaneJob(const plane_job_t *job, int y1, int y2,
+                           int *spanstart, R_DrawColumn_f colfunc)
+{
+  const visplane_t *pl = job->pl;
+  int x;
+
+  if (job->top > y2 || job->bottom < y1)
+    return;
+
+  if (job->sky) {
+    draw_column_vars_t dcvars = job->dcvars;
+    const rpatch_t *tex_patch = job->tex_patch;
+    angle_t an = job->an, flip = job->flip;
+    unsigned int top, bottom;
+
+    // killough 10/98: Use sky scrolling offset, and possibly flip picture
+    for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
+    {
+      R_ClipPlaneColumn(pl, x, y1, y2, &top, &bottom);
+
+      if (top != SHRT_MAX && top <= bottom) // dropoff overflow
+      {
+        dcvars.yl = top;
+        dcvars.yh = bottom;
+        dcvars.source = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT);
+        dcvars.prevsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x-1])^flip) >> ANGLETOSKYSHIFT);
+        dcvars.nextsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x+1])^flip) >> ANGLETOSKYSHIFT);
+        colfunc(&dcvars);
+      }
+    }
+  }
+  else {
+    draw_span_vars_t dsvars = job->dsvars;
+    unsigned int t1, b1, t2, b2;
+    int stop = pl->maxx + 1;
+
+    R_ClipPlaneColumn(pl, pl->minx - 1, y1, y2, &t1, &b1);
+
+    for (x = pl->minx ; x <= stop ; x++)
+    {
+      R_ClipPlaneColumn(pl, x, y1, y2, &t2, &b2);
+      R_MakeSpans(x, t1, b1, t2, b2, &dsvars, spanstart);
+      t1 = t2;
+      b1 = b2;
+    }
+  }
+}
+
+static void R_DoDrawPlane(visplane_t *pl)
+{
+  if (pl->minx <= pl->maxx) {
+    plane_job_t job;
+
+    R_SetupPlaneJob(pl, &job, false);
+    R_DrawPlaneJob(&job, 0, viewheight - 1, spanstart,
+                   R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, RDRAW_FILTER_POINT));
+  }
+}
+
+//
+// Threaded plane drawing
+//
+
+static plane_job_t *plane_jobs;
+static int plane_job_count;
+static int plane_job_capacity;
+
+static dsda_thread_pool_t *plane_pool;
+static int plane_pool_request;
+static unsigned long long plane_worker_time[DSDA_MAX_PLANE_WORKERS];
+
+#define FIXEDT_128MASK ((127<<FRACBITS)|0xffff)
+
+// Equivalent to the standard column drawer, but it writes straight to
+// the frame buffer instead of going through the shared column buffer
+static void R_DrawPlaneColumn(draw_column_vars_t *dcvars)
+{
+  int count = dcvars->yh - dcvars->yl + 1;
+  const fixed_t fracstep = dcvars->iscale;
+  fixed_t frac = dcvars->texturemid + (dcvars->yl - centery) * fracstep;
+  const byte *source = dcvars->source;
+  const lighttable_t *colormap = dcvars->colormap;
+  byte *dest = drawvars.topleft + dcvars->yl * drawvars.pitch + dcvars->x;
+  const int pitch = drawvars.pitch;
+
+  if (count <= 0)
+    return;
+
+  if (dcvars->texheight == 128) {
+    while (count--) {
+      *dest = colormap[source[(frac & FIXEDT_128MASK) >> FRACBITS]];
+      dest += pitch;
+      frac += fracstep;
+    }
+  } else if (dcvars->texheight == 0) {
+    while (count--) {
+      *dest = colormap[source[frac >> FRACBITS]];
+      dest += pitch;
+      frac += fracstep;
+    }
+  } else {
+    unsigned heightmask = dcvars->texheight-1;
+    if (! (dcvars->texheight & heightmask) ) {
+      fixed_t fixedt_heightmask = (heightmask<<FRACBITS)|0xffff;
+      while (count--) {
+        *dest = colormap[source[(frac & fixedt_heightmask) >> FRACBITS]];
+        dest += pitch;
+        frac += fracstep;
+      }
+    } else {
+      heightmask++;
+      heightmask <<= FRACBITS;
+
+      if (frac < 0)
+        while ((frac += heightmask) <  0);
+      else
+        while (frac >= (int)heightmask)
+          frac -= heightmask;
+
+      while (count--) {
+        *dest = colormap[source[frac >> FRACBITS]];
+        dest += pitch;
+        if ((frac += fracstep) >= (int)heightmask)
+          frac -= heightmask;
+      }
     }
   }
 }
 
+static void R_DrawPlaneBand(int index, void *data)
+{
+  int count = dsda_ThreadPoolSize(plane_pool);
+  int y1 = viewheight * index / count;
+  int y2 = viewheight * (index + 1) / count - 1;
+  unsigned long long start;
+  int i;
+
+  start = dsda_TimeNS();
+
+  for (i = 0; i < plane_job_count; i++)
+    R_DrawPlaneJob(&plane_jobs[i], y1, y2, plane_spanstart[index], R_DrawPlaneColumn);
+
+  plane_worker_time[index] = dsda_TimeNS() - start;
+}
+
+static void R_UpdatePlanePool(int threads)
+{
+  if (plane_pool && plane_pool_request == threads)
+    return;
+
+  if (plane_pool)
+    dsda_DestroyThreadPool(plane_pool);
+
+  plane_pool = dsda_CreateThreadPool("plane worker", threads);
+  plane_pool_request = threads;
+}
+
+static void R_DrawPlanesThreaded(int threads)
+{
+  visplane_t *pl;
+  int i;
+
+  R_UpdatePlanePool(threads);
+
+  for (i = 0; i < dsda_ThreadPoolSize(plane_pool); i++)
+    if (!plane_spanstart[i])
+      plane_spanstart[i] = Z_Calloc(1, SCREENHEIGHT * sizeof(*plane_spanstart[i]));
+
+  plane_job_count = 0;
+
+  for (i=0;i<MAXVISPLANES;i++)
+    for (pl=visplanes[i]; pl; pl=pl->next)
+    {
+      dsda_RecordVisPlane();
+
+      if (pl->minx > pl->maxx)
+        continue;
+
+      if (plane_job_count == plane_job_capacity)
+      {
+        plane_job_capacity = plane_job_capacity ? plane_job_capacity * 2 : 128;
+        plane_jobs = Z_Realloc(plane_jobs, plane_job_capacity * sizeof(*plane_jobs));
+      }
+
+      R_SetupPlaneJob(pl, &plane_jobs[plane_job_count++], true);
+    }
+
+  // Walls may still be waiting in the column buffer
+  R_ResetColumnBuffer();
+
+  dsda_RunThreadPool(plane_pool, R_DrawPlaneBand, NULL);
+
+  for (i = 0; i < dsda_ThreadPoolSize(plane_pool); i++)
+    dsda_RecordPlaneWorkerTime(i, plane_worker_time[i]);
+}
+
 //
 // RDrawPlanes
 // At the end of each frame.
@@ -725,6 +987,16 @@ void R_DrawPlanes (void)
 {
   visplane_t *pl;
   int i;
+  int threads;
+
+  threads = dsda_IntConfig(dsda_config_render_plane_threads);
+
+  if (threads > 1)
+  {
+    R_DrawPlanesThreaded(threads);
+    return;
+  }
+
   for (i=0;i<MAXVISPLANES;i++)
     for (pl=visplanes[i]; pl; pl=pl->next)
     {
@@ -70,7 +70,7 @@ void R_InitSkyMap(void)
     skystretch = false;
     // HERETIC_TODO: this is set to 200, but something else is missing...
     skytexturemid = 100*FRACUNIT;
-    skyiscale = (200 << FRACBITS) / SCREENHEIGHT;
+    skyiscale = (200 << FRACBITS) / render_screenheight;
   }
   else
   {
@@ -106,7 +106,7 @@ void R_InitSkyMap(void)
       skytexturemid = (200 - skyheight) << FRACBITS;
     }
 
-    skyiscale = (200 << FRACBITS) / SCREENHEIGHT;
+    skyiscale = (200 << FRACBITS) / render_screenheight;
 
     if (skystretch)
     {
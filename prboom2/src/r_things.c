@@ -1525,7 +1525,7 @@ void R_DrawMasked(void)
 {
   int i;
   drawseg_t *ds;
-  int cx = SCREENWIDTH / 2;
+  int cx = viewwidth / 2;
 
   R_SortVisSprites();
 
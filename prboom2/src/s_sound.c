@@ -49,6 +49,7 @@
 #include "lprintf.h"
 #include "p_maputl.h"
 #include "p_setup.h"
+#include "p_tick.h"
 #include "e6y.h"
 
 #include "hexen/sn_sonix.h"
@@ -69,6 +70,30 @@
 
 const int channel_not_found = -1;
 
+// Listener state that S_AdjustSoundParams depends on
+typedef struct
+{
+  fixed_t x, y;          // where the distance is measured from
+  fixed_t angle_x, angle_y;
+  angle_t angle;
+} sound_listener_t;
+
+// The last S_AdjustSoundParams result for a channel, with everything that went
+// into it. Most sources and the listener sit still for most tics.
+typedef struct
+{
+  dboolean valid;
+  sound_listener_t listener;
+  fixed_t origin_x, origin_y;
+  sfxinfo_t *sfxinfo;
+  int channel_volume;
+  int sfx_volume;
+
+  int separation;
+  int volume;
+  int priority;
+} params_cache_t;
+
 typedef struct
 {
   sfxinfo_t *sfxinfo;  // sound information (if null, channel avail.)
@@ -87,12 +112,18 @@ typedef struct
   dboolean loop;
   int loop_timeout;
   sfx_class_t sfx_class;
+
+  params_cache_t params_cache;
 } channel_t;
 
 // the set of channels available
 static channel_t channels[MAX_CHANNELS];
 static degenmobj_t sobjs[MAX_CHANNELS];
 
+// Min-heap of channel numbers by score, ties going to the lower channel number
+static int score_heap[MAX_CHANNELS];
+static int score_heap_slot[MAX_CHANNELS];
+
 // Maximum volume of a sound effect.
 // Internal default is max out of 0-15.
 int snd_SfxVolume;
@@ -112,6 +143,12 @@ musicinfo_t *mus_playing;
 // music currently should play
 static int musicnum_current;
 
+// Game time at which the music that should play started, so that it can be
+// put back where it belongs after a skip or a key frame restore.
+// The request is a music number, or -1 - lumpnum for MUSINFO lumps.
+static int music_request;
+static int music_start_time;
+
 // number of channels available
 int numChannels;
 
@@ -127,6 +164,8 @@ void S_StopChannel(int cnum);
 int S_AdjustSoundParams(mobj_t *listener, mobj_t *source, channel_t *channel, sfx_params_t *params);
 
 static int S_getChannel(void *origin, sfxinfo_t *sfxinfo, sfx_params_t *params);
+static void S_ResetScoreHeap(void);
+static void S_SetChannelPriority(int cnum, int priority);
 
 
 // heretic
@@ -179,6 +218,7 @@ void S_Init(void)
     // Reset channel memory
     memset(channels, 0, sizeof(channels));
     memset(sobjs, 0, sizeof(sobjs));
+    S_ResetScoreHeap();
 
     if (first_s_init)
     {
@@ -231,6 +271,72 @@ void S_Init(void)
   }
 }
 
+static void S_MarkSound(byte *hitlist, int sfx_id)
+{
+  if (sfx_id > 0 && sfx_id < num_sfx)
+    hitlist[sfx_id] = 1;
+}
+
+//
+// The sounds of the things in the level, plus the door, platform, and
+//  switch sounds if there are any line specials
+//
+void S_PrecacheLevel(void)
+{
+  static const int line_sounds[] = {
+    sfx_swtchn, sfx_swtchx, sfx_doropn, sfx_dorcls, sfx_bdopn,
+    sfx_bdcls, sfx_pstart, sfx_pstop, sfx_stnmov,
+  };
+  byte *hitlist;
+  int *sfx_ids;
+  int count = 0;
+  int i;
+
+  if (nosfxparm)
+    return;
+
+  hitlist = Z_Calloc(num_sfx, 1);
+
+  {
+    thinker_t *th = NULL;
+    while ((th = P_NextThinker(th, th_all)) != NULL)
+      if (th->function == P_MobjThinker)
+      {
+        const mobjinfo_t *info = ((mobj_t *) th)->info;
+
+        S_MarkSound(hitlist, info->seesound);
+        S_MarkSound(hitlist, info->attacksound);
+        S_MarkSound(hitlist, info->painsound);
+        S_MarkSound(hitlist, info->deathsound);
+        S_MarkSound(hitlist, info->activesound);
+      }
+  }
+
+  // heretic and hexen use other sounds (and sound sequences)
+  if (!raven)
+    for (i = 0; i < numlines; i++)
+      if (lines[i].special)
+      {
+        int j;
+
+        for (j = 0; j < sizeof(line_sounds) / sizeof(line_sounds[0]); j++)
+          S_MarkSound(hitlist, line_sounds[j]);
+
+        break;
+      }
+
+  sfx_ids = Z_Malloc(num_sfx * sizeof(*sfx_ids));
+
+  for (i = 1; i < num_sfx; i++)
+    if (hitlist[i])
+      sfx_ids[count++] = i;
+
+  I_PrecacheSounds(sfx_ids, count);
+
+  Z_Free(sfx_ids);
+  Z_Free(hitlist);
+}
+
 void S_Stop(void)
 {
   int cnum;
@@ -376,7 +482,7 @@ void S_StartSoundAtVolume(void *origin_p, int sfx_id, int volume, int loop_timeo
     {
       channels[cnum].handle = h;
       channels[cnum].pitch = params.pitch;
-      channels[cnum].priority = params.priority;
+      S_SetChannelPriority(cnum, params.priority);
       channels[cnum].ambient = params.ambient;
       channels[cnum].loop = params.loop;
       channels[cnum].loop_timeout = params.loop_timeout;
@@ -521,12 +627,86 @@ void S_ResumeSound(void)
 }
 
 
+static void S_GetListenerState(mobj_t *listener, sound_listener_t *state)
+{
+  memset(state, 0, sizeof(*state));
+
+  if (!listener)
+    return;
+
+  if (walkcamera.type > 1)
+  {
+    state->x = walkcamera.x;
+    state->y = walkcamera.y;
+  }
+  else
+  {
+    state->x = listener->x;
+    state->y = listener->y;
+  }
+
+  state->angle_x = listener->x;
+  state->angle_y = listener->y;
+  state->angle = listener->angle;
+}
+
+// S_AdjustSoundParams for a playing channel, reusing the last result when
+// nothing it depends on has changed
+static int S_AdjustChannelParams(mobj_t *listener, const sound_listener_t *state,
+                                 channel_t *channel, sfx_params_t *params)
+{
+  params_cache_t *cache = &channel->params_cache;
+  mobj_t *source = channel->origin;
+
+  if (nosfxparm || !listener)
+    return 0;
+
+  if (
+    cache->valid &&
+    cache->origin_x == source->x &&
+    cache->origin_y == source->y &&
+    cache->sfxinfo == channel->sfxinfo &&
+    cache->channel_volume == channel->volume &&
+    cache->sfx_volume == sfx_volume &&
+    !memcmp(&cache->listener, state, sizeof(*state))
+  )
+  {
+    params->ambient = channel->ambient;
+    params->loop = channel->loop;
+    params->loop_timeout = channel->loop_timeout;
+    params->pitch = channel->pitch;
+    params->separation = cache->separation;
+    params->volume = cache->volume;
+    params->priority = cache->priority;
+
+    return 1;
+  }
+
+  cache->valid = S_AdjustSoundParams(listener, source, channel, params);
+
+  if (cache->valid)
+  {
+    cache->listener = *state;
+    cache->origin_x = source->x;
+    cache->origin_y = source->y;
+    cache->sfxinfo = channel->sfxinfo;
+    cache->channel_volume = channel->volume;
+    cache->sfx_volume = sfx_volume;
+    cache->separation = params->separation;
+    cache->volume = params->volume;
+    cache->priority = params->priority;
+  }
+
+  return cache->valid;
+}
+
 //
 // Updates music & sounds
 //
 void S_UpdateSounds(void)
 {
   mobj_t *listener;
+  sound_listener_t listener_state;
   int cnum;
 
   //jff 1/22/98 return if sound is not enabled
@@ -547,6 +727,8 @@ void S_UpdateSounds(void)
     SN_UpdateActiveSequences();
   }
 
+  S_GetListenerState(listener, &listener_state);
+
   for (cnum = 0; cnum < numChannels; cnum++)
   {
     channel_t *channel = &channels[cnum];
@@ -565,10 +747,10 @@ void S_UpdateSounds(void)
         // or modify their params
         if (channel->origin && listener != channel->origin) // killough 3/20/98
         {
-          if (S_AdjustSoundParams(listener, channel->origin, channel, &params))
+          if (S_AdjustChannelParams(listener, &listener_state, channel, &params))
           {
             I_UpdateSoundParams(channel->handle, &params);
-            channel->priority = params.priority;
+            S_SetChannelPriority(cnum, params.priority);
           }
           else
           {
@@ -589,6 +771,37 @@ void S_StartMusic(int m_id)
   S_ChangeMusic(m_id, false);
 }
 
+static int S_GameTime(void)
+{
+  return totalleveltimes + leveltime;
+}
+
+// Music keeps its start time while it isn't playing (e.g. during a skip)
+static void S_TrackMusic(int request, dboolean restart)
+{
+  if (restart || request != music_request)
+    music_start_time = S_GameTime();
+
+  music_request = request;
+}
+
+int S_MusicTics(void)
+{
+  int tics = S_GameTime() - music_start_time;
+
+  return tics > 0 ? tics : 0;
+}
+
+void S_SeekMusic(int tics)
+{
+  music_start_time = S_GameTime() - tics;
+
+  if (nomusicparm || !mus_playing)
+    return;
+
+  I_SeekSong(mus_playing->handle, (int) ((int64_t) tics * 1000 / TICRATE));
+}
+
 void S_ChangeMusic(int musicnum, int looping)
 {
   musicinfo_t *music;
@@ -600,7 +813,10 @@ void S_ChangeMusic(int musicnum, int looping)
 
   //jff 1/22/98 return if music is not enabled
   if (nomusicparm)
+  {
+    S_TrackMusic(musicnum, false);
     return;
+  }
 
   if (musicnum <= mus_None || musicnum >= num_music)
     I_Error("S_ChangeMusic: Bad music number %d", musicnum);
@@ -623,6 +839,7 @@ void S_ChangeMusic(int musicnum, int looping)
 
   // play it
   I_PlaySong(music->handle, looping);
+  S_TrackMusic(musicnum, true);
 
   mus_playing = music;
 
@@ -651,12 +868,19 @@ void S_RestartMusic(void)
   }
 }
 
+void S_RestartMusicAt(int tics)
+{
+  S_RestartMusic();
+  S_SeekMusic(tics);
+}
+
 void S_ChangeMusInfoMusic(int lumpnum, int looping)
 {
   musicinfo_t *music;
 
   if (dsda_SkipMode())
   {
+    S_TrackMusic(-1 - lumpnum, false);
     musinfo.current_item = lumpnum;
     return;
   }
@@ -685,6 +909,7 @@ void S_ChangeMusInfoMusic(int lumpnum, int looping)
 
   // play it
   I_PlaySong(music->handle, looping);
+  S_TrackMusic(-1 - lumpnum, true);
 
   mus_playing = music;
 
@@ -837,24 +1062,86 @@ static int S_ChannelScore(channel_t *channel)
   return channel->priority;
 }
 
-static int S_LowestScoreChannel(void)
+static dboolean S_ScoreHeapLess(int cnum1, int cnum2)
+{
+  int score1 = S_ChannelScore(&channels[cnum1]);
+  int score2 = S_ChannelScore(&channels[cnum2]);
+
+  return score1 < score2 || (score1 == score2 && cnum1 < cnum2);
+}
+
+static void S_SwapScoreHeap(int slot1, int slot2)
+{
+  int cnum1 = score_heap[slot1];
+  int cnum2 = score_heap[slot2];
+
+  score_heap[slot1] = cnum2;
+  score_heap[slot2] = cnum1;
+  score_heap_slot[cnum2] = slot1;
+  score_heap_slot[cnum1] = slot2;
+}
+
+static void S_SiftScoreHeap(int slot)
+{
+  while (slot > 0 && S_ScoreHeapLess(score_heap[slot], score_heap[(slot - 1) / 2]))
+  {
+    S_SwapScoreHeap(slot, (slot - 1) / 2);
+    slot = (slot - 1) / 2;
+  }
+
+  while (1)
+  {
+    int child = 2 * slot + 1;
+
+    if (child >= numChannels)
+      break;
+
+    if (child + 1 < numChannels && S_ScoreHeapLess(score_heap[child + 1], score_heap[child]))
+      ++child;
+
+    if (!S_ScoreHeapLess(score_heap[child], score_heap[slot]))
+      break;
+
+    S_SwapScoreHeap(slot, child);
+    slot = child;
+  }
+}
+
+// Channels are in order, so this is a valid heap while all the scores match
+static void S_ResetScoreHeap(void)
 {
   int cnum;
-  int lowest_score = INT_MAX;
-  int lowest_cnum = channel_not_found;
 
   for (cnum = 0; cnum < numChannels; ++cnum)
   {
-    int score = S_ChannelScore(&channels[cnum]);
-
-    if (score < lowest_score)
-    {
-      lowest_score = score;
-      lowest_cnum = cnum;
-    }
+    channels[cnum].priority = 0;
+    score_heap[cnum] = cnum;
+    score_heap_slot[cnum] = cnum;
   }
+}
+
+static void S_SetChannelPriority(int cnum, int priority)
+{
+  if (channels[cnum].priority == priority)
+    return;
 
-  return lowest_cnum;
+  channels[cnum].priority = priority;
+  S_SiftScoreHeap(score_heap_slot[cnum]);
+}
+
+static int S_LowestScoreChannel(void)
+{
+  int cnum;
+
+  if (numChannels <= 0)
+    return channel_not_found;
+
+  cnum = score_heap[0];
+
+  if (S_ChannelScore(&channels[cnum]) == INT_MAX)
+    return channel_not_found;
+
+  return cnum;
 }
 
 static int S_getChannel(void *origin, sfxinfo_t *sfxinfo, sfx_params_t *params)
@@ -1145,7 +1432,7 @@ static void Raven_S_StartSoundAtVolume(void *_origin, int sound_id, int volume,
   channels[cnum].handle = I_StartSound(sound_id, cnum, &params);
   channels[cnum].origin = origin;
   channels[cnum].sfxinfo = sfx;
-  channels[cnum].priority = params.priority;
+  S_SetChannelPriority(cnum, params.priority);
   channels[cnum].volume = volume; // original volume, not attenuated volume
   channels[cnum].ambient = params.ambient;
   channels[cnum].loop = params.loop;
@@ -1201,7 +1488,7 @@ void S_StartAmbientSound(void *_origin, int sound_id, int volume)
   channels[i].handle = I_StartSound(sound_id, i, &params);
   channels[i].origin = origin;
   channels[i].sfxinfo = sfx;
-  channels[i].priority = params.priority;
+  S_SetChannelPriority(i, params.priority);
   channels[i].ambient = params.ambient;
   channels[i].loop = params.loop;
   channels[i].loop_timeout = params.loop_timeout;
@@ -61,6 +61,9 @@ void S_Stop(void);
 //
 void S_Start(void);
 
+// Decodes the sounds the level is likely to play ahead of time
+void S_PrecacheLevel(void);
+
 //
 // Start sound for thing at <origin>
 //  using <sound_id> from sounds.h
@@ -96,6 +99,11 @@ void S_StartMusic(int music_id);
 void S_ChangeMusic(int music_id, int looping);
 void S_ChangeMusInfoMusic(int lumpnum, int looping);
 void S_RestartMusic(void);
+void S_RestartMusicAt(int tics);
+
+// Game time in tics since the current music started, and moving it there
+int S_MusicTics(void);
+void S_SeekMusic(int tics);
 
 // Stops the music fer sure.
 void S_StopMusic(void);
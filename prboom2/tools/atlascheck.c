@@ -0,0 +1,218 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Checks for the GL sprite atlas allocator (dsda/gl/atlas.c)
+//
+//  Runs a fixed layout through the shelf allocator and then random image
+//  sizes, checking that regions stay inside their page, never overlap
+//  including the gutters, and move on to a new page when one is full.
+//  Exits with 1 on the first failure.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dsda/gl/atlas.h"
+
+#define MAX_IMAGES 4096
+
+static char keys[MAX_IMAGES];
+static int failures;
+
+#define CHECK(condition) \
+  if (!(condition)) \
+  { \
+    fprintf(stderr, "dsda-atlascheck: %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+    ++failures; \
+    return; \
+  }
+
+static void CheckRegion(const dsda_atlas_region_t *region, int page, int x, int y)
+{
+  CHECK(region->page == page);
+  CHECK(region->x == x);
+  CHECK(region->y == y);
+}
+
+// 10x10 images with a gutter of 1 take 12x12, so a 64 pixel page holds
+// five shelves of five images
+static void CheckFixedLayout(void)
+{
+  dsda_atlas_t *atlas;
+  const dsda_atlas_region_t *region;
+  int i;
+
+  atlas = dsda_CreateAtlas(64, 2, 1);
+
+  for (i = 0; i < 50; ++i)
+  {
+    region = dsda_AtlasInsert(atlas, &keys[i], 10, 10);
+    CheckRegion(region, i / 25, (i % 5) * 12 + 1, (i % 25 / 5) * 12 + 1);
+    CHECK(region->width == 10 && region->height == 10);
+  }
+
+  CHECK(dsda_AtlasPageCount(atlas) == 2);
+
+  // Both pages are full
+  region = dsda_AtlasInsert(atlas, &keys[50], 10, 10);
+  CHECK(region->page == -1);
+  CHECK(dsda_AtlasPageCount(atlas) == 2);
+
+  // Inserting a key again returns the first region
+  region = dsda_AtlasInsert(atlas, &keys[27], 20, 20);
+  CheckRegion(region, 1, 2 * 12 + 1, 1);
+  CHECK(dsda_AtlasFind(atlas, &keys[27]) == region);
+  CHECK(dsda_AtlasFind(atlas, &keys[51]) == NULL);
+
+  dsda_ResetAtlas(atlas);
+  CHECK(dsda_AtlasPageCount(atlas) == 0);
+  CHECK(dsda_AtlasFind(atlas, &keys[0]) == NULL);
+
+  region = dsda_AtlasInsert(atlas, &keys[30], 10, 10);
+  CheckRegion(region, 0, 1, 1);
+
+  dsda_FreeAtlas(atlas);
+}
+
+static void CheckRejected(void)
+{
+  dsda_atlas_t *atlas;
+
+  atlas = dsda_CreateAtlas(64, 4, 1);
+
+  // The gutter doesn't fit around a full width image
+  CHECK(dsda_AtlasInsert(atlas, &keys[0], 63, 10)->page == -1);
+  CHECK(dsda_AtlasInsert(atlas, &keys[1], 10, 63)->page == -1);
+  CHECK(dsda_AtlasInsert(atlas, &keys[2], 0, 10)->page == -1);
+  CHECK(dsda_AtlasInsert(atlas, &keys[3], 62, 62)->page == 0);
+  CHECK(dsda_AtlasPageCount(atlas) == 1);
+
+  dsda_FreeAtlas(atlas);
+}
+
+// An image that doesn't fit on the last page starts a new one
+static void CheckOverflow(void)
+{
+  dsda_atlas_t *atlas;
+  const dsda_atlas_region_t *region;
+
+  atlas = dsda_CreateAtlas(64, 3, 2);
+
+  region = dsda_AtlasInsert(atlas, &keys[0], 40, 40);
+  CheckRegion(region, 0, 2, 2);
+
+  region = dsda_AtlasInsert(atlas, &keys[1], 40, 40);
+  CheckRegion(region, 1, 2, 2);
+
+  // The rest of page 1 gets a shelf for short images
+  region = dsda_AtlasInsert(atlas, &keys[2], 12, 12);
+  CheckRegion(region, 1, 2, 46);
+
+  region = dsda_AtlasInsert(atlas, &keys[3], 12, 12);
+  CheckRegion(region, 1, 18, 46);
+
+  region = dsda_AtlasInsert(atlas, &keys[4], 40, 40);
+  CheckRegion(region, 2, 2, 2);
+
+  // That shelf keeps filling after page 2 is opened
+  region = dsda_AtlasInsert(atlas, &keys[5], 12, 12);
+  CheckRegion(region, 1, 34, 46);
+
+  CHECK(dsda_AtlasInsert(atlas, &keys[6], 40, 40)->page == -1);
+  CHECK(dsda_AtlasPageCount(atlas) == 3);
+
+  dsda_FreeAtlas(atlas);
+}
+
+static int Overlap(const dsda_atlas_region_t *a, const dsda_atlas_region_t *b, int gutter)
+{
+  return a->page == b->page &&
+         a->x - gutter < b->x + b->width + gutter &&
+         b->x - gutter < a->x + a->width + gutter &&
+         a->y - gutter < b->y + b->height + gutter &&
+         b->y - gutter < a->y + a->height + gutter;
+}
+
+static void CheckRandomImages(unsigned int seed)
+{
+  static dsda_atlas_region_t regions[MAX_IMAGES];
+  dsda_atlas_t *atlas;
+  int page_size = 256;
+  int max_pages = 4;
+  int gutter = 1;
+  int placed = 0;
+  int count;
+  int i, j;
+
+  srand(seed);
+
+  atlas = dsda_CreateAtlas(page_size, max_pages, gutter);
+  count = 500 + rand() % 1500;
+
+  for (i = 0; i < count; ++i)
+  {
+    int width = 1 + rand() % (rand() % 8 ? 32 : 128);
+    int height = 1 + rand() % (rand() % 8 ? 32 : 128);
+
+    // Region pointers only last until the next insert
+    regions[i] = *dsda_AtlasInsert(atlas, &keys[i], width, height);
+
+    CHECK(regions[i].width == width && regions[i].height == height);
+    CHECK(regions[i].page < max_pages);
+
+    if (regions[i].page < 0)
+      continue;
+
+    CHECK(regions[i].x >= gutter && regions[i].y >= gutter);
+    CHECK(regions[i].x + width + gutter <= page_size);
+    CHECK(regions[i].y + height + gutter <= page_size);
+
+    for (j = 0; j < i; ++j)
+      CHECK(!Overlap(&regions[i], &regions[j], gutter));
+
+    ++placed;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    const dsda_atlas_region_t *region = dsda_AtlasFind(atlas, &keys[i]);
+
+    CHECK(region && region->page == regions[i].page);
+    CHECK(region->x == regions[i].x && region->y == regions[i].y);
+  }
+
+  CHECK(placed > 0);
+  CHECK(dsda_AtlasPageCount(atlas) <= max_pages);
+
+  dsda_FreeAtlas(atlas);
+}
+
+int main(void)
+{
+  unsigned int seed;
+
+  CheckFixedLayout();
+  CheckRejected();
+  CheckOverflow();
+
+  for (seed = 1; seed <= 200 && !failures; ++seed)
+    CheckRandomImages(seed);
+
+  if (failures)
+    return 1;
+
+  printf("dsda-atlascheck: ok\n");
+
+  return 0;
+}
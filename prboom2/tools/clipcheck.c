@@ -0,0 +1,514 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *
+ *---------------------------------------------------------------------
+ */
+
+/*
+*
+** gl_clipper.cpp
+**
+** Handles visibility checks.
+** Loosely based on the JDoom clipper.
+**
+**---------------------------------------------------------------------------
+** Copyright 2003 Tim Stump
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+// Checks and benchmark for the gl clip ranges (dsda/gl/clip_ranges.c)
+//
+// The linked list clipper that gl_clipper.c used before is kept below as
+// the reference. Random sequences of added ranges and visibility checks,
+// including wrapping and boundary angles, must give the same results from
+// both. The benchmark then runs bsp-like frames through each and reports
+// ranges per second. Exits with 1 on a mismatch.
+//
+//   dsda-clipcheck [sequences]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "z_zone.h"
+
+#include "dsda/gl/clip_ranges.h"
+
+//
+// Reference: the linked list clipper
+//
+
+typedef struct clipnode_s
+{
+  struct clipnode_s *prev, *next;
+  angle_t start, end;
+} clipnode_t;
+
+static clipnode_t *freelist;
+static clipnode_t *cliphead;
+
+static clipnode_t * List_clipnode_GetNew(void);
+static clipnode_t * List_clipnode_NewRange(angle_t start, angle_t end);
+static dboolean List_clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle);
+static void List_clipper_AddClipRange(angle_t start, angle_t end);
+static void List_clipper_RemoveRange(clipnode_t * range);
+static void List_clipnode_Free(clipnode_t *node);
+
+static clipnode_t * List_clipnode_GetNew(void)
+{
+  if (freelist)
+  {
+    clipnode_t * p = freelist;
+    freelist = p->next;
+    return p;
+  }
+  else
+  {
+    return Z_Malloc(sizeof(clipnode_t));
+  }
+}
+
+static clipnode_t * List_clipnode_NewRange(angle_t start, angle_t end)
+{
+  clipnode_t * c = List_clipnode_GetNew();
+  c->start = start;
+  c->end = end;
+  c->next = c->prev=NULL;
+  return c;
+}
+
+static dboolean List_clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle)
+{
+  if(startAngle > endAngle)
+  {
+    return (List_clipper_IsRangeVisible(startAngle, ANGLE_MAX) || List_clipper_IsRangeVisible(0, endAngle));
+  }
+
+  return List_clipper_IsRangeVisible(startAngle, endAngle);
+}
+
+static dboolean List_clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle)
+{
+  clipnode_t *ci;
+  ci = cliphead;
+
+  if (endAngle == 0 && ci && ci->start == 0)
+    return false;
+
+  while (ci != NULL && ci->start < endAngle)
+  {
+    if (startAngle >= ci->start && endAngle <= ci->end)
+    {
+      return false;
+    }
+    ci = ci->next;
+  }
+
+  return true;
+}
+
+static void List_clipnode_Free(clipnode_t *node)
+{
+  node->next = freelist;
+  freelist = node;
+}
+
+static void List_clipper_RemoveRange(clipnode_t *range)
+{
+  if (range == cliphead)
+  {
+    cliphead = cliphead->next;
+  }
+  else
+  {
+    if (range->prev)
+    {
+      range->prev->next = range->next;
+    }
+    if (range->next)
+    {
+      range->next->prev = range->prev;
+    }
+  }
+
+  List_clipnode_Free(range);
+}
+
+static void List_clipper_SafeAddClipRange(angle_t startangle, angle_t endangle)
+{
+  if(startangle > endangle)
+  {
+    // The range has to added in two parts.
+    List_clipper_AddClipRange(startangle, ANGLE_MAX);
+    List_clipper_AddClipRange(0, endangle);
+  }
+  else
+  {
+    // Add the range as usual.
+    List_clipper_AddClipRange(startangle, endangle);
+  }
+}
+
+static void List_clipper_AddClipRange(angle_t start, angle_t end)
+{
+  clipnode_t *node, *temp, *prevNode, *node2, *delnode;
+
+  if (cliphead)
+  {
+    //check to see if range contains any old ranges
+    node = cliphead;
+    while (node != NULL && node->start < end)
+    {
+      if (node->start >= start && node->end <= end)
+      {
+        temp = node;
+        node = node->next;
+        List_clipper_RemoveRange(temp);
+      }
+      else
+      {
+        if (node->start <= start && node->end >= end)
+        {
+          return;
+        }
+        else
+        {
+          node = node->next;
+        }
+      }
+    }
+
+    //check to see if range overlaps a range (or possibly 2)
+    node = cliphead;
+    while (node != NULL && node->start <= end)
+    {
+      if (node->end >= start)
+      {
+        // we found the first overlapping node
+        if (node->start > start)
+        {
+          // the new range overlaps with this node's start point
+          node->start = start;
+        }
+        if (node->end < end)
+        {
+          node->end = end;
+        }
+
+        node2 = node->next;
+        while (node2 && node2->start <= node->end)
+        {
+          if (node2->end > node->end)
+          {
+            node->end = node2->end;
+          }
+
+          delnode = node2;
+          node2 = node2->next;
+          List_clipper_RemoveRange(delnode);
+        }
+        return;
+      }
+      node = node->next;
+    }
+
+    //just add range
+    node = cliphead;
+    prevNode = NULL;
+    temp = List_clipnode_NewRange(start, end);
+    while (node != NULL && node->start < end)
+    {
+      prevNode = node;
+      node = node->next;
+    }
+    temp->next = node;
+    if (node == NULL)
+    {
+      temp->prev = prevNode;
+      if (prevNode)
+      {
+        prevNode->next = temp;
+      }
+      if (!cliphead)
+      {
+        cliphead = temp;
+      }
+    }
+    else
+    {
+      if (node == cliphead)
+      {
+        cliphead->prev = temp;
+        cliphead = temp;
+      }
+      else
+      {
+        temp->prev = prevNode;
+        prevNode->next = temp;
+        node->prev = temp;
+      }
+    }
+  }
+  else
+  {
+    temp = List_clipnode_NewRange(start, end);
+    cliphead = temp;
+    return;
+  }
+}
+
+static void List_clipper_Clear(void)
+{
+  clipnode_t *node = cliphead;
+  clipnode_t *temp;
+
+  while (node != NULL)
+  {
+    temp = node;
+    node = node->next;
+    List_clipnode_Free(temp);
+  }
+
+  cliphead = NULL;
+}
+
+//
+// Checks
+//
+
+static unsigned int random_state = 1;
+
+// Same sequence on every platform, unlike rand()
+static unsigned int Random(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+
+  return random_state;
+}
+
+static angle_t RandomAngle(int mode)
+{
+  static const angle_t edges[] = { 0, 1, ANGLE_MAX - 1, ANGLE_MAX, ANG180 };
+
+  switch (mode)
+  {
+    case 0:
+      return Random();
+    case 1:
+      // small domain, so ranges often touch, nest and repeat
+      return Random() % 64;
+    case 2:
+      return edges[Random() % (sizeof(edges) / sizeof(*edges))];
+    default:
+      return (Random() % 2048) << 21;
+  }
+}
+
+static void ClearBoth(void)
+{
+  List_clipper_Clear();
+  dsda_ClearClipRanges();
+}
+
+static int CheckSequences(int count)
+{
+  long checks = 0;
+  int sequence;
+
+  for (sequence = 0; sequence < count; ++sequence)
+  {
+    int mode = Random() % 4;
+    int steps = 1 + Random() % 300;
+    int step;
+
+    ClearBoth();
+
+    for (step = 0; step < steps; ++step)
+    {
+      angle_t start = RandomAngle(mode);
+      angle_t end = RandomAngle(mode);
+
+      if (Random() % 3 == 0)
+      {
+        List_clipper_SafeAddClipRange(start, end);
+        dsda_AddClipRange(start, end);
+      }
+      else
+      {
+        dboolean expected = List_clipper_SafeCheckRange(start, end);
+
+        if (dsda_ClipRangeVisible(start, end) != expected)
+        {
+          fprintf(stderr, "dsda-clipcheck: sequence %d step %d: range %u %u should be %s\n",
+                  sequence, step, start, end, expected ? "visible" : "hidden");
+          return 1;
+        }
+
+        ++checks;
+      }
+    }
+  }
+
+  printf("dsda-clipcheck: %d sequences, %ld checks match\n", sequence, checks);
+
+  return 0;
+}
+
+//
+// Benchmark
+//
+
+typedef struct
+{
+  const char *name;
+  void (*clear)(void);
+  dboolean (*check)(angle_t start, angle_t end);
+  void (*add)(angle_t start, angle_t end);
+} clipper_t;
+
+static const clipper_t clippers[] = {
+  { "list", List_clipper_Clear, List_clipper_SafeCheckRange, List_clipper_SafeAddClipRange },
+  { "array", dsda_ClearClipRanges, dsda_ClipRangeVisible, dsda_AddClipRange },
+};
+
+#define BENCHMARK_RANGES (1 << 16)
+#define BENCHMARK_TOTAL 500000
+
+static int benchmark_visible;
+
+// Like r_bsp: the frustum is clipped first, then each seg is checked and
+// the solid ones are added. Ranges are narrow, as segs are.
+static double RunFrames(const clipper_t *clipper, const angle_t *ranges, int ranges_per_frame,
+                        int frames)
+{
+  clock_t start_time;
+  int frame;
+
+  start_time = clock();
+
+  for (frame = 0; frame < frames; ++frame)
+  {
+    const angle_t *range = ranges + 2 * ((frame * 7919) % (BENCHMARK_RANGES - ranges_per_frame));
+    int i;
+
+    clipper->clear();
+    clipper->add(ANG90 + ANG45, ANG270 - ANG45);
+
+    for (i = 0; i < ranges_per_frame; ++i, range += 2)
+      if (clipper->check(range[0], range[1]))
+      {
+        ++benchmark_visible;
+
+        if (range[0] & 1)
+          clipper->add(range[0], range[1]);
+      }
+  }
+
+  return (double) (clock() - start_time) / CLOCKS_PER_SEC;
+}
+
+static void Benchmark(void)
+{
+  static const int ranges_per_frame[] = { 64, 512, 4096 };
+  angle_t *ranges;
+  int i, j;
+
+  ranges = Z_Malloc(2 * BENCHMARK_RANGES * sizeof(*ranges));
+
+  for (i = 0; i < BENCHMARK_RANGES; ++i)
+  {
+    angle_t start = Random();
+
+    ranges[2 * i] = start;
+    ranges[2 * i + 1] = start + (Random() >> (12 + Random() % 8));
+  }
+
+  for (i = 0; i < sizeof(ranges_per_frame) / sizeof(*ranges_per_frame); ++i)
+  {
+    int frames = BENCHMARK_TOTAL / ranges_per_frame[i];
+
+    for (j = 0; j < sizeof(clippers) / sizeof(*clippers); ++j)
+    {
+      double seconds;
+
+      // warm up, then time
+      RunFrames(&clippers[j], ranges, ranges_per_frame[i], frames / 10);
+      seconds = RunFrames(&clippers[j], ranges, ranges_per_frame[i], frames);
+
+      printf("dsda-clipcheck: %5d ranges per frame, %-5s %8.2f M ranges/s\n",
+             ranges_per_frame[i], clippers[j].name,
+             seconds > 0 ? (double) frames * ranges_per_frame[i] / seconds / 1000000 : 0.0);
+    }
+  }
+
+  Z_Free(ranges);
+}
+
+int main(int argc, char **argv)
+{
+  int count = 100000;
+
+  if (argc > 1)
+    count = atoi(argv[1]);
+
+  if (CheckSequences(count))
+    return 1;
+
+  Benchmark();
+
+  return 0;
+}
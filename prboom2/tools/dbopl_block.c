@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	dbopl.c with the block synth, for dsda-oplcheck
+//
+
+#define DBOPL_BLOCK_SYNTH 1
+
+#define DBOPL_InitTables BlockDBOPL_InitTables
+#define Chip__Chip BlockChip__Chip
+#define Chip__Setup BlockChip__Setup
+#define Chip__WriteReg BlockChip__WriteReg
+#define Chip__WriteAddr BlockChip__WriteAddr
+#define Chip__GenerateBlock2 BlockChip__GenerateBlock2
+#define Chip__GenerateBlock3 BlockChip__GenerateBlock3
+
+#include "MUSIC/dbopl.c"
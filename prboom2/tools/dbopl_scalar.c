@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	dbopl.c with the sample by sample synth, for dsda-oplcheck
+//
+
+#define DBOPL_BLOCK_SYNTH 0
+
+#define DBOPL_InitTables ScalarDBOPL_InitTables
+#define Chip__Chip ScalarChip__Chip
+#define Chip__Setup ScalarChip__Setup
+#define Chip__WriteReg ScalarChip__WriteReg
+#define Chip__WriteAddr ScalarChip__WriteAddr
+#define Chip__GenerateBlock2 ScalarChip__GenerateBlock2
+#define Chip__GenerateBlock3 ScalarChip__GenerateBlock3
+
+#include "MUSIC/dbopl.c"
@@ -0,0 +1,543 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Checks the OPL block synth against the sample by sample synth
+//
+//  Every music lump in the given wads is played through the game's OPL
+//  player (oplplayer.c and opl.c). The chip those call only records the
+//  register writes and the sample counts. The recording is then replayed
+//  through dbopl.c built both ways (dbopl_scalar.c and dbopl_block.c),
+//  the outputs are compared with memcmp, and the time each took is
+//  reported as samples per second. Exits with 1 on the first difference.
+//
+//    dsda-oplcheck [-rate <hz>] <wad> [<wad> ...]
+//
+//  Later wads replace lumps of earlier ones, so a pwad without a GENMIDI
+//  lump can follow the iwad.
+//
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "doomtype.h"
+#include "memio.h"
+#include "mus2mid.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/configuration.h"
+
+#include "MUSIC/dbopl.h"
+#include "MUSIC/midifile.h"
+#include "MUSIC/musicplayer.h"
+#include "MUSIC/oplplayer.h"
+
+// Notes still sound for a while after the last event
+#define SONG_TAIL_SECONDS 2
+#define SONG_MAX_SECONDS (30 * 60)
+
+// Samples per render call, as the mixer would ask for them
+#define RENDER_CHUNK 1024
+
+// Samples replayed between comparisons
+#define SEGMENT_SAMPLES (1 << 18)
+
+//
+// Wad lumps, for the W_ functions the player calls
+//
+
+typedef struct
+{
+  char name[9];
+  const byte *data;
+  int size;
+} wad_lump_t;
+
+static wad_lump_t *wad_lumps;
+static int wad_lump_count;
+
+static unsigned int ReadInt(const byte *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
+
+static int LoadWad(const char *filename)
+{
+  FILE *file;
+  byte *data;
+  long size;
+  unsigned int count, offset, i;
+
+  file = fopen(filename, "rb");
+  if (!file)
+  {
+    fprintf(stderr, "dsda-oplcheck: unable to open %s\n", filename);
+    return 1;
+  }
+
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  data = Z_Malloc(size > 0 ? size : 1);
+
+  if (size < 12 || fread(data, size, 1, file) != 1 ||
+      (memcmp(data, "IWAD", 4) && memcmp(data, "PWAD", 4)))
+  {
+    fprintf(stderr, "dsda-oplcheck: %s is not a wad\n", filename);
+    fclose(file);
+    return 1;
+  }
+
+  fclose(file);
+
+  count = ReadInt(data + 4);
+  offset = ReadInt(data + 8);
+
+  if (offset > size || count > (size - offset) / 16)
+  {
+    fprintf(stderr, "dsda-oplcheck: %s has a bad directory\n", filename);
+    return 1;
+  }
+
+  wad_lumps = Z_Realloc(wad_lumps, (wad_lump_count + count) * sizeof(*wad_lumps));
+
+  for (i = 0; i < count; ++i)
+  {
+    const byte *entry = data + offset + i * 16;
+    wad_lump_t *lump = &wad_lumps[wad_lump_count + i];
+    unsigned int position = ReadInt(entry);
+    unsigned int length = ReadInt(entry + 4);
+
+    if (position > size || length > size - position)
+      position = length = 0;
+
+    memcpy(lump->name, entry + 8, 8);
+    lump->name[8] = '\0';
+    lump->data = data + position;
+    lump->size = length;
+  }
+
+  wad_lump_count += count;
+
+  return 0;
+}
+
+static int LumpNameMatches(const wad_lump_t *lump, const char *name)
+{
+  int i;
+
+  for (i = 0; i < 8; ++i)
+  {
+    if (toupper((unsigned char) lump->name[i]) != toupper((unsigned char) name[i]))
+      return false;
+
+    if (!name[i])
+      return true;
+  }
+
+  return true;
+}
+
+int W_GetNumForName(const char *name)
+{
+  int i;
+
+  for (i = wad_lump_count - 1; i >= 0; --i)
+    if (LumpNameMatches(&wad_lumps[i], name))
+      return i;
+
+  fprintf(stderr, "dsda-oplcheck: %s not found\n", name);
+  exit(1);
+
+  return -1;
+}
+
+const void *W_LumpByNum(int lump)
+{
+  return wad_lumps[lump].data;
+}
+
+int dsda_IntConfig(dsda_config_identifier_t id)
+{
+  // The default gain
+  if (id == dsda_config_mus_opl_gain)
+    return 50;
+
+  return 0;
+}
+
+//
+// The chip opl.c drives: records what happens
+//
+
+// Register write, or samples generated if samples > 0
+typedef struct
+{
+  unsigned int samples;
+  unsigned short reg;
+  byte value;
+} opl_event_t;
+
+static opl_event_t *opl_events;
+static size_t opl_event_count;
+static size_t opl_event_capacity;
+static Bit32u opl_rate;
+
+static void AddEvent(unsigned int samples, unsigned int reg, byte value)
+{
+  if (opl_event_count == opl_event_capacity)
+  {
+    opl_event_capacity = opl_event_capacity ? opl_event_capacity * 2 : 65536;
+    opl_events = Z_Realloc(opl_events, opl_event_capacity * sizeof(*opl_events));
+  }
+
+  opl_events[opl_event_count].samples = samples;
+  opl_events[opl_event_count].reg = reg;
+  opl_events[opl_event_count].value = value;
+  ++opl_event_count;
+}
+
+void DBOPL_InitTables(void)
+{
+}
+
+void Chip__Chip(Chip *self)
+{
+  opl_event_count = 0;
+}
+
+void Chip__Setup(Chip *self, Bit32u rate)
+{
+  opl_rate = rate;
+}
+
+void Chip__WriteReg(Chip *self, Bit32u reg, Bit8u val)
+{
+  AddEvent(0, reg, val);
+}
+
+void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s *output)
+{
+  memset(output, 0, total * sizeof(*output));
+
+  if (total)
+    AddEvent(total, 0, 0);
+}
+
+//
+// dbopl.c built both ways
+//
+
+void ScalarDBOPL_InitTables(void);
+void ScalarChip__Chip(Chip *self);
+void ScalarChip__Setup(Chip *self, Bit32u rate);
+void ScalarChip__WriteReg(Chip *self, Bit32u reg, Bit8u val);
+void ScalarChip__GenerateBlock2(Chip *self, Bitu total, Bit32s *output);
+
+void BlockDBOPL_InitTables(void);
+void BlockChip__Chip(Chip *self);
+void BlockChip__Setup(Chip *self, Bit32u rate);
+void BlockChip__WriteReg(Chip *self, Bit32u reg, Bit8u val);
+void BlockChip__GenerateBlock2(Chip *self, Bitu total, Bit32s *output);
+
+typedef struct
+{
+  const char *name;
+  void (*init_tables)(void);
+  void (*chip)(Chip *self);
+  void (*setup)(Chip *self, Bit32u rate);
+  void (*write_reg)(Chip *self, Bit32u reg, Bit8u val);
+  void (*generate)(Chip *self, Bitu total, Bit32s *output);
+
+  Chip state;
+  Bit32s *output;
+  double seconds;
+} synth_t;
+
+static synth_t synths[2] = {
+  {
+    "scalar", ScalarDBOPL_InitTables, ScalarChip__Chip, ScalarChip__Setup,
+    ScalarChip__WriteReg, ScalarChip__GenerateBlock2
+  },
+  {
+    "block", BlockDBOPL_InitTables, BlockChip__Chip, BlockChip__Setup,
+    BlockChip__WriteReg, BlockChip__GenerateBlock2
+  },
+};
+
+#define SYNTH_COUNT (sizeof(synths) / sizeof(*synths))
+
+static void ReplayEvents(synth_t *synth, size_t first, size_t last)
+{
+  Bit32s *output = synth->output;
+  clock_t start_time;
+  size_t i;
+
+  start_time = clock();
+
+  for (i = first; i < last; ++i)
+  {
+    if (opl_events[i].samples)
+    {
+      synth->generate(&synth->state, opl_events[i].samples, output);
+      output += opl_events[i].samples;
+    }
+    else
+      synth->write_reg(&synth->state, opl_events[i].reg, opl_events[i].value);
+  }
+
+  synth->seconds += (double) (clock() - start_time) / CLOCKS_PER_SEC;
+}
+
+// Returns the number of samples compared, or 0 if the outputs differ
+static size_t ReplaySong(const char *name)
+{
+  size_t first = 0;
+  size_t total = 0;
+  int s;
+
+  for (s = 0; s < SYNTH_COUNT; ++s)
+  {
+    synths[s].init_tables();
+    synths[s].chip(&synths[s].state);
+    synths[s].setup(&synths[s].state, opl_rate);
+  }
+
+  while (first < opl_event_count)
+  {
+    size_t last = first;
+    size_t samples = 0;
+    size_t i;
+
+    while (last < opl_event_count && samples + opl_events[last].samples <= SEGMENT_SAMPLES)
+      samples += opl_events[last++].samples;
+
+    for (s = 0; s < SYNTH_COUNT; ++s)
+      ReplayEvents(&synths[s], first, last);
+
+    for (s = 1; s < SYNTH_COUNT; ++s)
+      if (memcmp(synths[0].output, synths[s].output, samples * sizeof(*synths[s].output)))
+      {
+        for (i = 0; synths[0].output[i] == synths[s].output[i]; ++i);
+
+        fprintf(stderr, "dsda-oplcheck: %s: %s and %s differ at sample %lu (%d, %d)\n",
+                name, synths[0].name, synths[s].name, (unsigned long) (total + i),
+                synths[0].output[i], synths[s].output[i]);
+
+        return 0;
+      }
+
+    total += samples;
+    first = last;
+  }
+
+  return total;
+}
+
+//
+// Songs
+//
+
+// Length of a midi file in milliseconds, or -1 if it doesn't load
+static int SongLength(const void *data, size_t size)
+{
+  midimem_t mf;
+  midi_file_t *file;
+  midi_event_t **events;
+  midi_timeline_t *timeline;
+  midi_state_t state;
+  double remaining;
+  int low, high;
+
+  mf.data = data;
+  mf.len = size;
+  mf.pos = 0;
+
+  file = MIDI_LoadFileSpecial(&mf);
+  if (!file)
+    return -1;
+
+  events = MIDI_GenerateFlatList(file);
+  if (!events)
+  {
+    MIDI_FreeFile(file);
+    return -1;
+  }
+
+  timeline = MIDI_BuildTimeline(file, events, 1000);
+
+  // The first position past the last event
+  low = 0;
+  high = SONG_MAX_SECONDS * 1000;
+  while (low < high)
+  {
+    int mid = low + (high - low) / 2;
+
+    if (MIDI_SeekTimeline(timeline, mid, false, &state, &remaining) < 0)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  MIDI_FreeTimeline(timeline);
+  MIDI_DestroyFlatList(events);
+  MIDI_FreeFile(file);
+
+  return low;
+}
+
+static int CheckSong(const wad_lump_t *lump, unsigned int rate, size_t *samples)
+{
+  static short buffer[RENDER_CHUNK * 2];
+  void *midi = NULL;
+  size_t midi_size;
+  const void *handle;
+  int length;
+  size_t rendered, total;
+  int s;
+
+  if (lump->size >= 4 && !memcmp(lump->data, "MUS\x1a", 4))
+  {
+    MEMFILE *instream = mem_fopen_read(lump->data, lump->size);
+    MEMFILE *outstream = mem_fopen_write();
+    void *outbuf;
+
+    // mus2mid returns true on failure
+    if (mus2mid(instream, outstream))
+    {
+      printf("%-8s  not converted\n", lump->name);
+      mem_fclose(instream);
+      mem_fclose(outstream);
+      return 0;
+    }
+
+    mem_get_buf(outstream, &outbuf, &midi_size);
+    midi = Z_Malloc(midi_size);
+    memcpy(midi, outbuf, midi_size);
+
+    mem_fclose(instream);
+    mem_fclose(outstream);
+  }
+  else
+  {
+    midi_size = lump->size;
+    midi = Z_Malloc(midi_size);
+    memcpy(midi, lump->data, midi_size);
+  }
+
+  length = SongLength(midi, midi_size);
+
+  if (length < 0 || !opl_synth_player.init(rate))
+  {
+    printf("%-8s  not loaded\n", lump->name);
+    Z_Free(midi);
+    return 0;
+  }
+
+  opl_synth_player.setvolume(15);
+  handle = opl_synth_player.registersong(midi, midi_size);
+
+  if (!handle)
+  {
+    printf("%-8s  not loaded\n", lump->name);
+    opl_synth_player.shutdown();
+    Z_Free(midi);
+    return 0;
+  }
+
+  opl_synth_player.play(handle, false);
+
+  total = ((size_t) length + SONG_TAIL_SECONDS * 1000) * rate / 1000;
+  for (rendered = 0; rendered < total; rendered += RENDER_CHUNK)
+    opl_synth_player.render(buffer, RENDER_CHUNK);
+
+  opl_synth_player.stop();
+  opl_synth_player.unregistersong(handle);
+  opl_synth_player.shutdown();
+  Z_Free(midi);
+
+  *samples = ReplaySong(lump->name);
+
+  if (!*samples)
+    return 1;
+
+  printf("%-8s  %6.1f s  identical\n", lump->name, (double) *samples / rate);
+
+  return 0;
+}
+
+static int IsSong(const wad_lump_t *lump)
+{
+  return lump->size >= 4 &&
+         (!memcmp(lump->data, "MUS\x1a", 4) || !memcmp(lump->data, "MThd", 4));
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int rate = 44100;
+  size_t total = 0;
+  int songs = 0;
+  int i, s;
+
+  for (i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "-rate") && i + 1 < argc)
+      rate = atoi(argv[++i]);
+    else if (LoadWad(argv[i]))
+      return 1;
+  }
+
+  if (!wad_lump_count || rate < 4000)
+  {
+    fprintf(stderr, "usage: dsda-oplcheck [-rate <hz>] <wad> [<wad> ...]\n");
+    return 1;
+  }
+
+  for (s = 0; s < SYNTH_COUNT; ++s)
+    synths[s].output = Z_Malloc(SEGMENT_SAMPLES * sizeof(*synths[s].output));
+
+  for (i = 0; i < wad_lump_count; ++i)
+  {
+    size_t samples = 0;
+
+    // Only the last lump of a name is played
+    if (!IsSong(&wad_lumps[i]) || W_GetNumForName(wad_lumps[i].name) != i)
+      continue;
+
+    if (CheckSong(&wad_lumps[i], rate, &samples))
+      return 1;
+
+    total += samples;
+    songs += samples > 0;
+  }
+
+  if (!songs)
+  {
+    fprintf(stderr, "dsda-oplcheck: no music lumps found\n");
+    return 1;
+  }
+
+  printf("dsda-oplcheck: %d songs, %.1f s at %u Hz identical\n", songs, (double) total / rate, rate);
+
+  for (s = 0; s < SYNTH_COUNT; ++s)
+    printf("dsda-oplcheck: %-6s %6.2f M samples/s (%.0fx real time)\n", synths[s].name,
+           synths[s].seconds > 0 ? total / synths[s].seconds / 1000000 : 0.0,
+           synths[s].seconds > 0 ? total / synths[s].seconds / rate : 0.0);
+
+  return 0;
+}
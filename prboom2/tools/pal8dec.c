@@ -0,0 +1,181 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Decoder for indexed video capture streams (cap_pal8)
+//
+//  Reads a DSDAPAL8 stream on stdin and writes raw rgb24 frames, either to
+//  stdout or to the stdin of the command given on the command line:
+//
+//    dsda-pal8dec ffmpeg -f rawvideo -pix_fmt rgb24 ... -i - ...
+//
+//  See docs/capture_pal8_format.md for the stream layout.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define popen _popen
+#define pclose _pclose
+#define POPEN_WRITE "wb"
+#else
+#define POPEN_WRITE "w"
+#endif
+
+#define PAL8_VERSION 1
+#define PAL8_HEADER_SIZE 20
+#define PAL8_PALETTE_SIZE (256 * 3)
+
+static unsigned int ReadInt(const unsigned char *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
+
+// Rejoins the encoder command, quoting arguments that contain spaces
+static char *JoinCommand(int argc, char **argv)
+{
+  size_t length = 1;
+  char *command;
+  int i;
+
+  for (i = 0; i < argc; ++i)
+    length += strlen(argv[i]) + 3;
+
+  command = malloc(length);
+  command[0] = '\0';
+
+  for (i = 0; i < argc; ++i)
+  {
+    int quote = strchr(argv[i], ' ') != NULL;
+
+    if (i)
+      strcat(command, " ");
+    if (quote)
+      strcat(command, "\"");
+    strcat(command, argv[i]);
+    if (quote)
+      strcat(command, "\"");
+  }
+
+  return command;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char header[PAL8_HEADER_SIZE];
+  unsigned char palette[PAL8_PALETTE_SIZE];
+  unsigned char *indices;
+  unsigned char *rgb;
+  unsigned int width, height, pixels;
+  unsigned int frames = 0;
+  FILE *out = stdout;
+  int type;
+  int result = 0;
+
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  if (argc > 1)
+  {
+    char *command = JoinCommand(argc - 1, argv + 1);
+
+    out = popen(command, POPEN_WRITE);
+    if (!out)
+    {
+      fprintf(stderr, "dsda-pal8dec: unable to run %s\n", command);
+      return 1;
+    }
+
+    free(command);
+  }
+
+  if (
+    fread(header, sizeof(header), 1, stdin) != 1 ||
+    memcmp(header, "DSDAPAL8", 8) ||
+    ReadInt(header + 8) != PAL8_VERSION
+  )
+  {
+    fprintf(stderr, "dsda-pal8dec: input is not a version %d DSDAPAL8 stream\n", PAL8_VERSION);
+    return 1;
+  }
+
+  width = ReadInt(header + 12);
+  height = ReadInt(header + 16);
+  pixels = width * height;
+
+  if (!width || !height || width > 16384 || height > 16384)
+  {
+    fprintf(stderr, "dsda-pal8dec: bad frame size %ux%u\n", width, height);
+    return 1;
+  }
+
+  indices = malloc(pixels);
+  rgb = malloc(pixels * 3);
+  memset(palette, 0, sizeof(palette));
+
+  while ((type = fgetc(stdin)) != EOF)
+  {
+    if (type == 'P')
+    {
+      if (fread(palette, sizeof(palette), 1, stdin) != 1)
+        break;
+    }
+    else if (type == 'F')
+    {
+      const unsigned char *src = indices;
+      unsigned char *dest = rgb;
+      unsigned int i;
+
+      if (fread(indices, pixels, 1, stdin) != 1)
+        break;
+
+      for (i = 0; i < pixels; ++i)
+      {
+        const unsigned char *colour = palette + 3 * *src++;
+
+        *dest++ = colour[0];
+        *dest++ = colour[1];
+        *dest++ = colour[2];
+      }
+
+      if (fwrite(rgb, pixels * 3, 1, out) != 1)
+      {
+        fprintf(stderr, "dsda-pal8dec: write failed after %u frames\n", frames);
+        result = 1;
+        break;
+      }
+
+      ++frames;
+    }
+    else
+    {
+      fprintf(stderr, "dsda-pal8dec: unknown chunk type 0x%02x after %u frames\n", type, frames);
+      result = 1;
+      break;
+    }
+  }
+
+  free(indices);
+  free(rgb);
+
+  if (out != stdout && pclose(out))
+    result = 1;
+
+  return result;
+}
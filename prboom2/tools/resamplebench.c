@@ -0,0 +1,247 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Benchmark for the streamed music resamplers (MUSIC/resample.c)
+//
+//  Resamples a fixed stereo signal with both snd_music_resampler modes
+//  at the rate pairs streamed music usually meets and prints output
+//  frames per second for each. The stream is pulled in mixer sized
+//  chunks, as the music players do.
+//
+//  Before that, every case is also pulled in random sized chunks and
+//  checked against the same stream pulled in one piece. Each output frame
+//  must only depend on its position in the stream, so a resampler reading
+//  input it hasn't pulled yet shows up as a difference. Exits with 1 on
+//  the first one.
+//
+//    dsda-resamplebench [<seconds of output per case>]
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MUSIC/resample.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CHUNK_FRAMES 1024
+#define CHECK_FRAMES 20000
+
+typedef void (*resampler_t) (void *dest, unsigned nsamp, void (*proc) (void *dest, unsigned nsamp), unsigned sratein, unsigned srateout);
+
+static const struct
+{
+  const char *name;
+  resampler_t resample;
+} resamplers[] = {
+  { "linear", I_LinearResampleStream },
+  { "sinc", I_SincResampleStream },
+};
+
+static const struct
+{
+  unsigned sratein;
+  unsigned srateout;
+} rates[] = {
+  { 22050, 44100 },
+  { 44100, 48000 },
+  { 48000, 44100 },
+  { 44100, 96000 },
+};
+
+static short *signal;
+static unsigned signal_frames;
+static unsigned signal_pos;
+static int peak;
+
+// One second of 440 Hz on the left and 3000 Hz on the right at about
+//  -6 dB. Both are whole cycles, so the second loops without a click.
+static void MakeSignal (unsigned rate)
+{
+  unsigned i;
+
+  signal = realloc(signal, rate * 2 * sizeof(*signal));
+  if (!signal)
+  {
+    fprintf(stderr, "dsda-resamplebench: out of memory\n");
+    exit(1);
+  }
+
+  for (i = 0; i < rate; i++)
+  {
+    double t = (double) i / rate;
+
+    signal[i * 2 + 0] = (short) (16384.0 * sin(2 * M_PI * 440.0 * t));
+    signal[i * 2 + 1] = (short) (16384.0 * sin(2 * M_PI * 3000.0 * t));
+  }
+
+  signal_frames = rate;
+  signal_pos = 0;
+}
+
+// Stands in for a music player's render function
+static void RenderSignal (void *dest, unsigned nsamp)
+{
+  short *out = dest;
+
+  while (nsamp)
+  {
+    unsigned count = signal_frames - signal_pos;
+
+    if (count > nsamp)
+      count = nsamp;
+
+    memcpy(out, signal + signal_pos * 2, count * 2 * sizeof(*signal));
+    out += count * 2;
+    nsamp -= count;
+    signal_pos = (signal_pos + count) % signal_frames;
+  }
+}
+
+// Runs one case and returns the time it took in seconds
+static double Resample (resampler_t resample, unsigned sratein, unsigned srateout, unsigned frames)
+{
+  static short output[CHUNK_FRAMES * 2];
+  clock_t start_time;
+  double elapsed;
+  unsigned done;
+  int i;
+
+  start_time = clock();
+
+  for (done = 0; done < frames; done += CHUNK_FRAMES)
+    resample(output, CHUNK_FRAMES, RenderSignal, sratein, srateout);
+
+  elapsed = (double) (clock() - start_time) / CLOCKS_PER_SEC;
+
+  for (i = 0; i < CHUNK_FRAMES * 2; i++)
+    if (abs(output[i]) > peak)
+      peak = abs(output[i]);
+
+  return elapsed;
+}
+
+// Changing the rates starts a new stream
+static void ResetStream (resampler_t resample)
+{
+  short output[2];
+
+  MakeSignal(1000);
+  resample(output, 1, RenderSignal, 1000, 1000);
+}
+
+static unsigned int random_state = 1;
+
+static unsigned int Random(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+
+  return random_state;
+}
+
+static int CheckChunks (int m, int r)
+{
+  static short whole[CHECK_FRAMES * 4];
+  static short chunked[CHECK_FRAMES * 2];
+  resampler_t resample = resamplers[m].resample;
+  unsigned sratein = rates[r].sratein;
+  unsigned srateout = rates[r].srateout;
+  unsigned done, count;
+  unsigned i;
+
+  // the end of the one piece run isn't compared
+  ResetStream(resample);
+  MakeSignal(sratein);
+  resample(whole, CHECK_FRAMES * 2, RenderSignal, sratein, srateout);
+
+  ResetStream(resample);
+  MakeSignal(sratein);
+  for (done = 0; done < CHECK_FRAMES; done += count)
+  {
+    // mostly short chunks, so the end of one often lands in the same
+    //  input frame as the start of the next
+    count = 1 + Random() % (Random() % 4 ? 16 : 2 * CHUNK_FRAMES);
+    if (count > CHECK_FRAMES - done)
+      count = CHECK_FRAMES - done;
+
+    resample(chunked + done * 2, count, RenderSignal, sratein, srateout);
+  }
+
+  for (i = 0; i < CHECK_FRAMES * 2; i++)
+    if (chunked[i] != whole[i])
+    {
+      fprintf(stderr, "dsda-resamplebench: %u -> %u Hz, %s: frame %u is %d in chunks and %d in one piece\n",
+              sratein, srateout, resamplers[m].name, i / 2, chunked[i], whole[i]);
+      return 0;
+    }
+
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = 60;
+  int r, m;
+
+  if (argc > 1)
+    seconds = atof(argv[1]);
+
+  if (seconds <= 0)
+  {
+    fprintf(stderr, "usage: dsda-resamplebench [<seconds of output per case>]\n");
+    return 1;
+  }
+
+  for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    for (m = 0; m < sizeof(resamplers) / sizeof(resamplers[0]); m++)
+      if (!CheckChunks(m, r))
+        return 1;
+
+  printf("dsda-resamplebench: chunked and whole streams match\n");
+
+  for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    for (m = 0; m < sizeof(resamplers) / sizeof(resamplers[0]); m++)
+    {
+      unsigned frames = (unsigned) (seconds * rates[r].srateout);
+      double elapsed;
+
+      MakeSignal(rates[r].sratein);
+
+      // the first call sets up the stream and isn't timed
+      Resample(resamplers[m].resample, rates[r].sratein, rates[r].srateout, CHUNK_FRAMES);
+      elapsed = Resample(resamplers[m].resample, rates[r].sratein, rates[r].srateout, frames);
+
+      if (elapsed <= 0)
+        elapsed = 1.0 / CLOCKS_PER_SEC;
+
+      printf("dsda-resamplebench: %5u -> %5u Hz, %-6s %8.2f M frames/s (%.0fx real time)\n",
+             rates[r].sratein, rates[r].srateout, resamplers[m].name,
+             frames / elapsed / 1000000, seconds / elapsed);
+    }
+
+  if (!peak)
+  {
+    fprintf(stderr, "dsda-resamplebench: the output is silent\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Engine functions for the check and benchmark tools
+//
+//  The tools link single engine modules on their own. These stand in for
+//  the zone allocator and the console output those modules call.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lprintf.h"
+#include "z_zone.h"
+
+static void *CheckAllocation(void *p, size_t size)
+{
+  if (!p && size)
+  {
+    fprintf(stderr, "out of memory allocating %lu bytes\n", (unsigned long) size);
+    exit(1);
+  }
+
+  return p;
+}
+
+void *Z_Malloc(size_t size)
+{
+  return CheckAllocation(malloc(size), size);
+}
+
+void *Z_Calloc(size_t n, size_t n2)
+{
+  return CheckAllocation(calloc(n, n2), n * n2);
+}
+
+void *Z_Realloc(void *p, size_t n)
+{
+  return CheckAllocation(realloc(p, n), n);
+}
+
+void Z_Free(void *p)
+{
+  free(p);
+}
+
+int lprintf(OutputLevels pri, const char *fmt, ...)
+{
+  va_list args;
+  int result = 0;
+
+  if (pri & (LO_WARN | LO_ERROR))
+  {
+    va_start(args, fmt);
+    result = vfprintf(stderr, fmt, args);
+    va_end(args);
+  }
+
+  return result;
+}
@@ -0,0 +1,26 @@
+require 'fileutils'
+
+RSpec.describe 'render' do
+  # Set UPDATE_RENDER_HASHES=1 to write the golden files from the current build
+  def check_hashes(golden, actual)
+    if ENV['UPDATE_RENDER_HASHES']
+      FileUtils.mkdir_p(File.dirname(golden))
+      FileUtils.cp(actual.filename, golden)
+    end
+
+    expect(File).to exist(golden), "#{golden} is missing, run with UPDATE_RENDER_HASHES=1 to write it"
+    expect(actual.hashes).to eq(Utility::RenderHashes.new(golden).hashes)
+  end
+
+  describe 'software renderer hashes' do
+    %w[320x200 640x400 1280x800].each do |resolution|
+      context "doom2 player starts at #{resolution}" do
+        it 'matches the golden file' do
+          actual = Utility.render_hashes(resolution: resolution)
+
+          check_hashes("spec/support/render/doom2_#{resolution}.txt", actual)
+        end
+      end
+    end
+  end
+end
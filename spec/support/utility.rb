@@ -11,6 +11,21 @@ module Utility
     system(command)
   end
 
+  def render_hashes(resolution:, iwad: "DOOM2.WAD", pwad: nil, extra: nil)
+    width, height = resolution.split('x')
+
+    command = "./build/dsda-doom.exe -iwad spec/support/wads/#{iwad}"
+    command << " -file spec/support/wads/#{pwad}" if pwad
+    command << " -offscreen -nosound -nomusic -width #{width} -height #{height}"
+    command << " -render_benchmark render_benchmark.csv -render_benchmark_frames 1"
+    command << " -render_benchmark_hashes render_hashes.txt"
+    command << " #{extra}" if extra
+
+    system(command)
+
+    RenderHashes.new("render_hashes.txt")
+  end
+
   def read_analysis
     Analysis.new
   end
@@ -93,6 +108,20 @@ module Utility
     end
   end
 
+  class RenderHashes
+    attr_reader :filename
+
+    def initialize(filename)
+      @filename = filename
+      @data = File.readlines(filename, chomp: true).reject { |line| line.start_with?('#') }.map(&:split)
+    end
+
+    # map, view index, and resolution => md5 (render times are ignored)
+    def hashes
+      Hash[@data.map { |a| [a[0..2].join(' '), a[3]] }]
+    end
+  end
+
   class Levelstat
     def initialize(filename)
       @data = File.readlines(filename, chomp: true).map(&:split)
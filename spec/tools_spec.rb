@@ -0,0 +1,29 @@
+RSpec.describe 'tools' do
+  def run_tool(name, *args)
+    system("./build/#{name}.exe", *args)
+  end
+
+  describe 'dsda-atlascheck' do
+    it 'packs sprites into pages without overlap' do
+      expect(run_tool('dsda-atlascheck')).to be true
+    end
+  end
+
+  describe 'dsda-clipcheck' do
+    it 'matches the linked list clipper' do
+      expect(run_tool('dsda-clipcheck')).to be true
+    end
+  end
+
+  describe 'dsda-oplcheck' do
+    it 'renders the iwad music the same with the block synth' do
+      expect(run_tool('dsda-oplcheck', 'spec/support/wads/DOOM2.WAD')).to be true
+    end
+  end
+
+  describe 'dsda-resamplebench' do
+    it 'resamples with both music resamplers' do
+      expect(run_tool('dsda-resamplebench', '1')).to be true
+    end
+  end
+end